@@ -1,12 +1,43 @@
 #pragma once
 
+#include <core/utils/FileReader.h>
+
 #include <string>
 #include <filesystem>
+#include <span>
+#include <cstdint>
+#include <memory>
+#include <array>
 
 namespace fs = std::filesystem;
 
+struct evp_md_ctx_st;
+
 namespace core::crypto {
 
+/**
+ * @brief Binary digest, large enough for any of the supported algorithms. Shorter
+ *        digests occupy the leading bytes, the rest is zero.
+ */
+using Digest = std::array<uint8_t, 32>;
+
+
+/**
+ * @brief Hash functor for digests. The digests are uniformly distributed already,
+ *        their leading bytes are used as is.
+ */
+struct DigestHash
+{
+    size_t operator()(const Digest& digest) const noexcept;
+};
+
+
+/**
+ * @brief Convert bytes to a lowercase hexadecimal string
+ */
+std::string toHex(std::span<const uint8_t> bytes);
+
+
 /**
  * @brief Calculate SHA256 on the given data.
  *
@@ -39,6 +70,61 @@ void md5(std::string_view data, std::string& out);
 std::string md5(std::string_view data);
 
 
+/**
+ * @brief Calculate a fast, non-cryptographic 128 bit digest (MurmurHash3 x64 128)
+ *        on the given data. Suitable for grouping of equal contents, but not for
+ *        proving the equality, collisions can be crafted deliberately.
+ *
+ * @param data The data to calculate the digest on it.
+ *
+ * @return Digest of the data, as 32 hexadecimal characters
+ */
+void fastHash128(std::string_view data, std::string& out);
+
+
+/**
+ * @brief Convenience function, see fastHash128 with 2 arguments
+ */
+std::string fastHash128(std::string_view data);
+
+
+/**
+ * @brief Incremental SHA256 calculation, for data which arrives in pieces
+ */
+class Sha256Hasher
+{
+public:
+    Sha256Hasher();
+
+    /**
+     * @brief Copy the intermediate state, both hashers can be continued
+     *        independently
+     */
+    Sha256Hasher(const Sha256Hasher& other);
+    Sha256Hasher(Sha256Hasher&& other) noexcept;
+    Sha256Hasher& operator=(const Sha256Hasher&) = delete;
+    Sha256Hasher& operator=(Sha256Hasher&& other) noexcept;
+    ~Sha256Hasher();
+
+    void update(std::string_view data);
+
+    /**
+     * @brief Finish the calculation, the hasher can't be updated afterwards
+     *
+     * @param out SHA256 of all the data passed to update
+     */
+    void final(Digest& out);
+
+    /**
+     * @brief Same as above, the digest is written as a hexadecimal string
+     */
+    void final(std::string& out);
+
+private:
+    std::unique_ptr<evp_md_ctx_st, void (*)(evp_md_ctx_st*)> ctx_;
+};
+
+
 /**
  * @brief Calculate SHA256 of the file.
  *
@@ -49,6 +135,150 @@ std::string md5(std::string_view data);
 std::string fileSha256(const fs::path& file);
 
 
+using ByteRange = core::file::ByteRange;
+
+
+/**
+ * @brief Calculate SHA256 of the given ranges of the file. The ranges are digested
+ *        in the given order, as if they formed a single stream. The part of a range
+ *        past the end of the file is ignored.
+ *
+ * @param filePath The path to the file.
+ * @param ranges The ranges to be digested.
+ *
+ * @return SHA256 of the selected bytes of the file.
+ */
+std::string fileSha256(const fs::path& file, std::span<const ByteRange> ranges);
+
+
+/**
+ * @brief Algorithms available for digesting file contents
+ */
+enum class DigestType
+{
+    Fast128, // fast non-cryptographic, see fastHash128
+    Sha256
+};
+
+
+/**
+ * @brief Size of the digest of the given type in bytes
+ */
+size_t digestSize(DigestType type) noexcept;
+
+
+/**
+ * @brief Incremental calculation of a digest of the given type, for data which
+ *        arrives in pieces
+ */
+class DigestHasher
+{
+public:
+    explicit DigestHasher(DigestType type);
+    DigestHasher(DigestHasher&& other) noexcept;
+    DigestHasher& operator=(DigestHasher&& other) noexcept;
+    ~DigestHasher();
+
+    void update(std::string_view data);
+
+    /**
+     * @brief Finish the calculation, the hasher can't be updated afterwards
+     */
+    void final(Digest& out);
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+
+/**
+ * @brief Calculate the digest of the given type of the whole file. The file is read
+ *        by a reader with the default options, owned by the calling thread.
+ *
+ * @param filePath The path to the file.
+ * @param type The digest algorithm.
+ *
+ * @return Binary digest of the file.
+ */
+Digest fileDigest(const fs::path& file, DigestType type);
+
+
+/**
+ * @brief Calculate the digest of the given type of the selected ranges of the file,
+ *        see fileSha256 with ranges for the details.
+ */
+Digest fileDigest(const fs::path& file,
+                  DigestType type,
+                  std::span<const ByteRange> ranges);
+
+
+/**
+ * @brief Same as fileDigest above, the file is read by the given reader
+ */
+Digest fileDigest(file::FileReader& reader, const fs::path& file, DigestType type);
+
+
+/**
+ * @brief Same as fileDigest with ranges, the file is read by the given reader
+ */
+Digest fileDigest(file::FileReader& reader,
+                  const fs::path& file,
+                  DigestType type,
+                  std::span<const ByteRange> ranges);
+
+
+/**
+ * @brief Settings of the tree digest of a file
+ */
+struct TreeOptions
+{
+    // The selected bytes are digested in chunks of that size, the digest depends
+    // on it
+    uint64_t chunkBytes {64 * 1024 * 1024};
+
+    // Number of threads digesting the chunks, 0 selects the number of hardware
+    // threads
+    size_t workers {0};
+
+    // Size of the buffer of every thread
+    size_t bufferSize {1024 * 1024};
+};
+
+
+/**
+ * @brief Calculate the tree digest of the given type of the selected ranges of the
+ *        file. The selected bytes are split into chunks, which are digested in
+ *        parallel, every thread reads its chunks with `pread`. The result is the
+ *        digest of the digests of the chunks, in their order.
+ *
+ *        The tree digest differs from the plain one of the same bytes, digests of
+ *        files are comparable only if they were calculated the same way and with
+ *        the same chunk size.
+ *
+ * @param filePath The path to the file.
+ * @param type The digest algorithm of the chunks and of the root.
+ * @param ranges The ranges to be digested, see fileSha256 with ranges.
+ * @param opts The chunk size and the number of threads.
+ *
+ * @return Binary digest of the selected bytes of the file.
+ *
+ * @throw std::system_error if the file can't be opened or read
+ */
+Digest fileTreeDigest(const fs::path& file,
+                      DigestType type,
+                      std::span<const ByteRange> ranges,
+                      const TreeOptions& opts = {});
+
+
+/**
+ * @brief Same as above, for the whole file
+ */
+Digest fileTreeDigest(const fs::path& file,
+                      DigestType type,
+                      const TreeOptions& opts = {});
+
+
 /**
  * @brief Convert byte sequence into a base64 sequence
  *
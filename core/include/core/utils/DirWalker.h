@@ -0,0 +1,118 @@
+#pragma once
+
+#include <core/utils/File.h>
+#include <core/utils/PathMatcher.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace core::file {
+
+enum class EntryType : std::uint8_t
+{
+    Unknown,
+    Regular,
+    Directory,
+    Symlink,
+    Other
+};
+
+enum class SymlinkPolicy : std::uint8_t
+{
+    // Symbolic links are not reported
+    Skip,
+
+    // Symbolic links are reported as such, but not followed
+    Report,
+
+    // Symbolic links are resolved and reported as their targets, directories are
+    // entered only once, which breaks the cycles
+    Follow
+};
+
+/**
+ * @brief An entry of a directory discovered by the `DirWalker`
+ */
+struct WalkEntry
+{
+    fs::path path {};
+
+    // Taken from the directory listing when the file system provides it, otherwise
+    // from the metadata of the entry
+    EntryType type {EntryType::Unknown};
+
+    // Metadata of the entry, available only when requested by `WalkOptions::stat`
+    std::optional<FileInfo> info {};
+
+    // The directory is not entered, all the paths below it are excluded
+    bool pruned {false};
+
+    // The entry matches the exclusions, reported only on request and never entered
+    bool excluded {false};
+};
+
+struct WalkOptions
+{
+    // Number of threads listing directories, 0 selects the number of hardware threads
+    size_t threads {0};
+
+    // Query the metadata of every entry
+    bool stat {false};
+
+    // Report the entries in the order of a sequential walk with the entries of every
+    // directory sorted by name
+    bool deterministic {false};
+
+    SymlinkPolicy symlinks {SymlinkPolicy::Skip};
+
+    // Matching entries are not reported, matching directories are not entered.
+    // Directories with all the descendants matching are reported, but not entered.
+    PathMatcher exclusions {};
+
+    // Report the entries matching the exclusions too, with `excluded` set
+    bool reportExcluded {false};
+};
+
+/**
+ * @brief Receives the entries discovered by the walk. An error code is reported
+ * together with the directory which could not be listed.
+ */
+using WalkCallback = std::function<void(const WalkEntry&, const std::error_code&)>;
+
+/**
+ * @brief Recursively lists directories on a pool of threads
+ *
+ * Every worker keeps a queue of directories to be listed, subdirectories found by
+ * a worker are added to its own queue, idle workers steal directories from the
+ * queues of the others. The callback is always invoked on the thread that called
+ * `walk`, so callers don't need any synchronization.
+ */
+class DirWalker
+{
+public:
+    explicit DirWalker(WalkOptions opts = {});
+
+    const WalkOptions& options() const noexcept;
+
+    /**
+     * @brief Walk the given directory, the directory itself is not reported
+     *
+     * @param dir The directory to be walked
+     * @param cb Invoked for every discovered entry
+     *
+     * @throw Rethrows exceptions thrown by the callback after all workers are stopped
+     */
+    void walk(const fs::path& dir, const WalkCallback& cb) const;
+
+private:
+    WalkOptions opts_;
+};
+
+} // namespace core::file
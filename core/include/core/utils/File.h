@@ -4,7 +4,9 @@
 #include <filesystem>
 #include <system_error>
 #include <functional>
+#include <optional>
 #include <regex>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -49,6 +51,53 @@ void readLines(const fs::path& file, const LineCb& cb);
 std::string path2s(const fs::path& path);
 
 
+/**
+ * @brief Identity and metadata of a file as reported by the file system
+ */
+struct FileInfo
+{
+    uint64_t device {};
+    uint64_t inode {};
+    uint64_t size {};
+    uint64_t links {};
+
+    // Last modification time, in nanoseconds since the epoch
+    int64_t mtime {};
+};
+
+/**
+ * @brief Query identity and metadata of the file, symbolic links are followed
+ *
+ * @param file Path to the file
+ * @param info An object to be filled with the file information
+ * @param ec Error code reported by the underlying system call
+ *
+ * @return true if the operation completed successfully, otherwise false
+ */
+bool fileInfo(const fs::path& file, FileInfo& info, std::error_code& ec);
+
+
+/**
+ * @brief Check if the device, as identified by `FileInfo::device`, is a rotational
+ * disk. Available on Linux only, where it is taken from the block device queue in
+ * the sysfs. Partitions report the queue of their disk.
+ *
+ * @return The answer, or nothing if it can't be determined, e.g. for network file
+ *         systems
+ */
+std::optional<bool> rotationalDevice(uint64_t device);
+
+
+/**
+ * @brief Physical offset of the first extent of the file on its device, as reported
+ * by the FIEMAP ioctl. Available on Linux only.
+ *
+ * @return The offset, or nothing if the file system doesn't report it, e.g. for
+ *         empty files, inline data or not yet allocated blocks
+ */
+std::optional<uint64_t> physicalOffset(const fs::path& file);
+
+
 /**
  * @brief  Constructs path with unique name, taking into account provided prefix and
  * temp directory. It will create path object only, the underlying path will not be
@@ -144,6 +193,17 @@ public:
 };
 
 
+/**
+ * @brief Check if the path matches any of the given rules
+ *
+ * @param path The path to be checked
+ * @param rules Regular expressions searched in the path
+ *
+ * @return true if at least one rule matches, otherwise false
+ */
+bool shouldExclude(const fs::path& path, const std::vector<std::regex>& rules);
+
+
 using PathCallback = std::function<void(const fs::path&, const std::error_code&)>;
 
 /**
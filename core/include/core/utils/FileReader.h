@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+namespace core::file {
+
+/**
+ * @brief A contiguous range of bytes inside a file
+ */
+struct ByteRange
+{
+    uint64_t offset {};
+    uint64_t length {};
+};
+
+struct ReaderOptions
+{
+    // Size of the chunks passed to the consumer, rounded up to the alignment
+    size_t bufferSize {1024 * 1024};
+
+    // Ranges of at least that many bytes are memory mapped instead of read into the
+    // buffer, 0 disables the mapping. A mapped file truncated while it is read raises
+    // SIGBUS, so the mapping suits only the files nobody else writes.
+    uint64_t mapThreshold {0};
+
+    // Ask the kernel to evict the pages that were read, so that scanning huge trees
+    // doesn't push the data of other processes out of the page cache
+    bool dropCache {true};
+};
+
+/**
+ * @brief Receives the file contents chunk by chunk. The data is valid only during
+ * the call.
+ */
+using ChunkCallback = std::function<void(std::string_view)>;
+
+/**
+ * @brief Numbers of the files opened and the read calls issued, together with the
+ * bytes they returned
+ */
+struct IoCounters
+{
+    uint64_t opens {};
+    uint64_t reads {};
+    uint64_t bytes {};
+};
+
+/**
+ * @brief Totals of the readers of the process since it started. A mapped range
+ * counts as a single read.
+ */
+IoCounters ioCounters() noexcept;
+
+/**
+ * @brief Add to the totals, for the files read by other means than the readers
+ */
+void countIo(const IoCounters& io) noexcept;
+
+/**
+ * @brief Streams byte ranges of files in large chunks
+ *
+ * The ranges are read with `pread` into an aligned buffer, which is reused between
+ * the calls, the kernel is advised of the sequential access. Large ranges can be
+ * memory mapped instead, see `ReaderOptions::mapThreshold`. A reader is not thread
+ * safe, every thread should have its own.
+ */
+class FileReader
+{
+public:
+    static constexpr size_t ALIGNMENT = 4096;
+
+    explicit FileReader(ReaderOptions opts = {});
+
+    const ReaderOptions& options() const noexcept;
+
+    /**
+     * @brief Read the given ranges of the file in the given order. The part of a
+     * range past the end of the file is ignored.
+     *
+     * @param file The file to be read
+     * @param ranges The ranges to be read
+     * @param cb Invoked with the consecutive chunks of the ranges
+     *
+     * @throw std::system_error if the file can't be opened or read
+     */
+    void read(const fs::path& file,
+              std::span<const ByteRange> ranges,
+              const ChunkCallback& cb);
+
+    /**
+     * @brief Same as above, for the whole file
+     */
+    void read(const fs::path& file, const ChunkCallback& cb);
+
+private:
+    struct AlignedDelete
+    {
+        void operator()(char* ptr) const noexcept;
+    };
+
+    ReaderOptions opts_;
+
+    // Allocated on the first use
+    std::unique_ptr<char[], AlignedDelete> buffer_;
+
+    char* buffer();
+};
+
+/**
+ * @brief Reads the blocks of a single file at the requested offsets with `pread`
+ * into an aligned buffer of its own, the file stays open between the reads. Unlike
+ * the chunks of `FileReader`, the block stays valid until the next read, so the
+ * blocks of several files can be compared with each other.
+ */
+class BlockReader
+{
+public:
+    /**
+     * @brief Open the file, the blocks are at most `ReaderOptions::bufferSize`
+     * bytes long, the mapping is never used
+     *
+     * @throw std::system_error if the file can't be opened
+     */
+    explicit BlockReader(const fs::path& file, ReaderOptions opts = {});
+
+    BlockReader(BlockReader&&) noexcept;
+    BlockReader& operator=(BlockReader&&) noexcept;
+    ~BlockReader();
+
+    const ReaderOptions& options() const noexcept;
+
+    /**
+     * @brief Read the block of `length` bytes at `offset`, the length is capped by the
+     * buffer size. The block is shorter only at the end of the file.
+     *
+     * @throw std::system_error if the file can't be read
+     */
+    std::string_view read(uint64_t offset, size_t length);
+
+private:
+    struct File;
+
+    ReaderOptions opts_;
+    std::unique_ptr<File> file_;
+};
+
+} // namespace core::file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace core::file {
+
+/**
+ * @brief Matches paths against a set of ECMAScript regular expressions, with the
+ * same result as `std::regex_search` of every expression on the path string
+ *
+ * The patterns of the common shapes are compiled into cheaper structures:
+ *
+ *   - literal suffixes, e.g. `\.(log|zip)$`, are looked up in a hash set
+ *   - literal path components, e.g. `/node_modules/` or `/build$`, are looked up
+ *     in a trie of components
+ *
+ * The remaining patterns are combined into a single regular expression.
+ */
+class PathMatcher
+{
+public:
+    PathMatcher() = default;
+
+    /**
+     * @brief Compile the given patterns
+     *
+     * @throw std::regex_error if a pattern is not a valid regular expression
+     */
+    explicit PathMatcher(const std::vector<std::string>& patterns);
+
+    bool empty() const noexcept;
+
+    /**
+     * @brief Check if the path matches any of the patterns
+     */
+    bool matches(const fs::path& path) const;
+
+    /**
+     * @brief Check if all the paths below the directory match, so that the
+     * directory doesn't need to be entered. The directory itself might not match.
+     */
+    bool prunable(const fs::path& dir) const;
+
+private:
+    struct StringHash
+    {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view str) const noexcept
+        {
+            return std::hash<std::string_view> {}(str);
+        }
+    };
+
+    using StringSet = std::unordered_set<std::string, StringHash, std::equal_to<>>;
+
+    template <typename T>
+    using StringMap = std::unordered_map<std::string, T, StringHash, std::equal_to<>>;
+
+    struct TrieNode
+    {
+        StringMap<uint32_t> children;
+
+        // The components up to this node followed by a separator, `/name/`
+        bool inner {false};
+
+        // The components up to this node ending the path, `/name$`
+        bool last {false};
+    };
+
+    StringSet suffixes_;
+    std::vector<size_t> suffixLengths_;
+    std::vector<TrieNode> trie_;
+    std::vector<std::regex> regexes_;
+
+    bool addSuffixes(std::string_view pattern);
+    bool addComponents(std::string_view pattern);
+    bool matchComponents(std::string_view path, bool prune) const;
+};
+
+} // namespace core::file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <filesystem>
 
 namespace fs = std::filesystem;
@@ -48,4 +49,27 @@ size_t processMemoryUsage(uint32_t pid);
  */
 size_t currentProcessMemoryUsage();
 
+/**
+ * @brief Returns the largest number of bytes occupied by the current process since
+ * it started or since the peak was reset
+ *
+ * @return Peak memory in bytes, 0 if not available
+ */
+size_t currentProcessPeakMemoryUsage();
+
+/**
+ * @brief Let the peak memory usage of the current process start over from its
+ * current usage, supported on Linux only
+ *
+ * @return true if the peak is reset, otherwise false
+ */
+bool resetPeakMemoryUsage();
+
+/**
+ * @brief Returns the CPU time spent by all the threads of the current process
+ *
+ * @return User and system time since the process started, 0 if not available
+ */
+std::chrono::nanoseconds currentProcessCpuTime() noexcept;
+
 } // namespace core::sys
\ No newline at end of file
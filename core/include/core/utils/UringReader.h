@@ -0,0 +1,104 @@
+#pragma once
+
+#include <core/utils/FileReader.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace core::file {
+
+/**
+ * @brief A file and its byte ranges to be read
+ */
+struct ReadRequest
+{
+    fs::path path {};
+    std::vector<ByteRange> ranges {};
+};
+
+struct UringOptions
+{
+    // Number of reads in flight, each of them has its own buffer
+    unsigned depth {32};
+
+    // Size of the chunks passed to the consumer, rounded up to the alignment
+    size_t bufferSize {1024 * 1024};
+
+    // Ask the kernel to evict the pages that were read, see `ReaderOptions`
+    bool dropCache {true};
+};
+
+/**
+ * @brief Provides the request with the given index, invoked once per request just
+ * before it is started
+ */
+using RequestSource = std::function<ReadRequest(size_t index)>;
+
+/**
+ * @brief Receives the contents of the request with the given index. The chunks of a
+ * request arrive in order, chunks of different requests interleave.
+ */
+using RequestChunkCallback = std::function<void(size_t index, std::string_view)>;
+
+/**
+ * @brief Invoked once the request with the given index is finished, with the error
+ * which stopped it, if any
+ */
+using RequestDoneCallback =
+    std::function<void(size_t index, const std::error_code& ec)>;
+
+/**
+ * @brief Reads many files concurrently through io_uring (Linux only)
+ *
+ * Every request has at most one read in flight, up to `UringOptions::depth`
+ * requests are read at a time. All the callbacks are invoked on the thread that
+ * called `read`. The backend is compiled in with the `CORE_WITH_IO_URING`
+ * definition, callers are expected to fall back to `FileReader` when it is not
+ * supported.
+ */
+class UringReader
+{
+public:
+    /**
+     * @brief Check if the backend is compiled in and permitted by the kernel
+     */
+    static bool supported() noexcept;
+
+    /**
+     * @throw std::system_error if the ring can't be created
+     */
+    explicit UringReader(UringOptions opts = {});
+
+    UringReader(const UringReader&) = delete;
+    UringReader& operator=(const UringReader&) = delete;
+    ~UringReader();
+
+    const UringOptions& options() const noexcept;
+
+    /**
+     * @brief Read the requests with indices [0, count). The part of a range past
+     * the end of the file is ignored.
+     *
+     * @throw Rethrows exceptions of the callbacks once all reads in flight are
+     *        completed, std::system_error if the ring fails
+     */
+    void read(size_t count,
+              const RequestSource& source,
+              const RequestChunkCallback& chunk,
+              const RequestDoneCallback& done);
+
+private:
+    struct Ring;
+
+    UringOptions opts_;
+    std::unique_ptr<Ring> ring_;
+};
+
+} // namespace core::file
@@ -1,21 +1,31 @@
 #include <core/utils/Crypto.h>
-#include <core/utils/FmtExt.h>
 
 #include <openssl/evp.h>
 #include <openssl/sha.h>
 #include <openssl/md5.h>
 
-#include <fstream>
 #include <cassert>
 #include <array>
 #include <span>
 #include <format>
 #include <utility>
+#include <limits>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <variant>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 
 namespace core::crypto {
 namespace {
-void hexadecimal(std::span<unsigned char> hash, std::string& out)
+void hexadecimal(std::span<const unsigned char> hash, std::string& out)
 {
     out.clear();
     out.reserve(hash.size() * 2);
@@ -36,8 +46,315 @@ void hexadecimal(std::span<unsigned char> hash, std::string& out)
         throw std::runtime_error(std::string("Hex formatting error: ") + e.what());
     }
 }
+
+/**
+ * @brief Streaming MurmurHash3 x64 128 with zero seed. The output matches the
+ * reference implementation on little endian hosts.
+ */
+class Murmur3Hasher
+{
+public:
+    void update(std::string_view data) noexcept
+    {
+        const auto* p = reinterpret_cast<const unsigned char*>(data.data());
+        size_t size = data.size();
+        length_ += size;
+
+        if (tailSize_ > 0)
+        {
+            const auto count = std::min(size, BLOCK_SIZE - tailSize_);
+            std::memcpy(tail_.data() + tailSize_, p, count);
+            tailSize_ += count;
+            p += count;
+            size -= count;
+
+            if (tailSize_ < BLOCK_SIZE)
+            {
+                return;
+            }
+
+            block(tail_.data());
+            tailSize_ = 0;
+        }
+
+        for (; size >= BLOCK_SIZE; p += BLOCK_SIZE, size -= BLOCK_SIZE)
+        {
+            block(p);
+        }
+
+        std::memcpy(tail_.data(), p, size);
+        tailSize_ = size;
+    }
+
+    void final(Digest& out) noexcept
+    {
+        uint64_t k1 = 0;
+        uint64_t k2 = 0;
+
+        for (size_t i = tailSize_; i > 8; --i)
+        {
+            k2 = (k2 << 8) | tail_[i - 1];
+        }
+
+        for (size_t i = std::min<size_t>(tailSize_, 8); i > 0; --i)
+        {
+            k1 = (k1 << 8) | tail_[i - 1];
+        }
+
+        if (tailSize_ > 8)
+        {
+            h2_ ^= std::rotl(k2 * C2, 33) * C1;
+        }
+
+        if (tailSize_ > 0)
+        {
+            h1_ ^= std::rotl(k1 * C1, 31) * C2;
+        }
+
+        h1_ ^= length_;
+        h2_ ^= length_;
+        h1_ += h2_;
+        h2_ += h1_;
+        h1_ = fmix(h1_);
+        h2_ = fmix(h2_);
+        h1_ += h2_;
+        h2_ += h1_;
+
+        out = {};
+        store(h1_, out.data());
+        store(h2_, out.data() + 8);
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 16;
+    static constexpr uint64_t C1 = 0x87c37b91114253d5ULL;
+    static constexpr uint64_t C2 = 0x4cf5ad432745937fULL;
+
+    std::array<unsigned char, BLOCK_SIZE> tail_ {};
+    uint64_t h1_ {0};
+    uint64_t h2_ {0};
+    uint64_t length_ {0};
+    size_t tailSize_ {0};
+
+    static uint64_t load(const unsigned char* p) noexcept
+    {
+        uint64_t v = 0;
+        std::memcpy(&v, p, sizeof(v));
+
+        if constexpr (std::endian::native == std::endian::big)
+        {
+            v = std::byteswap(v);
+        }
+
+        return v;
+    }
+
+    static void store(uint64_t v, unsigned char* p) noexcept
+    {
+        for (size_t i = 0; i < 8; ++i, v >>= 8)
+        {
+            p[i] = static_cast<unsigned char>(v);
+        }
+    }
+
+    static uint64_t fmix(uint64_t k) noexcept
+    {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+
+        return k;
+    }
+
+    void block(const unsigned char* p) noexcept
+    {
+        const uint64_t k1 = load(p);
+        const uint64_t k2 = load(p + 8);
+
+        h1_ ^= std::rotl(k1 * C1, 31) * C2;
+        h1_ = std::rotl(h1_, 27) + h2_;
+        h1_ = h1_ * 5 + 0x52dce729;
+
+        h2_ ^= std::rotl(k2 * C2, 33) * C1;
+        h2_ = std::rotl(h2_, 31) + h1_;
+        h2_ = h2_ * 5 + 0x38495ab5;
+    }
+};
+
+template <typename Hasher>
+Digest digestFile(file::FileReader& reader,
+                  const fs::path& file,
+                  std::span<const ByteRange> ranges)
+{
+    Hasher hasher;
+
+    reader.read(file, ranges, [&hasher](std::string_view chunk) {
+        hasher.update(chunk);
+    });
+
+    Digest out {};
+    hasher.final(out);
+
+    return out;
+}
+
+/**
+ * @brief Part of the selected ranges between the given offsets of their stream
+ */
+std::vector<ByteRange> sliceRanges(std::span<const ByteRange> ranges,
+                                   uint64_t begin,
+                                   uint64_t end)
+{
+    std::vector<ByteRange> slice;
+    uint64_t offset = 0;
+
+    for (const auto& range : ranges)
+    {
+        const auto first = std::max(begin, offset);
+        const auto last = std::min(end, offset + range.length);
+
+        if (first < last)
+        {
+            slice.push_back({range.offset + first - offset, last - first});
+        }
+
+        offset += range.length;
+        if (offset >= end)
+        {
+            break;
+        }
+    }
+
+    return slice;
+}
+
+template <typename Hasher>
+Digest treeDigest(const fs::path& file,
+                  std::span<const ByteRange> ranges,
+                  const TreeOptions& opts)
+{
+    if (opts.chunkBytes == 0)
+    {
+        throw std::invalid_argument("The chunk size of a tree digest can't be 0");
+    }
+
+    // The parts past the end of the file are dropped upfront, so that the chunks
+    // are known before reading
+    const uint64_t size = fs::file_size(file);
+    std::vector<ByteRange> selected;
+    uint64_t total = 0;
+
+    for (const auto& range : ranges)
+    {
+        if (range.offset < size && range.length > 0)
+        {
+            const auto length = std::min(range.length, size - range.offset);
+            selected.push_back({range.offset, length});
+            total += length;
+        }
+    }
+
+    // An empty selection is a single empty chunk
+    const auto numChunks =
+        std::max<uint64_t>(1, (total + opts.chunkBytes - 1) / opts.chunkBytes);
+    std::vector<Digest> leaves(numChunks);
+    std::atomic<uint64_t> next {0};
+    std::atomic<bool> failed {false};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto work = [&]() {
+        file::FileReader reader({.bufferSize = opts.bufferSize});
+
+        for (auto k = next++; k < numChunks && !failed; k = next++)
+        {
+            try
+            {
+                const auto begin = k * opts.chunkBytes;
+                const auto end = std::min(total, begin + opts.chunkBytes);
+                const auto slice = sliceRanges(selected, begin, end);
+
+                leaves[k] = digestFile<Hasher>(reader, file, slice);
+            }
+            catch (...)
+            {
+                const std::lock_guard lock(errorMutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                failed = true;
+            }
+        }
+    };
+
+    const uint64_t workers =
+        opts.workers ? opts.workers : std::thread::hardware_concurrency();
+    const auto numThreads = std::clamp<uint64_t>(workers, 1, numChunks);
+
+    if (numThreads == 1)
+    {
+        work();
+    }
+    else
+    {
+        std::vector<std::jthread> threads;
+        for (uint64_t i = 0; i < numThreads; ++i)
+        {
+            threads.emplace_back(work);
+        }
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    Hasher root;
+    const auto leafSize = sizeof(Digest);
+
+    for (const auto& leaf : leaves)
+    {
+        root.update({reinterpret_cast<const char*>(leaf.data()), leafSize});
+    }
+
+    Digest out {};
+    root.final(out);
+
+    return out;
+}
+
+/**
+ * @brief Reader with the default options, the buffer is reused by all the digests
+ * calculated on the calling thread
+ */
+file::FileReader& threadReader()
+{
+    thread_local file::FileReader reader;
+
+    return reader;
+}
+
 } // namespace
 
+size_t DigestHash::operator()(const Digest& digest) const noexcept
+{
+    size_t value = 0;
+    std::memcpy(&value, digest.data(), sizeof(value));
+
+    return value;
+}
+
+std::string toHex(std::span<const uint8_t> bytes)
+{
+    std::string out;
+    hexadecimal(bytes, out);
+
+    return out;
+}
+
 void sha256(const std::string_view data, std::string& out)
 {
     std::array<unsigned char, SHA256_DIGEST_LENGTH> hash {};
@@ -58,7 +375,7 @@ void md5(std::string_view data, std::string& out)
 {
     uint32_t mdLen = 0;
     std::array<unsigned char, MD5_DIGEST_LENGTH> hash {};
-    const EVP_MD* md = EVP_get_digestbyname("MD5");
+    const EVP_MD* md = EVP_md5();
 
     if (!md)
     {
@@ -105,48 +422,184 @@ std::string md5(std::string_view data)
 
 std::string fileSha256(const fs::path& file)
 {
-    std::ifstream in(file, std::ios::in | std::ios::binary);
+    const std::array range {ByteRange {0, std::numeric_limits<uint64_t>::max()}};
+
+    return fileSha256(file, range);
+}
 
-    if (!in)
+Sha256Hasher::Sha256Hasher()
+    : ctx_(EVP_MD_CTX_new(), &EVP_MD_CTX_free)
+{
+    // EVP_sha256 returns a static object, unlike EVP_get_digestbyname it doesn't
+    // search the algorithms table
+    if (!ctx_ || EVP_DigestInit_ex(ctx_.get(), EVP_sha256(), nullptr) != 1)
     {
-        const auto s = std::format("Unable to open file: {}", file);
-        throw std::system_error(
-            std::make_error_code(std::errc::no_such_file_or_directory),
-            s);
+        throw std::runtime_error("Failed to initialize SHA256 digest");
     }
+}
 
-    constexpr const std::size_t bufferSize {static_cast<unsigned long long>(1UL)
-                                            << 12};
-    std::array<char, bufferSize> buffer {};
-    std::array<unsigned char, EVP_MAX_MD_SIZE> hash {};
-
-    std::unique_ptr<EVP_MD_CTX, void (*)(EVP_MD_CTX* ctx)> ctx(EVP_MD_CTX_new(),
-                                                               EVP_MD_CTX_free);
+Sha256Hasher::Sha256Hasher(const Sha256Hasher& other)
+    : ctx_(EVP_MD_CTX_new(), &EVP_MD_CTX_free)
+{
+    if (!ctx_ || EVP_MD_CTX_copy_ex(ctx_.get(), other.ctx_.get()) != 1)
+    {
+        throw std::runtime_error("Failed to copy SHA256 digest");
+    }
+}
 
-    const EVP_MD* md = EVP_get_digestbyname("sha256");
-    EVP_DigestInit_ex(ctx.get(), md, nullptr);
+Sha256Hasher::Sha256Hasher(Sha256Hasher&&) noexcept = default;
+Sha256Hasher& Sha256Hasher::operator=(Sha256Hasher&&) noexcept = default;
+Sha256Hasher::~Sha256Hasher() = default;
 
-    while (in)
+void Sha256Hasher::update(std::string_view data)
+{
+    if (EVP_DigestUpdate(ctx_.get(), data.data(), data.size()) != 1)
     {
-        in.read(buffer.data(), bufferSize);
-        if (!EVP_DigestUpdate(ctx.get(),
-                              buffer.data(),
-                              static_cast<size_t>(in.gcount())))
-        {
-            throw std::runtime_error("Digest update failed");
-        }
+        throw std::runtime_error("Digest update failed");
     }
+}
 
+void Sha256Hasher::final(Digest& out)
+{
+    static_assert(sizeof(Digest) == SHA256_DIGEST_LENGTH);
     uint32_t mdLen = 0;
-    EVP_DigestFinal_ex(ctx.get(), hash.data(), &mdLen);
-    in.close();
 
+    if (EVP_DigestFinal_ex(ctx_.get(), out.data(), &mdLen) != 1)
+    {
+        throw std::runtime_error("Digest final failed");
+    }
+}
+
+void Sha256Hasher::final(std::string& out)
+{
+    Digest hash {};
+    final(hash);
+    hexadecimal(std::span(hash), out);
+}
+
+std::string fileSha256(const fs::path& file, std::span<const ByteRange> ranges)
+{
+    return toHex(digestFile<Sha256Hasher>(threadReader(), file, ranges));
+}
+
+void fastHash128(std::string_view data, std::string& out)
+{
+    Murmur3Hasher hasher;
+    Digest hash {};
+
+    hasher.update(data);
+    hasher.final(hash);
+    hexadecimal(std::span(hash).first(digestSize(DigestType::Fast128)), out);
+}
+
+std::string fastHash128(std::string_view data)
+{
     std::string out;
-    hexadecimal(std::span(hash.data(), mdLen), out);
+    fastHash128(data, out);
 
     return out;
 }
 
+size_t digestSize(DigestType type) noexcept
+{
+    return type == DigestType::Fast128 ? 16 : SHA256_DIGEST_LENGTH;
+}
+
+struct DigestHasher::Impl
+{
+    std::variant<Murmur3Hasher, Sha256Hasher> hasher;
+};
+
+DigestHasher::DigestHasher(DigestType type)
+    : impl_(type == DigestType::Fast128 ? std::make_unique<Impl>(Murmur3Hasher {})
+                                        : std::make_unique<Impl>(Sha256Hasher {}))
+{
+}
+
+DigestHasher::DigestHasher(DigestHasher&&) noexcept = default;
+DigestHasher& DigestHasher::operator=(DigestHasher&&) noexcept = default;
+DigestHasher::~DigestHasher() = default;
+
+void DigestHasher::update(std::string_view data)
+{
+    std::visit(
+        [data](auto& hasher) {
+            hasher.update(data);
+        },
+        impl_->hasher);
+}
+
+void DigestHasher::final(Digest& out)
+{
+    std::visit(
+        [&out](auto& hasher) {
+            hasher.final(out);
+        },
+        impl_->hasher);
+}
+
+Digest fileDigest(const fs::path& file, DigestType type)
+{
+    const std::array range {ByteRange {0, std::numeric_limits<uint64_t>::max()}};
+
+    return fileDigest(file, type, range);
+}
+
+Digest fileDigest(const fs::path& file,
+                  DigestType type,
+                  std::span<const ByteRange> ranges)
+{
+    return fileDigest(threadReader(), file, type, ranges);
+}
+
+Digest fileDigest(file::FileReader& reader, const fs::path& file, DigestType type)
+{
+    const std::array range {ByteRange {0, std::numeric_limits<uint64_t>::max()}};
+
+    return fileDigest(reader, file, type, range);
+}
+
+Digest fileDigest(file::FileReader& reader,
+                  const fs::path& file,
+                  DigestType type,
+                  std::span<const ByteRange> ranges)
+{
+    switch (type)
+    {
+        case DigestType::Fast128:
+            return digestFile<Murmur3Hasher>(reader, file, ranges);
+
+        case DigestType::Sha256:
+            return digestFile<Sha256Hasher>(reader, file, ranges);
+    }
+
+    throw std::invalid_argument("Unknown digest type");
+}
+
+Digest fileTreeDigest(const fs::path& file,
+                      DigestType type,
+                      std::span<const ByteRange> ranges,
+                      const TreeOptions& opts)
+{
+    switch (type)
+    {
+        case DigestType::Fast128:
+            return treeDigest<Murmur3Hasher>(file, ranges, opts);
+
+        case DigestType::Sha256:
+            return treeDigest<Sha256Hasher>(file, ranges, opts);
+    }
+
+    throw std::invalid_argument("Unknown digest type");
+}
+
+Digest fileTreeDigest(const fs::path& file, DigestType type, const TreeOptions& opts)
+{
+    const std::array range {ByteRange {0, std::numeric_limits<uint64_t>::max()}};
+
+    return fileTreeDigest(file, type, range, opts);
+}
+
 void encodeBase64(std::string_view byteSeq, std::string& base64Seq)
 {
     const auto len = 4 * ((byteSeq.size() + 2) / 3);
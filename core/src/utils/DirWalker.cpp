@@ -0,0 +1,648 @@
+#include <core/utils/DirWalker.h>
+
+#ifndef _WIN32
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #ifdef __linux__
+        #include <sys/sysmacros.h>
+    #endif
+    #include <cerrno>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+namespace core::file {
+namespace {
+
+struct Listing
+{
+    fs::path dir;
+    std::vector<WalkEntry> entries;
+
+    // Listings of the subdirectories in the order of the entries, kept only by the
+    // deterministic walk
+    std::vector<std::shared_ptr<Listing>> children;
+    std::error_code ec;
+    bool done {false};
+};
+
+using ListingPtr = std::shared_ptr<Listing>;
+
+struct WorkQueue
+{
+    std::mutex mutex;
+    std::deque<ListingPtr> listings;
+};
+
+/**
+ * @brief Identities of the entered directories, used to break the cycles when the
+ * symbolic links are followed
+ */
+class Visited
+{
+public:
+    bool insert(const FileInfo& info)
+    {
+        const std::lock_guard lock(mutex_);
+        return dirs_.emplace(info.device, info.inode).second;
+    }
+
+private:
+    std::mutex mutex_;
+    std::set<std::pair<uint64_t, uint64_t>> dirs_;
+};
+
+#ifdef _WIN32
+
+EntryType fromStatus(const fs::file_status& status) noexcept
+{
+    switch (status.type())
+    {
+        case fs::file_type::regular:
+            return EntryType::Regular;
+        case fs::file_type::directory:
+            return EntryType::Directory;
+        case fs::file_type::symlink:
+            return EntryType::Symlink;
+        case fs::file_type::none:
+        case fs::file_type::not_found:
+        case fs::file_type::unknown:
+            return EntryType::Unknown;
+        default:
+            return EntryType::Other;
+    }
+}
+
+void list(Listing& listing, const WalkOptions& opts, Visited& visited)
+{
+    const bool follow = opts.symlinks == SymlinkPolicy::Follow;
+    std::error_code ec;
+
+    for (fs::directory_iterator it(listing.dir, ec), end; !ec && it != end;
+         it.increment(ec))
+    {
+        WalkEntry entry {.path = it->path()};
+
+        if (opts.exclusions.matches(entry.path))
+        {
+            if (opts.reportExcluded)
+            {
+                entry.excluded = true;
+                listing.entries.push_back(std::move(entry));
+            }
+            continue;
+        }
+
+        // The status is cached by the iterator, no extra system call is needed
+        std::error_code statusEc;
+        entry.type = fromStatus(follow ? it->status(statusEc)
+                                       : it->symlink_status(statusEc));
+
+        if (opts.stat || (follow && entry.type == EntryType::Directory))
+        {
+            FileInfo info;
+
+            if (fileInfo(entry.path, info, statusEc))
+            {
+                if (follow && entry.type == EntryType::Directory &&
+                    !visited.insert(info))
+                {
+                    continue;
+                }
+
+                if (opts.stat)
+                {
+                    entry.info = info;
+                }
+            }
+        }
+
+        if (entry.type == EntryType::Symlink && opts.symlinks == SymlinkPolicy::Skip)
+        {
+            continue;
+        }
+
+        entry.pruned = entry.type == EntryType::Directory &&
+                       opts.exclusions.prunable(entry.path);
+
+        listing.entries.push_back(std::move(entry));
+    }
+
+    listing.ec = ec;
+}
+
+#else
+
+EntryType fromMode(mode_t mode) noexcept
+{
+    if (S_ISREG(mode))
+    {
+        return EntryType::Regular;
+    }
+
+    if (S_ISDIR(mode))
+    {
+        return EntryType::Directory;
+    }
+
+    if (S_ISLNK(mode))
+    {
+        return EntryType::Symlink;
+    }
+
+    return EntryType::Other;
+}
+
+EntryType fromDirent(unsigned char type) noexcept
+{
+    switch (type)
+    {
+        case DT_REG:
+            return EntryType::Regular;
+        case DT_DIR:
+            return EntryType::Directory;
+        case DT_LNK:
+            return EntryType::Symlink;
+        case DT_UNKNOWN:
+            return EntryType::Unknown;
+        default:
+            return EntryType::Other;
+    }
+}
+
+/**
+ * @brief Query the metadata of an entry relative to the directory, which saves the
+ * resolution of the full path
+ */
+bool statAt(int dirFd, const char* name, bool follow, FileInfo& info, EntryType& type)
+{
+    const int flags = follow ? 0 : AT_SYMLINK_NOFOLLOW;
+
+    #if defined(__linux__) && defined(STATX_TYPE)
+    constexpr unsigned int mask = STATX_TYPE | STATX_MODE | STATX_INO | STATX_NLINK |
+                                  STATX_SIZE | STATX_MTIME;
+    struct statx stx {};
+
+    if (::statx(dirFd, name, flags | AT_NO_AUTOMOUNT, mask, &stx) != 0)
+    {
+        return false;
+    }
+
+    info.device = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+    info.inode = stx.stx_ino;
+    info.size = stx.stx_size;
+    info.links = stx.stx_nlink;
+    info.mtime = static_cast<int64_t>(stx.stx_mtime.tv_sec) * 1'000'000'000 +
+                 stx.stx_mtime.tv_nsec;
+    type = fromMode(stx.stx_mode);
+    #else
+    struct stat st {};
+
+    if (::fstatat(dirFd, name, &st, flags) != 0)
+    {
+        return false;
+    }
+
+        #ifdef __APPLE__
+    const auto& mtime = st.st_mtimespec;
+        #else
+    const auto& mtime = st.st_mtim;
+        #endif
+
+    info.device = static_cast<uint64_t>(st.st_dev);
+    info.inode = static_cast<uint64_t>(st.st_ino);
+    info.size = static_cast<uint64_t>(st.st_size);
+    info.links = static_cast<uint64_t>(st.st_nlink);
+    info.mtime = static_cast<int64_t>(mtime.tv_sec) * 1'000'000'000 + mtime.tv_nsec;
+    type = fromMode(st.st_mode);
+    #endif
+
+    return true;
+}
+
+void list(Listing& listing, const WalkOptions& opts, Visited& visited)
+{
+    DIR* dir = ::opendir(listing.dir.c_str());
+
+    if (dir == nullptr)
+    {
+        listing.ec.assign(errno, std::generic_category());
+        return;
+    }
+
+    const std::unique_ptr<DIR, int (*)(DIR*)> guard(dir, &::closedir);
+    const int fd = ::dirfd(dir);
+    const bool follow = opts.symlinks == SymlinkPolicy::Follow;
+
+    while (true)
+    {
+        errno = 0;
+        const dirent* de = ::readdir(dir);
+
+        if (de == nullptr)
+        {
+            if (errno != 0)
+            {
+                listing.ec.assign(errno, std::generic_category());
+            }
+            break;
+        }
+
+        const std::string_view name(de->d_name);
+
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+
+        WalkEntry entry {.path = listing.dir / name, .type = fromDirent(de->d_type)};
+
+        if (opts.exclusions.matches(entry.path))
+        {
+            if (opts.reportExcluded)
+            {
+                entry.excluded = true;
+                listing.entries.push_back(std::move(entry));
+            }
+            continue;
+        }
+
+        // The type from the listing is enough, unless the file system doesn't provide
+        // it or the links are followed, the identity of the directories is needed to
+        // break the cycles then
+        const bool resolve = entry.type == EntryType::Unknown ||
+                             (follow && (entry.type == EntryType::Symlink ||
+                                         entry.type == EntryType::Directory));
+
+        if (opts.stat || resolve)
+        {
+            FileInfo info;
+            EntryType type {};
+
+            // A dangling link keeps its type
+            if (statAt(fd, de->d_name, follow, info, type))
+            {
+                if (follow && type == EntryType::Directory && !visited.insert(info))
+                {
+                    continue;
+                }
+
+                entry.type = type;
+                if (opts.stat)
+                {
+                    entry.info = info;
+                }
+            }
+        }
+
+        if (entry.type == EntryType::Symlink && opts.symlinks == SymlinkPolicy::Skip)
+        {
+            continue;
+        }
+
+        entry.pruned = entry.type == EntryType::Directory &&
+                       opts.exclusions.prunable(entry.path);
+
+        listing.entries.push_back(std::move(entry));
+    }
+}
+
+#endif
+
+/**
+ * @brief State of a single walk, shared by the workers and the calling thread
+ */
+class Walk
+{
+public:
+    Walk(const WalkOptions& opts, const WalkCallback& cb)
+        : opts_ {opts}
+        , cb_ {cb}
+        , queues_(opts.threads ? opts.threads
+                               : std::max(1U, std::thread::hardware_concurrency()))
+    {
+    }
+
+    void run(const fs::path& dir)
+    {
+        auto root = std::make_shared<Listing>();
+        root->dir = dir;
+
+        if (opts_.symlinks == SymlinkPolicy::Follow)
+        {
+            FileInfo info;
+            std::error_code ec;
+
+            if (fileInfo(dir, info, ec))
+            {
+                visited_.insert(info);
+            }
+        }
+
+        pending_ = 1;
+        queued_ = 1;
+        queues_.front().listings.push_back(root);
+
+        std::vector<std::jthread> workers;
+
+        // Declared after the workers, so that they are stopped before being joined,
+        // also when the callback throws
+        const Stopper stopper {*this};
+
+        for (size_t i = 0; i < queues_.size(); ++i)
+        {
+            workers.emplace_back([this, i] {
+                work(i);
+            });
+        }
+
+        if (opts_.deterministic)
+        {
+            emitOrdered(root);
+        }
+        else
+        {
+            root.reset();
+            emitCompleted();
+        }
+    }
+
+private:
+    struct Stopper
+    {
+        Walk& walk;
+
+        ~Stopper()
+        {
+            walk.stop();
+        }
+    };
+
+    const WalkOptions& opts_;
+    const WalkCallback& cb_;
+    std::vector<WorkQueue> queues_;
+    Visited visited_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<ListingPtr> completed_;
+
+    // Listings created but not finished yet and the ones waiting in the queues
+    size_t pending_ {0};
+    size_t queued_ {0};
+
+    // Set under the mutex, read without it by the busy workers as well
+    std::atomic<bool> stop_ {false};
+
+    void stop()
+    {
+        {
+            const std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+
+        cv_.notify_all();
+    }
+
+    void work(size_t id)
+    {
+        // The walk is abandoned once the callback throws, the listings left are
+        // never reported
+        while (!stop_)
+        {
+            ListingPtr listing = take(id);
+
+            if (!listing)
+            {
+                std::unique_lock lock(mutex_);
+                cv_.wait(lock, [this] {
+                    return stop_ || pending_ == 0 || queued_ > 0;
+                });
+
+                if (stop_ || pending_ == 0)
+                {
+                    return;
+                }
+                continue;
+            }
+
+            try
+            {
+                list(*listing, opts_, visited_);
+            }
+            catch (const std::system_error& error)
+            {
+                listing->ec = error.code();
+            }
+            catch (const std::exception&)
+            {
+                listing->ec = std::make_error_code(std::errc::io_error);
+            }
+
+            schedule(id, *listing);
+            finish(listing);
+        }
+    }
+
+    /**
+     * @brief Take a listing from the back of the own queue, which keeps the walk
+     * depth first, or steal one from the front of another queue
+     */
+    ListingPtr take(size_t id)
+    {
+        ListingPtr listing;
+
+        for (size_t i = 0; !listing && i < queues_.size(); ++i)
+        {
+            auto& queue = queues_[(id + i) % queues_.size()];
+            const std::lock_guard lock(queue.mutex);
+
+            if (!queue.listings.empty())
+            {
+                if (i == 0)
+                {
+                    listing = std::move(queue.listings.back());
+                    queue.listings.pop_back();
+                }
+                else
+                {
+                    listing = std::move(queue.listings.front());
+                    queue.listings.pop_front();
+                }
+            }
+        }
+
+        if (listing)
+        {
+            const std::lock_guard lock(mutex_);
+            --queued_;
+        }
+
+        return listing;
+    }
+
+    void schedule(size_t id, Listing& listing)
+    {
+        if (opts_.deterministic)
+        {
+            std::ranges::sort(listing.entries, [](const auto& a, const auto& b) {
+                return a.path < b.path;
+            });
+        }
+
+        std::vector<ListingPtr> children;
+
+        for (const auto& entry : listing.entries)
+        {
+            if (entry.type == EntryType::Directory && !entry.pruned && !entry.excluded)
+            {
+                auto& child = children.emplace_back(std::make_shared<Listing>());
+                child->dir = entry.path;
+            }
+        }
+
+        if (children.empty() || stop_)
+        {
+            return;
+        }
+
+        if (opts_.deterministic)
+        {
+            listing.children = children;
+        }
+
+        // Accounted before being queued, so the walk can't be seen as finished
+        {
+            const std::lock_guard lock(mutex_);
+            pending_ += children.size();
+            queued_ += children.size();
+        }
+
+        {
+            // Reversed, so the first subdirectory is taken first
+            auto& queue = queues_[id];
+            const std::lock_guard lock(queue.mutex);
+            queue.listings.insert(queue.listings.end(),
+                                  std::make_move_iterator(children.rbegin()),
+                                  std::make_move_iterator(children.rend()));
+        }
+
+        cv_.notify_all();
+    }
+
+    void finish(const ListingPtr& listing)
+    {
+        {
+            const std::lock_guard lock(mutex_);
+            listing->done = true;
+            --pending_;
+
+            if (!opts_.deterministic)
+            {
+                completed_.push_back(listing);
+            }
+        }
+
+        cv_.notify_all();
+    }
+
+    void emit(const Listing& listing) const
+    {
+        for (const auto& entry : listing.entries)
+        {
+            cb_(entry, {});
+        }
+
+        if (listing.ec)
+        {
+            cb_({.path = listing.dir, .type = EntryType::Directory}, listing.ec);
+        }
+    }
+
+    void emitCompleted()
+    {
+        std::deque<ListingPtr> batch;
+
+        while (true)
+        {
+            {
+                std::unique_lock lock(mutex_);
+                cv_.wait(lock, [this] {
+                    return !completed_.empty() || pending_ == 0;
+                });
+
+                if (completed_.empty())
+                {
+                    return;
+                }
+
+                batch.swap(completed_);
+            }
+
+            for (const auto& listing : batch)
+            {
+                emit(*listing);
+            }
+            batch.clear();
+        }
+    }
+
+    void emitOrdered(const ListingPtr& listing)
+    {
+        {
+            std::unique_lock lock(mutex_);
+            cv_.wait(lock, [&listing] {
+                return listing->done;
+            });
+        }
+
+        size_t next = 0;
+
+        for (const auto& entry : listing->entries)
+        {
+            cb_(entry, {});
+
+            if (entry.type == EntryType::Directory && !entry.pruned && !entry.excluded)
+            {
+                // Released as soon as the subtree is reported
+                const ListingPtr child = std::move(listing->children[next++]);
+                emitOrdered(child);
+            }
+        }
+
+        if (listing->ec)
+        {
+            cb_({.path = listing->dir, .type = EntryType::Directory}, listing->ec);
+        }
+    }
+};
+
+} // namespace
+
+DirWalker::DirWalker(WalkOptions opts)
+    : opts_ {std::move(opts)}
+{
+}
+
+const WalkOptions& DirWalker::options() const noexcept
+{
+    return opts_;
+}
+
+void DirWalker::walk(const fs::path& dir, const WalkCallback& cb) const
+{
+    Walk walk(opts_, cb);
+    walk.run(dir);
+}
+
+} // namespace core::file
@@ -7,6 +7,24 @@
 
 #include <boost/iostreams/device/mapped_file.hpp>
 
+#ifdef _WIN32
+    #include <Windows.h>
+#else
+    #include <sys/stat.h>
+    #include <cerrno>
+#endif
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <linux/fiemap.h>
+    #include <linux/fs.h>
+    #include <sys/ioctl.h>
+    #include <sys/sysmacros.h>
+    #include <unistd.h>
+#endif
+
+#include <array>
+#include <cstring>
 #include <format>
 #include <filesystem>
 #include <fstream>
@@ -155,6 +173,144 @@ std::string path2s(const fs::path& path)
 }
 
 
+bool fileInfo(const fs::path& file, FileInfo& info, std::error_code& ec)
+{
+    ec.clear();
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileW(file.c_str(),
+                                FILE_READ_ATTRIBUTES,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr,
+                                OPEN_EXISTING,
+                                FILE_FLAG_BACKUP_SEMANTICS,
+                                nullptr);
+
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        ec.assign(static_cast<int>(GetLastError()), std::system_category());
+        return false;
+    }
+
+    BY_HANDLE_FILE_INFORMATION fi {};
+    const bool ok = GetFileInformationByHandle(handle, &fi) != FALSE;
+
+    if (!ok)
+    {
+        ec.assign(static_cast<int>(GetLastError()), std::system_category());
+    }
+    CloseHandle(handle);
+
+    if (!ok)
+    {
+        return false;
+    }
+
+    auto combine = [](DWORD high, DWORD low) {
+        return (static_cast<uint64_t>(high) << 32) | low;
+    };
+
+    // FILETIME counts 100ns intervals since 1601-01-01
+    constexpr int64_t epochDiff = 116'444'736'000'000'000LL;
+    const auto ticks = static_cast<int64_t>(
+        combine(fi.ftLastWriteTime.dwHighDateTime, fi.ftLastWriteTime.dwLowDateTime));
+
+    info.device = fi.dwVolumeSerialNumber;
+    info.inode = combine(fi.nFileIndexHigh, fi.nFileIndexLow);
+    info.size = combine(fi.nFileSizeHigh, fi.nFileSizeLow);
+    info.links = fi.nNumberOfLinks;
+    info.mtime = (ticks - epochDiff) * 100;
+#else
+    struct stat st {};
+
+    if (::stat(file.c_str(), &st) != 0)
+    {
+        ec.assign(errno, std::generic_category());
+        return false;
+    }
+
+    #ifdef __APPLE__
+    const auto& mtime = st.st_mtimespec;
+    #else
+    const auto& mtime = st.st_mtim;
+    #endif
+
+    info.device = static_cast<uint64_t>(st.st_dev);
+    info.inode = static_cast<uint64_t>(st.st_ino);
+    info.size = static_cast<uint64_t>(st.st_size);
+    info.links = static_cast<uint64_t>(st.st_nlink);
+    info.mtime = static_cast<int64_t>(mtime.tv_sec) * 1'000'000'000 + mtime.tv_nsec;
+#endif
+
+    return true;
+}
+
+
+std::optional<bool> rotationalDevice([[maybe_unused]] uint64_t device)
+{
+#ifdef __linux__
+    const auto dev = static_cast<dev_t>(device);
+    const auto link = std::format("/sys/dev/block/{}:{}", major(dev), minor(dev));
+
+    std::error_code ec;
+    const auto dir = fs::canonical(link, ec);
+
+    if (ec)
+    {
+        return std::nullopt;
+    }
+
+    // Partitions don't have a queue, it belongs to their disk
+    for (const auto& queue : {dir / "queue", dir.parent_path() / "queue"})
+    {
+        std::ifstream in(queue / "rotational");
+        int value = 0;
+
+        if (in >> value)
+        {
+            return value != 0;
+        }
+    }
+#endif
+
+    return std::nullopt;
+}
+
+
+std::optional<uint64_t> physicalOffset([[maybe_unused]] const fs::path& file)
+{
+#ifdef __linux__
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        return std::nullopt;
+    }
+
+    // The request is followed by the room for a single extent
+    alignas(fiemap) std::array<char, sizeof(fiemap) + sizeof(fiemap_extent)> buf {};
+    auto* map = reinterpret_cast<fiemap*>(buf.data());
+    map->fm_start = 0;
+    map->fm_length = FIEMAP_MAX_OFFSET;
+    map->fm_extent_count = 1;
+
+    const int rc = ::ioctl(fd, FS_IOC_FIEMAP, map);
+    ::close(fd);
+
+    fiemap_extent extent {};
+    std::memcpy(&extent, buf.data() + sizeof(fiemap), sizeof(extent));
+    constexpr auto unknown = FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DATA_INLINE;
+
+    if (rc == 0 && map->fm_mapped_extents > 0 && (extent.fe_flags & unknown) == 0)
+    {
+        return extent.fe_physical;
+    }
+#endif
+
+    return std::nullopt;
+}
+
+
 fs::path constructTempPath(std::string_view namePrefix, const fs::path& tempDir)
 {
     static std::atomic_uint64_t count = 0;
@@ -0,0 +1,477 @@
+#include <core/utils/FileReader.h>
+#include <core/utils/FmtExt.h>
+
+#ifdef _WIN32
+    #include <fstream>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <format>
+#include <limits>
+#include <new>
+#include <system_error>
+
+namespace core::file {
+namespace {
+
+std::atomic<uint64_t> numOpens {0};
+std::atomic<uint64_t> numReads {0};
+std::atomic<uint64_t> numBytes {0};
+
+uint64_t rangeEnd(const ByteRange& range) noexcept
+{
+    const auto length =
+        std::min(range.length, std::numeric_limits<uint64_t>::max() - range.offset);
+
+    return range.offset + length;
+}
+
+#ifndef _WIN32
+
+[[noreturn]] void throwLastError(std::string_view what, const fs::path& file)
+{
+    throw std::system_error(errno,
+                            std::generic_category(),
+                            std::format("{}: {}", what, file));
+}
+
+class FileHandle
+{
+public:
+    explicit FileHandle(int fd) noexcept
+        : fd_(fd)
+    {
+    }
+
+    FileHandle(const FileHandle&) = delete;
+    FileHandle& operator=(const FileHandle&) = delete;
+
+    ~FileHandle()
+    {
+        ::close(fd_);
+    }
+
+private:
+    int fd_;
+};
+
+class Mapping
+{
+public:
+    Mapping(void* addr, size_t size) noexcept
+        : addr_(addr)
+        , size_(size)
+    {
+    }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    ~Mapping()
+    {
+        ::munmap(addr_, size_);
+    }
+
+    const char* data() const noexcept
+    {
+        return static_cast<const char*>(addr_);
+    }
+
+private:
+    void* addr_;
+    size_t size_;
+};
+
+/**
+ * @brief Map the range and pass it to the callback in chunks. Returns false if the
+ * range can't be mapped, nothing is passed to the callback in that case.
+ */
+bool mapRange(int fd,
+              uint64_t offset,
+              uint64_t length,
+              size_t chunkSize,
+              const ChunkCallback& cb)
+{
+    const auto page = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    const auto start = offset - offset % page;
+    const auto skip = offset - start;
+
+    if (length > std::numeric_limits<size_t>::max() - skip)
+    {
+        return false;
+    }
+
+    const auto size = static_cast<size_t>(skip + length);
+    void* addr = ::mmap(nullptr,
+                        size,
+                        PROT_READ,
+                        MAP_PRIVATE,
+                        fd,
+                        static_cast<off_t>(start));
+
+    if (addr == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const Mapping mapping(addr, size);
+    ::madvise(addr, size, MADV_SEQUENTIAL);
+    countIo({.reads = 1, .bytes = length});
+
+    for (size_t pos = skip; pos < size; pos += chunkSize)
+    {
+        cb(std::string_view(mapping.data() + pos, std::min(chunkSize, size - pos)));
+    }
+
+    return true;
+}
+
+#endif
+
+} // namespace
+
+IoCounters ioCounters() noexcept
+{
+    return {
+        .opens = numOpens.load(std::memory_order_relaxed),
+        .reads = numReads.load(std::memory_order_relaxed),
+        .bytes = numBytes.load(std::memory_order_relaxed),
+    };
+}
+
+void countIo(const IoCounters& io) noexcept
+{
+    numOpens.fetch_add(io.opens, std::memory_order_relaxed);
+    numReads.fetch_add(io.reads, std::memory_order_relaxed);
+    numBytes.fetch_add(io.bytes, std::memory_order_relaxed);
+}
+
+void FileReader::AlignedDelete::operator()(char* ptr) const noexcept
+{
+    ::operator delete[](ptr, std::align_val_t(ALIGNMENT));
+}
+
+FileReader::FileReader(ReaderOptions opts)
+    : opts_(opts)
+{
+    const auto chunks = std::max<size_t>(1, (opts_.bufferSize + ALIGNMENT - 1) /
+                                                ALIGNMENT);
+    opts_.bufferSize = chunks * ALIGNMENT;
+}
+
+const ReaderOptions& FileReader::options() const noexcept
+{
+    return opts_;
+}
+
+char* FileReader::buffer()
+{
+    if (!buffer_)
+    {
+        buffer_.reset(static_cast<char*>(
+            ::operator new[](opts_.bufferSize, std::align_val_t(ALIGNMENT))));
+    }
+
+    return buffer_.get();
+}
+
+void FileReader::read(const fs::path& file, const ChunkCallback& cb)
+{
+    const std::array range {ByteRange {0, std::numeric_limits<uint64_t>::max()}};
+
+    read(file, range, cb);
+}
+
+#ifdef _WIN32
+
+void FileReader::read(const fs::path& file,
+                      std::span<const ByteRange> ranges,
+                      const ChunkCallback& cb)
+{
+    std::ifstream in;
+
+    // Chunks are large, bypass the stream buffer and read directly into them
+    in.rdbuf()->pubsetbuf(nullptr, 0);
+    in.open(file, std::ios::in | std::ios::binary);
+
+    if (!in)
+    {
+        throw std::system_error(
+            std::make_error_code(std::errc::no_such_file_or_directory),
+            std::format("Unable to open file: {}", file));
+    }
+
+    countIo({.opens = 1});
+    char* buf = buffer();
+
+    for (const auto& range : ranges)
+    {
+        in.clear();
+        in.seekg(static_cast<std::streamoff>(range.offset));
+        uint64_t remaining = rangeEnd(range) - range.offset;
+
+        while (in && remaining > 0)
+        {
+            const auto chunk = std::min<uint64_t>(remaining, opts_.bufferSize);
+            in.read(buf, static_cast<std::streamsize>(chunk));
+            const auto count = static_cast<size_t>(in.gcount());
+            countIo({.reads = 1, .bytes = count});
+
+            if (count > 0)
+            {
+                cb(std::string_view(buf, count));
+            }
+            remaining -= count;
+        }
+    }
+}
+
+#else
+
+void FileReader::read(const fs::path& file,
+                      std::span<const ByteRange> ranges,
+                      const ChunkCallback& cb)
+{
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        throwLastError("Unable to open file", file);
+    }
+
+    const FileHandle handle(fd);
+    countIo({.opens = 1});
+    struct stat st {};
+
+    if (::fstat(fd, &st) != 0)
+    {
+        throwLastError("Unable to query file", file);
+    }
+
+    // The size of other files, e.g. pipes, is not known in advance, they are read
+    // until the end
+    const bool regular = S_ISREG(st.st_mode);
+    const auto fileSize = static_cast<uint64_t>(st.st_size);
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    // Larger read ahead, the ranges are read in the increasing order most of the time
+    if (regular)
+    {
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+#endif
+
+    for (const auto& range : ranges)
+    {
+        const auto end =
+            regular ? std::min(rangeEnd(range), fileSize) : rangeEnd(range);
+
+        if (range.offset >= end)
+        {
+            continue;
+        }
+
+        const auto length = end - range.offset;
+        const bool mapped = regular && opts_.mapThreshold > 0 &&
+                            length >= opts_.mapThreshold &&
+                            mapRange(fd, range.offset, length, opts_.bufferSize, cb);
+
+        if (!mapped)
+        {
+            char* buf = buffer();
+            uint64_t offset = range.offset;
+
+            while (offset < end)
+            {
+                // The first chunk ends at an aligned offset, so do all the others
+                const auto chunk = std::min<uint64_t>(
+                    end - offset,
+                    opts_.bufferSize - offset % ALIGNMENT);
+                const auto count = ::pread(fd,
+                                           buf,
+                                           static_cast<size_t>(chunk),
+                                           static_cast<off_t>(offset));
+                countIo({
+                    .reads = 1,
+                    .bytes = count > 0 ? static_cast<uint64_t>(count) : 0,
+                });
+
+                if (count < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+
+                if (count < 0)
+                {
+                    throwLastError("Unable to read file", file);
+                }
+
+                if (count == 0)
+                {
+                    break;
+                }
+
+                cb(std::string_view(buf, static_cast<size_t>(count)));
+                offset += static_cast<uint64_t>(count);
+            }
+        }
+
+#ifdef POSIX_FADV_DONTNEED
+        if (regular && opts_.dropCache)
+        {
+            ::posix_fadvise(fd,
+                            static_cast<off_t>(range.offset),
+                            static_cast<off_t>(length),
+                            POSIX_FADV_DONTNEED);
+        }
+#endif
+    }
+}
+
+#endif
+
+#ifdef _WIN32
+
+struct BlockReader::File
+{
+    std::ifstream in;
+    char* buffer {nullptr};
+
+    ~File()
+    {
+        ::operator delete[](buffer, std::align_val_t(FileReader::ALIGNMENT));
+    }
+};
+
+#else
+
+struct BlockReader::File
+{
+    fs::path path;
+    int fd {-1};
+    char* buffer {nullptr};
+    bool dropCache {};
+
+    // End of the part read so far, it is evicted from the page cache once done
+    uint64_t end {};
+
+    ~File()
+    {
+#ifdef POSIX_FADV_DONTNEED
+        if (dropCache && end > 0)
+        {
+            ::posix_fadvise(fd, 0, static_cast<off_t>(end), POSIX_FADV_DONTNEED);
+        }
+#endif
+        ::close(fd);
+        ::operator delete[](buffer, std::align_val_t(FileReader::ALIGNMENT));
+    }
+};
+
+#endif
+
+BlockReader::BlockReader(const fs::path& file, ReaderOptions opts)
+    : opts_(FileReader(opts).options())  // The buffer size rounded the same way
+    , file_(std::make_unique<File>())
+{
+    opts_.mapThreshold = 0;
+
+#ifdef _WIN32
+    // Blocks are read directly into the buffer, bypass the stream buffer
+    file_->in.rdbuf()->pubsetbuf(nullptr, 0);
+    file_->in.open(file, std::ios::in | std::ios::binary);
+
+    if (!file_->in)
+    {
+        throw std::system_error(
+            std::make_error_code(std::errc::no_such_file_or_directory),
+            std::format("Unable to open file: {}", file));
+    }
+#else
+    file_->path = file;
+    file_->dropCache = opts_.dropCache;
+    file_->fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (file_->fd < 0)
+    {
+        throwLastError("Unable to open file", file);
+    }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(file_->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#endif
+
+    countIo({.opens = 1});
+    file_->buffer = static_cast<char*>(
+        ::operator new[](opts_.bufferSize, std::align_val_t(FileReader::ALIGNMENT)));
+}
+
+BlockReader::BlockReader(BlockReader&&) noexcept = default;
+BlockReader& BlockReader::operator=(BlockReader&&) noexcept = default;
+BlockReader::~BlockReader() = default;
+
+const ReaderOptions& BlockReader::options() const noexcept
+{
+    return opts_;
+}
+
+std::string_view BlockReader::read(uint64_t offset, size_t length)
+{
+    length = std::min(length, opts_.bufferSize);
+    char* buf = file_->buffer;
+    size_t done = 0;
+
+#ifdef _WIN32
+    auto& in = file_->in;
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(offset));
+    in.read(buf, static_cast<std::streamsize>(length));
+    done = static_cast<size_t>(in.gcount());
+    countIo({.reads = 1, .bytes = done});
+#else
+    // A single call may return less than asked for, only the end of the file stops
+    while (done < length)
+    {
+        const auto count = ::pread(file_->fd,
+                                   buf + done,
+                                   length - done,
+                                   static_cast<off_t>(offset + done));
+        countIo({
+            .reads = 1,
+            .bytes = count > 0 ? static_cast<uint64_t>(count) : 0,
+        });
+
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (count < 0)
+        {
+            throwLastError("Unable to read file", file_->path);
+        }
+
+        if (count == 0)
+        {
+            break;
+        }
+
+        done += static_cast<size_t>(count);
+    }
+
+    file_->end = std::max(file_->end, offset + done);
+#endif
+
+    return {buf, done};
+}
+
+} // namespace core::file
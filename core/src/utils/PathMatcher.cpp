@@ -0,0 +1,370 @@
+#include <core/utils/PathMatcher.h>
+
+#include <algorithm>
+#include <cctype>
+#include <optional>
+
+namespace core::file {
+namespace {
+
+constexpr std::string_view SPECIAL_CHARS = "^$.*+?()[]{}|";
+
+/**
+ * @brief Unescape the expression, if it only matches a literal text
+ */
+std::optional<std::string> literal(std::string_view expr)
+{
+    std::string text;
+
+    for (size_t i = 0; i < expr.size(); ++i)
+    {
+        char c = expr[i];
+
+        if (c == '\\')
+        {
+            // Escaped letters and digits are classes, assertions or back references
+            if (++i == expr.size() ||
+                std::isalnum(static_cast<unsigned char>(expr[i])))
+            {
+                return std::nullopt;
+            }
+            c = expr[i];
+        }
+        else if (SPECIAL_CHARS.contains(c))
+        {
+            return std::nullopt;
+        }
+
+        text.push_back(c);
+    }
+
+    return text;
+}
+
+/**
+ * @brief Check if the expression ends with an unescaped `$`
+ */
+bool anchoredAtEnd(std::string_view expr)
+{
+    if (!expr.ends_with('$'))
+    {
+        return false;
+    }
+
+    // An odd number of preceding backslashes escapes the anchor
+    size_t backslashes = 0;
+    for (auto i = expr.size() - 1; i > 0 && expr[i - 1] == '\\'; --i)
+    {
+        ++backslashes;
+    }
+
+    return backslashes % 2 == 0;
+}
+
+bool hasBackReference(std::string_view expr)
+{
+    for (size_t i = 0; i + 1 < expr.size(); ++i)
+    {
+        if (expr[i] == '\\')
+        {
+            if (expr[i + 1] >= '1' && expr[i + 1] <= '9')
+            {
+                return true;
+            }
+            ++i;
+        }
+    }
+
+    return false;
+}
+
+} // namespace
+
+PathMatcher::PathMatcher(const std::vector<std::string>& patterns)
+{
+    std::vector<std::string_view> others;
+
+    for (const auto& pattern : patterns)
+    {
+        if (!addComponents(pattern) && !addSuffixes(pattern))
+        {
+            others.push_back(pattern);
+        }
+    }
+
+    std::ranges::sort(suffixLengths_);
+    const auto [first, last] = std::ranges::unique(suffixLengths_);
+    suffixLengths_.erase(first, last);
+
+    constexpr auto flags = std::regex::ECMAScript | std::regex::optimize;
+
+    // Back references are numbered, they would break in a combined expression
+    if (std::ranges::any_of(others, hasBackReference))
+    {
+        for (const auto& pattern : others)
+        {
+            regexes_.emplace_back(pattern.begin(), pattern.end(), flags);
+        }
+        return;
+    }
+
+    if (!others.empty())
+    {
+        std::string combined;
+
+        for (const auto& pattern : others)
+        {
+            combined += combined.empty() ? "(?:" : "|(?:";
+            combined += pattern;
+            combined += ')';
+        }
+
+        regexes_.emplace_back(combined, flags);
+    }
+}
+
+bool PathMatcher::empty() const noexcept
+{
+    return suffixes_.empty() && trie_.empty() && regexes_.empty();
+}
+
+bool PathMatcher::matches(const fs::path& path) const
+{
+#ifdef _WIN32
+    const std::string str = path.string();
+#else
+    const std::string& str = path.native();
+#endif
+    const std::string_view view(str);
+
+    for (const auto length : suffixLengths_)
+    {
+        if (length > view.size())
+        {
+            break;
+        }
+
+        if (suffixes_.contains(view.substr(view.size() - length)))
+        {
+            return true;
+        }
+    }
+
+    if (matchComponents(view, false))
+    {
+        return true;
+    }
+
+    return std::ranges::any_of(regexes_, [&str](const auto& regex) {
+        return std::regex_search(str, regex);
+    });
+}
+
+bool PathMatcher::prunable(const fs::path& dir) const
+{
+#ifdef _WIN32
+    const std::string str = dir.string();
+#else
+    const std::string& str = dir.native();
+#endif
+
+    return matchComponents(str, true);
+}
+
+/**
+ * @brief Accepts `P(A|B|...)S$` with literal prefix, alternatives and suffix, where
+ * every part is optional, and an optional leading `.*`
+ */
+bool PathMatcher::addSuffixes(std::string_view pattern)
+{
+    if (!anchoredAtEnd(pattern))
+    {
+        return false;
+    }
+
+    pattern.remove_suffix(1);
+    if (pattern.starts_with(".*"))
+    {
+        pattern.remove_prefix(2);
+    }
+
+    std::vector<std::string> suffixes;
+    const auto open = pattern.find('(');
+
+    if (open == std::string_view::npos)
+    {
+        auto text = literal(pattern);
+        if (!text)
+        {
+            return false;
+        }
+        suffixes.push_back(std::move(*text));
+    }
+    else
+    {
+        const auto close = pattern.find(')', open);
+        if (close == std::string_view::npos)
+        {
+            return false;
+        }
+
+        auto group = pattern.substr(open + 1, close - open - 1);
+        if (group.starts_with("?:"))
+        {
+            group.remove_prefix(2);
+        }
+
+        const auto prefix = literal(pattern.substr(0, open));
+        const auto suffix = literal(pattern.substr(close + 1));
+        if (!prefix || !suffix)
+        {
+            return false;
+        }
+
+        while (true)
+        {
+            const auto bar = group.find('|');
+            const auto text = literal(group.substr(0, bar));
+            if (!text)
+            {
+                return false;
+            }
+
+            suffixes.push_back(*prefix + *text + *suffix);
+
+            if (bar == std::string_view::npos)
+            {
+                break;
+            }
+            group.remove_prefix(bar + 1);
+        }
+    }
+
+    // An empty suffix matches every path
+    if (std::ranges::any_of(suffixes, &std::string::empty))
+    {
+        return false;
+    }
+
+    for (auto& suffix : suffixes)
+    {
+        suffixLengths_.push_back(suffix.size());
+        suffixes_.insert(std::move(suffix));
+    }
+
+    return true;
+}
+
+/**
+ * @brief Accepts `/C1/.../Cn/` and `/C1/.../Cn$` with literal components
+ */
+bool PathMatcher::addComponents(std::string_view pattern)
+{
+    // Paths are matched by their native form, which uses other separators on Windows
+    if constexpr (fs::path::preferred_separator != '/')
+    {
+        return false;
+    }
+
+    if (pattern.size() < 3 || !pattern.starts_with('/'))
+    {
+        return false;
+    }
+
+    const bool last = anchoredAtEnd(pattern);
+    if (!last && !pattern.ends_with('/'))
+    {
+        return false;
+    }
+
+    const auto text = literal(pattern.substr(1, pattern.size() - 2));
+    if (!text || text->empty() || text->starts_with('/') || text->ends_with('/') ||
+        text->contains("//"))
+    {
+        return false;
+    }
+
+    if (trie_.empty())
+    {
+        trie_.emplace_back();
+    }
+
+    uint32_t node = 0;
+    std::string_view rest(*text);
+
+    while (!rest.empty())
+    {
+        const auto slash = rest.find('/');
+        const auto name = rest.substr(0, slash);
+        const auto it = trie_[node].children.find(name);
+
+        if (it != trie_[node].children.end())
+        {
+            node = it->second;
+        }
+        else
+        {
+            const auto child = static_cast<uint32_t>(trie_.size());
+            trie_[node].children.emplace(name, child);
+            trie_.emplace_back();
+            node = child;
+        }
+
+        rest = slash == std::string_view::npos ? std::string_view {}
+                                               : rest.substr(slash + 1);
+    }
+
+    (last ? trie_[node].last : trie_[node].inner) = true;
+
+    return true;
+}
+
+bool PathMatcher::matchComponents(std::string_view path, bool prune) const
+{
+    if (trie_.empty())
+    {
+        return false;
+    }
+
+    // A rule starts right after a separator
+    for (auto start = path.find('/'); start != std::string_view::npos;
+         start = path.find('/', start + 1))
+    {
+        uint32_t node = 0;
+        auto begin = start + 1;
+
+        while (true)
+        {
+            const auto end = std::min(path.find('/', begin), path.size());
+            const auto& children = trie_[node].children;
+            const auto it = children.find(path.substr(begin, end - begin));
+
+            if (it == children.end())
+            {
+                break;
+            }
+
+            node = it->second;
+            const bool isLast = end == path.size();
+            const auto& rule = trie_[node];
+
+            // A directory ending with the components of an inner rule has all its
+            // descendants matching
+            if (prune ? (isLast && rule.inner)
+                      : ((!isLast && rule.inner) || (isLast && rule.last)))
+            {
+                return true;
+            }
+
+            if (isLast)
+            {
+                break;
+            }
+            begin = end + 1;
+        }
+    }
+
+    return false;
+}
+
+} // namespace core::file
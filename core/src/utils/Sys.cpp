@@ -9,12 +9,14 @@
 #elif __APPLE__
     #include <SystemConfiguration/SystemConfiguration.h>
     #include <libproc.h>
+    #include <time.h>
     #include <unistd.h>
     #include <array>
     #include <fstream>
 #else
     #include <sys/types.h>
     #include <sys/stat.h>
+    #include <time.h>
 
     #include <fstream>
 #endif
@@ -46,6 +48,35 @@ std::wstring userNameBySessionId(unsigned long sessionId)
 
     return str;
 }
+#else
+/**
+ * @brief Memory amount of the given field of the process status, e.g. "VmRSS:"
+ */
+size_t statusMemory(uint32_t pid, std::string_view field)
+{
+    std::string filename = std::format("/proc/{}/status", pid);
+    std::ifstream file(filename, std::ios::in);
+
+    if (!file.is_open())
+    {
+        return 0;
+    }
+
+    std::string line;
+    size_t memory = 0;
+    while (getline(file, line))
+    {
+        if (line.starts_with(field))
+        {
+            std::istringstream iss(line);
+            std::string label;
+            iss >> label >> memory;
+            break;
+        }
+    }
+
+    return memory * 1024;
+}
 #endif
 
 } // namespace
@@ -260,34 +291,65 @@ size_t processMemoryUsage(uint32_t pid)
     std::ignore = pid;
     return 0;
 #else
-    std::string filename = std::format("/proc/{}/status", pid);
-    std::ifstream file(filename, std::ios::in);
+    return statusMemory(pid, "VmRSS:");
+#endif
+}
 
-    if (!file.is_open())
+size_t currentProcessMemoryUsage()
+{
+    return processMemoryUsage(currentProcessId());
+}
+
+size_t currentProcessPeakMemoryUsage()
+{
+#ifdef _WIN32
+    return 0;
+#else
+    return statusMemory(currentProcessId(), "VmHWM:");
+#endif
+}
+
+bool resetPeakMemoryUsage()
+{
+#ifdef __linux__
+    // Writing 5 resets the peak resident set size of the process
+    std::ofstream file("/proc/self/clear_refs", std::ios::out);
+    return static_cast<bool>(file << "5" << std::flush);
+#else
+    return false;
+#endif
+}
+
+std::chrono::nanoseconds currentProcessCpuTime() noexcept
+{
+#ifdef _WIN32
+    FILETIME creation {};
+    FILETIME exit {};
+    FILETIME kernel {};
+    FILETIME user {};
+
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
     {
-        return 0;
+        return {};
     }
 
-    std::string line;
-    size_t memory = 0;
-    while (getline(file, line))
+    // Both are in units of 100 nanoseconds
+    auto ticks = [](const FILETIME& ft) {
+        return (static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    };
+
+    return std::chrono::nanoseconds(
+        static_cast<int64_t>((ticks(kernel) + ticks(user)) * 100));
+#else
+    timespec ts {};
+
+    if (::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
     {
-        if (line.starts_with("VmRSS:"))
-        {
-            std::istringstream iss(line);
-            std::string label;
-            iss >> label >> memory;
-            break;
-        }
+        return {};
     }
 
-    return memory * 1024;
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
 #endif
 }
 
-size_t currentProcessMemoryUsage()
-{
-    return processMemoryUsage(currentProcessId());
-}
-
 } // namespace core::sys
\ No newline at end of file
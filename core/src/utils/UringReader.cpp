@@ -0,0 +1,546 @@
+#include <core/utils/UringReader.h>
+
+#ifdef CORE_WITH_IO_URING
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <optional>
+
+namespace core::file {
+namespace {
+
+[[maybe_unused]] size_t alignedSize(size_t size) noexcept
+{
+    const auto chunks = std::max<size_t>(1, (size + FileReader::ALIGNMENT - 1) /
+                                                FileReader::ALIGNMENT);
+
+    return chunks * FileReader::ALIGNMENT;
+}
+
+} // namespace
+
+#ifdef CORE_WITH_IO_URING
+
+namespace {
+
+std::error_code lastError() noexcept
+{
+    return {errno, std::generic_category()};
+}
+
+int setup(unsigned entries, io_uring_params& params) noexcept
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+}
+
+int enter(int fd, unsigned toSubmit, unsigned minComplete) noexcept
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter,
+                                      fd,
+                                      toSubmit,
+                                      minComplete,
+                                      IORING_ENTER_GETEVENTS,
+                                      nullptr,
+                                      0));
+}
+
+unsigned loadAcquire(unsigned* ptr) noexcept
+{
+    return std::atomic_ref<unsigned>(*ptr).load(std::memory_order_acquire);
+}
+
+void storeRelease(unsigned* ptr, unsigned value) noexcept
+{
+    std::atomic_ref<unsigned>(*ptr).store(value, std::memory_order_release);
+}
+
+class Descriptor
+{
+public:
+    explicit Descriptor(int fd = -1) noexcept
+        : fd_(fd)
+    {
+    }
+
+    Descriptor(const Descriptor&) = delete;
+    Descriptor& operator=(const Descriptor&) = delete;
+
+    ~Descriptor()
+    {
+        reset();
+    }
+
+    int get() const noexcept
+    {
+        return fd_;
+    }
+
+    void reset(int fd = -1) noexcept
+    {
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+        fd_ = fd;
+    }
+
+private:
+    int fd_;
+};
+
+class Mapping
+{
+public:
+    Mapping(int fd, size_t size, off_t offset)
+        : size_(size)
+    {
+        addr_ = ::mmap(nullptr,
+                       size,
+                       PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE,
+                       fd,
+                       offset);
+
+        if (addr_ == MAP_FAILED)
+        {
+            throw std::system_error(lastError(), "Unable to map the io_uring");
+        }
+    }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    ~Mapping()
+    {
+        ::munmap(addr_, size_);
+    }
+
+    template <typename T>
+    T* at(uint32_t offset) const noexcept
+    {
+        return reinterpret_cast<T*>(static_cast<char*>(addr_) + offset);
+    }
+
+private:
+    void* addr_ {nullptr};
+    size_t size_ {0};
+};
+
+struct AlignedDelete
+{
+    void operator()(char* ptr) const noexcept
+    {
+        ::operator delete[](ptr, std::align_val_t(FileReader::ALIGNMENT));
+    }
+};
+
+/**
+ * @brief A request being read
+ */
+struct Slot
+{
+    size_t index {};
+    Descriptor fd;
+    bool regular {false};
+    uint64_t fileSize {};
+    std::vector<ByteRange> ranges;
+    size_t range {};
+    uint64_t offset {};
+    uint64_t end {};
+    char* buffer {nullptr};
+};
+
+} // namespace
+
+/**
+ * @brief Submission and completion queues shared with the kernel
+ */
+struct UringReader::Ring
+{
+    Descriptor fd;
+    std::optional<Mapping> sqRing;
+    std::optional<Mapping> cqRing;
+    std::optional<Mapping> sqeArray;
+
+    unsigned* sqTail {nullptr};
+    unsigned sqMask {0};
+    unsigned* sqIndices {nullptr};
+    io_uring_sqe* sqes {nullptr};
+
+    unsigned* cqHead {nullptr};
+    unsigned* cqTail {nullptr};
+    unsigned cqMask {0};
+    io_uring_cqe* cqes {nullptr};
+
+    // Entries queued since the last submission
+    unsigned queued {0};
+
+    explicit Ring(unsigned entries)
+    {
+        io_uring_params params {};
+        fd.reset(setup(entries, params));
+
+        if (fd.get() < 0)
+        {
+            throw std::system_error(lastError(), "Unable to create the io_uring");
+        }
+
+        const auto& sq = params.sq_off;
+        const auto& cq = params.cq_off;
+        size_t sqSize = sq.array + params.sq_entries * sizeof(unsigned);
+        size_t cqSize = cq.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+        // Both rings share a single mapping on the kernels since 5.4
+        const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single)
+        {
+            sqSize = cqSize = std::max(sqSize, cqSize);
+        }
+
+        sqRing.emplace(fd.get(), sqSize, IORING_OFF_SQ_RING);
+        if (!single)
+        {
+            cqRing.emplace(fd.get(), cqSize, IORING_OFF_CQ_RING);
+        }
+        sqeArray.emplace(fd.get(),
+                         params.sq_entries * sizeof(io_uring_sqe),
+                         IORING_OFF_SQES);
+
+        const auto& cqMap = single ? *sqRing : *cqRing;
+
+        sqTail = sqRing->at<unsigned>(sq.tail);
+        sqMask = *sqRing->at<unsigned>(sq.ring_mask);
+        sqIndices = sqRing->at<unsigned>(sq.array);
+        sqes = sqeArray->at<io_uring_sqe>(0);
+
+        cqHead = cqMap.at<unsigned>(cq.head);
+        cqTail = cqMap.at<unsigned>(cq.tail);
+        cqMask = *cqMap.at<unsigned>(cq.ring_mask);
+        cqes = cqMap.at<io_uring_cqe>(cq.cqes);
+    }
+
+    /**
+     * @brief Queue the entry, the caller makes sure that the queue has space
+     */
+    void push(const io_uring_sqe& sqe) noexcept
+    {
+        const unsigned tail = *sqTail;
+        const unsigned index = tail & sqMask;
+
+        sqes[index] = sqe;
+        sqIndices[index] = index;
+        storeRelease(sqTail, tail + 1);
+        ++queued;
+    }
+
+    /**
+     * @brief Submit the queued entries and wait for the given number of completions
+     */
+    void submit(unsigned minComplete)
+    {
+        while (true)
+        {
+            const int ret = enter(fd.get(), queued, minComplete);
+
+            if (ret >= 0)
+            {
+                queued -= static_cast<unsigned>(ret);
+                return;
+            }
+
+            if (errno != EINTR)
+            {
+                throw std::system_error(lastError(),
+                                        "Unable to submit to the io_uring");
+            }
+        }
+    }
+
+    /**
+     * @brief Pass the available completions to the handler. Every completion is
+     * consumed before the handler is invoked, so the handler may throw.
+     */
+    template <typename Handler>
+    void reap(Handler&& handler)
+    {
+        unsigned head = *cqHead;
+
+        while (head != loadAcquire(cqTail))
+        {
+            const io_uring_cqe cqe = cqes[head & cqMask];
+            storeRelease(cqHead, ++head);
+            handler(cqe.user_data, cqe.res);
+        }
+    }
+};
+
+bool UringReader::supported() noexcept
+{
+    static const bool value = [] {
+        io_uring_params params {};
+        const Descriptor fd(setup(1, params));
+
+        // Fast poll came after the plain reads, with kernel 5.7
+        return fd.get() >= 0 && (params.features & IORING_FEAT_FAST_POLL) != 0;
+    }();
+
+    return value;
+}
+
+UringReader::UringReader(UringOptions opts)
+    : opts_(opts)
+{
+    if (!supported())
+    {
+        throw std::system_error(
+            std::make_error_code(std::errc::function_not_supported),
+            "The io_uring is not supported");
+    }
+
+    opts_.depth = std::max(1U, opts_.depth);
+    opts_.bufferSize = alignedSize(opts_.bufferSize);
+    ring_ = std::make_unique<Ring>(opts_.depth);
+}
+
+void UringReader::read(size_t count,
+                       const RequestSource& source,
+                       const RequestChunkCallback& chunk,
+                       const RequestDoneCallback& done)
+{
+    const size_t depth = std::min<size_t>(opts_.depth, count);
+    if (depth == 0)
+    {
+        return;
+    }
+
+    const std::unique_ptr<char, AlignedDelete> buffers(static_cast<char*>(
+        ::operator new[](depth * opts_.bufferSize,
+                         std::align_val_t(FileReader::ALIGNMENT))));
+    std::vector<Slot> slots(depth);
+    size_t next = 0;
+    unsigned inFlight = 0;
+
+    for (size_t s = 0; s < depth; ++s)
+    {
+        slots[s].buffer = buffers.get() + s * opts_.bufferSize;
+    }
+
+    auto submitRead = [this, &slots, &inFlight](size_t s) {
+        const auto& slot = slots[s];
+        const auto length =
+            std::min<uint64_t>(slot.end - slot.offset,
+                               opts_.bufferSize - slot.offset % FileReader::ALIGNMENT);
+
+        io_uring_sqe sqe {};
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = slot.fd.get();
+        sqe.addr = reinterpret_cast<uint64_t>(slot.buffer);
+        sqe.len = static_cast<uint32_t>(length);
+        sqe.off = slot.offset;
+        sqe.user_data = s;
+
+        ring_->push(sqe);
+        ++inFlight;
+    };
+
+    // Moves to the next range which has something to be read
+    auto nextRange = [](Slot& slot) {
+        for (; slot.range < slot.ranges.size(); ++slot.range)
+        {
+            const auto& range = slot.ranges[slot.range];
+            const auto length = std::min(
+                range.length, std::numeric_limits<uint64_t>::max() - range.offset);
+            const auto end = slot.regular
+                                 ? std::min(range.offset + length, slot.fileSize)
+                                 : range.offset + length;
+
+            if (range.offset < end)
+            {
+                slot.offset = range.offset;
+                slot.end = end;
+                return true;
+            }
+        }
+
+        return false;
+    };
+
+    auto rangeDone = [this](Slot& slot) {
+        if (slot.regular && opts_.dropCache)
+        {
+            const auto& range = slot.ranges[slot.range];
+            ::posix_fadvise(slot.fd.get(),
+                            static_cast<off_t>(range.offset),
+                            static_cast<off_t>(slot.offset - range.offset),
+                            POSIX_FADV_DONTNEED);
+        }
+        ++slot.range;
+    };
+
+    auto finish = [&done](Slot& slot, const std::error_code& ec) {
+        slot.fd.reset();
+        slot.ranges.clear();
+        done(slot.index, ec);
+    };
+
+    // Opens the next request and submits its first read
+    auto start = [&](size_t s) {
+        auto& slot = slots[s];
+
+        while (next < count)
+        {
+            const size_t index = next++;
+            ReadRequest request = source(index);
+            slot.fd.reset(::open(request.path.c_str(), O_RDONLY | O_CLOEXEC));
+
+            if (slot.fd.get() < 0)
+            {
+                done(index, lastError());
+                continue;
+            }
+
+            countIo({.opens = 1});
+
+            struct stat st {};
+            if (::fstat(slot.fd.get(), &st) != 0)
+            {
+                const auto ec = lastError();
+                slot.fd.reset();
+                done(index, ec);
+                continue;
+            }
+
+            slot.index = index;
+            slot.regular = S_ISREG(st.st_mode);
+            slot.fileSize = static_cast<uint64_t>(st.st_size);
+            slot.ranges = std::move(request.ranges);
+            slot.range = 0;
+
+            if (!nextRange(slot))
+            {
+                finish(slot, {});
+                continue;
+            }
+
+            submitRead(s);
+            return;
+        }
+    };
+
+    auto complete = [&](uint64_t userData, int res) {
+        const auto s = static_cast<size_t>(userData);
+        auto& slot = slots[s];
+        --inFlight;
+        countIo({.reads = 1, .bytes = res > 0 ? static_cast<uint64_t>(res) : 0});
+
+        if (res == -EINTR || res == -EAGAIN)
+        {
+            submitRead(s);
+            return;
+        }
+
+        if (res < 0)
+        {
+            finish(slot, {-res, std::generic_category()});
+            start(s);
+            return;
+        }
+
+        if (res > 0)
+        {
+            chunk(slot.index, std::string_view(slot.buffer, static_cast<size_t>(res)));
+            slot.offset += static_cast<uint64_t>(res);
+        }
+
+        // The file might have been truncated in the meantime, the end of the file
+        // ends the range as well
+        if (res == 0 || slot.offset >= slot.end)
+        {
+            rangeDone(slot);
+
+            if (!nextRange(slot))
+            {
+                finish(slot, {});
+                start(s);
+                return;
+            }
+        }
+
+        submitRead(s);
+    };
+
+    try
+    {
+        for (size_t s = 0; s < depth; ++s)
+        {
+            start(s);
+        }
+
+        while (inFlight > 0)
+        {
+            ring_->submit(1);
+            ring_->reap(complete);
+        }
+    }
+    catch (...)
+    {
+        // The kernel still writes into the buffers of the reads in flight
+        while (inFlight > 0)
+        {
+            ring_->submit(1);
+            ring_->reap([&inFlight](uint64_t, int) {
+                --inFlight;
+            });
+        }
+        throw;
+    }
+}
+
+#else
+
+struct UringReader::Ring
+{
+};
+
+bool UringReader::supported() noexcept
+{
+    return false;
+}
+
+UringReader::UringReader(UringOptions opts)
+    : opts_(opts)
+{
+    throw std::system_error(std::make_error_code(std::errc::function_not_supported),
+                            "The io_uring support is not compiled in");
+}
+
+void UringReader::read(size_t,
+                       const RequestSource&,
+                       const RequestChunkCallback&,
+                       const RequestDoneCallback&)
+{
+    throw std::system_error(std::make_error_code(std::errc::function_not_supported),
+                            "The io_uring support is not compiled in");
+}
+
+#endif
+
+UringReader::~UringReader() = default;
+
+const UringOptions& UringReader::options() const noexcept
+{
+    return opts_;
+}
+
+} // namespace core::file
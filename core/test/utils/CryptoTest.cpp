@@ -3,8 +3,10 @@
 #include <core/utils/File.h>
 #include <core/utils/Crypto.h>
 
+#include <algorithm>
 #include <array>
 #include <filesystem>
+#include <system_error>
 
 using namespace core;
 using namespace core::crypto;
@@ -68,6 +70,168 @@ TEST(UtilsCryptoTests, FileSha256)
 }
 
 
+TEST(UtilsCryptoTests, FileSha256OfRanges)
+{
+    const fs::path filename = "ranges.txt";
+    const std::string data = "0123456789abcdefghij";
+    file::write(filename, data);
+
+    const std::array whole {ByteRange {0, data.size()}};
+    EXPECT_EQ(fileSha256(filename, whole), fileSha256(filename));
+
+    const std::array head {ByteRange {0, 4}};
+    EXPECT_EQ(fileSha256(filename, head), sha256("0123"));
+
+    // Ranges are concatenated in the given order
+    const std::array pieces {ByteRange {10, 3}, ByteRange {2, 2}};
+    EXPECT_EQ(fileSha256(filename, pieces), sha256("abc23"));
+
+    // Bytes past the end of the file are ignored
+    const std::array tail {ByteRange {16, 100}, ByteRange {1000, 10}};
+    EXPECT_EQ(fileSha256(filename, tail), sha256("ghij"));
+
+    fs::remove(filename);
+}
+
+
+TEST(UtilsCryptoTests, DataFastHash128)
+{
+    // Reference values of MurmurHash3_x64_128 with zero seed
+    std::unordered_map<std::string, std::string> hashes {
+        {"00000000000000000000000000000000", ""},
+        {"029bbd41b3a7d8cb191dae486a901e5b", "hello"},
+        {"5123bfc0f6d52da6f04c547c0cf5cc4f", "0123456789abcde"},
+        {"fda376f0243ec8e4d7a88f3a588c9cf9", "0123456789abcdefghij"},
+        {"956dc2af68daaaefaafb250db163d21f", "0123456789abcdefghijklmnopqrstuvwxyz"},
+        {"6c1b07bc7bbc4be347939ac4a93c437a",
+         "The quick brown fox jumps over the lazy dog"}};
+
+    for (auto& pair : hashes)
+    {
+        EXPECT_EQ(pair.first, fastHash128(pair.second));
+    }
+}
+
+
+TEST(UtilsCryptoTests, FileDigest)
+{
+    const fs::path filename = "digest.txt";
+    std::string data;
+    for (size_t i = 0; i < 10'000; ++i)
+    {
+        data.push_back(static_cast<char>('a' + (i * 7) % 26));
+    }
+    file::write(filename, data);
+
+    auto hex = [](const Digest& digest, DigestType type) {
+        return toHex(std::span(digest).first(digestSize(type)));
+    };
+
+    const auto sha = fileDigest(filename, DigestType::Sha256);
+    const auto fast = fileDigest(filename, DigestType::Fast128);
+    EXPECT_EQ(hex(sha, DigestType::Sha256), sha256(data));
+    EXPECT_EQ(hex(fast, DigestType::Fast128), fastHash128(data));
+
+    // The unused part of shorter digests is zero
+    EXPECT_TRUE(std::ranges::all_of(std::span(fast).subspan(16), [](uint8_t b) {
+        return b == 0;
+    }));
+
+    // Ranges are digested as a single stream, regardless of the block boundaries
+    const std::array pieces {ByteRange {5000, 4097}, ByteRange {3, 13}};
+    const auto joined = data.substr(5000, 4097) + data.substr(3, 13);
+    EXPECT_EQ(hex(fileDigest(filename, DigestType::Fast128, pieces),
+                  DigestType::Fast128),
+              fastHash128(joined));
+    EXPECT_EQ(hex(fileDigest(filename, DigestType::Sha256, pieces),
+                  DigestType::Sha256),
+              sha256(joined));
+
+    fs::remove(filename);
+}
+
+
+TEST(UtilsCryptoTests, FileTreeDigest)
+{
+    const fs::path filename = "tree-digest.txt";
+    std::string data;
+    for (size_t i = 0; i < 10'000; ++i)
+    {
+        data.push_back(static_cast<char>('a' + (i * 7) % 26));
+    }
+    file::write(filename, data);
+
+    // Digest of the digests of the chunks
+    auto expected = [](std::string_view bytes, size_t chunk) {
+        Sha256Hasher root;
+        for (size_t i = 0; i == 0 || i < bytes.size(); i += chunk)
+        {
+            Sha256Hasher leaf;
+            Digest digest {};
+            leaf.update(bytes.substr(i, chunk));
+            leaf.final(digest);
+            root.update({reinterpret_cast<const char*>(digest.data()), digest.size()});
+        }
+
+        Digest digest {};
+        root.final(digest);
+        return digest;
+    };
+
+    // The same for any number of threads, the last chunk is shorter
+    for (const size_t workers : {1U, 2U, 7U})
+    {
+        const TreeOptions opts {.chunkBytes = 1024, .workers = workers};
+        EXPECT_EQ(fileTreeDigest(filename, DigestType::Sha256, opts),
+                  expected(data, 1024));
+    }
+
+    // The ranges form a single stream, the chunks may span them
+    const std::array pieces {
+        ByteRange {5000, 4097},
+        ByteRange {3, 13},
+        ByteRange {9990, 100},
+    };
+    const auto joined =
+        data.substr(5000, 4097) + data.substr(3, 13) + data.substr(9990);
+    const TreeOptions opts {.chunkBytes = 1000};
+    EXPECT_EQ(fileTreeDigest(filename, DigestType::Sha256, pieces, opts),
+              expected(joined, 1000));
+
+    // Nothing selected is a single empty chunk
+    const std::span<const ByteRange> none;
+    EXPECT_EQ(fileTreeDigest(filename, DigestType::Sha256, none, opts),
+              expected("", 1000));
+
+    // The chunk size is part of the digest
+    EXPECT_NE(fileTreeDigest(filename, DigestType::Fast128, {.chunkBytes = 1000}),
+              fileTreeDigest(filename, DigestType::Fast128, {.chunkBytes = 2000}));
+
+    fs::remove(filename);
+    EXPECT_THROW(fileTreeDigest(filename, DigestType::Sha256), std::system_error);
+}
+
+
+TEST(UtilsCryptoTests, Sha256Hasher)
+{
+    Sha256Hasher hasher;
+    hasher.update("0123");
+
+    // The copy continues from the same state
+    Sha256Hasher copy(hasher);
+    hasher.update("4567");
+    copy.update("abcd");
+
+    std::string out;
+    hasher.final(out);
+    EXPECT_EQ(out, sha256("01234567"));
+
+    Digest digest {};
+    copy.final(digest);
+    EXPECT_EQ(toHex(digest), sha256("0123abcd"));
+}
+
+
 TEST(UtilsCryptoTests, CheckEncodeDecode64)
 {
     // Holds byte representation of data and its base64 encoding
@@ -0,0 +1,219 @@
+#include <gtest/gtest.h>
+#include <core/utils/DirWalker.h>
+#include <core/utils/File.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace core::file;
+
+namespace {
+
+class DirWalkerTest : public ::testing::Test
+{
+protected:
+    TempDir dir_ {"dir-walker"};
+
+    // Creates dirs d0..d2, each with subdirectories s0..s2 with files f0..f2
+    std::vector<fs::path> createTree() const
+    {
+        std::vector<fs::path> files;
+
+        for (int d = 0; d < 3; ++d)
+        {
+            for (int s = 0; s < 3; ++s)
+            {
+                const auto sub =
+                    dir_.path() / std::format("d{}", d) / std::format("s{}", s);
+                fs::create_directories(sub);
+
+                for (int f = 0; f < 3; ++f)
+                {
+                    files.push_back(sub / std::format("f{}", f));
+                    write(files.back(), std::string(static_cast<size_t>(f), 'x'));
+                }
+            }
+        }
+
+        return files;
+    }
+
+    static std::map<fs::path, EntryType> walk(const WalkOptions& opts,
+                                              const fs::path& dir)
+    {
+        std::map<fs::path, EntryType> entries;
+
+        DirWalker(opts).walk(dir, [&entries](const auto& entry, const auto& ec) {
+            EXPECT_FALSE(ec) << entry.path;
+            EXPECT_TRUE(entries.emplace(entry.path, entry.type).second) << entry.path;
+        });
+
+        return entries;
+    }
+};
+
+} // namespace
+
+TEST_F(DirWalkerTest, ReportsAllEntries)
+{
+    const auto files = createTree();
+    const auto entries = walk({.threads = 4}, dir_.path());
+
+    EXPECT_EQ(entries.size(), files.size() + 3 + 9);
+
+    for (const auto& file : files)
+    {
+        ASSERT_TRUE(entries.contains(file)) << file;
+        EXPECT_EQ(entries.at(file), EntryType::Regular);
+        EXPECT_EQ(entries.at(file.parent_path()), EntryType::Directory);
+    }
+}
+
+TEST_F(DirWalkerTest, DeterministicOrder)
+{
+    createTree();
+
+    std::vector<fs::path> expected;
+    for (const auto& entry : fs::recursive_directory_iterator(dir_.path()))
+    {
+        expected.push_back(entry.path());
+    }
+
+    // Sequential walk with sorted directories
+    std::ranges::sort(expected);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        std::vector<fs::path> paths;
+        DirWalker({.threads = 4, .deterministic = true})
+            .walk(dir_.path(), [&paths](const auto& entry, const auto&) {
+                paths.push_back(entry.path);
+            });
+
+        EXPECT_EQ(paths, expected);
+    }
+}
+
+TEST_F(DirWalkerTest, StatProvidesMetadata)
+{
+    const auto files = createTree();
+    std::map<fs::path, FileInfo> infos;
+
+    DirWalker({.stat = true})
+        .walk(dir_.path(), [&infos](const auto& entry, const auto&) {
+            ASSERT_TRUE(entry.info.has_value()) << entry.path;
+            infos[entry.path] = *entry.info;
+        });
+
+    for (const auto& file : files)
+    {
+        FileInfo expected;
+        std::error_code ec;
+        ASSERT_TRUE(fileInfo(file, expected, ec));
+
+        const auto& info = infos.at(file);
+        EXPECT_EQ(info.device, expected.device);
+        EXPECT_EQ(info.inode, expected.inode);
+        EXPECT_EQ(info.size, expected.size);
+        EXPECT_EQ(info.mtime, expected.mtime);
+    }
+}
+
+TEST_F(DirWalkerTest, ExcludedDirectoriesAreNotEntered)
+{
+    createTree();
+
+    const WalkOptions opts {
+        .exclusions = PathMatcher({"d1$", "f2$", "/s2/"}),
+    };
+    const auto entries = walk(opts, dir_.path());
+
+    EXPECT_EQ(entries.size(), 2 + 6 + 8);
+    EXPECT_FALSE(entries.contains(dir_.path() / "d1"));
+    EXPECT_FALSE(entries.contains(dir_.path() / "d0" / "s0" / "f2"));
+    EXPECT_TRUE(entries.contains(dir_.path() / "d0" / "s0" / "f1"));
+
+    // Reported, but not entered
+    EXPECT_TRUE(entries.contains(dir_.path() / "d0" / "s2"));
+    EXPECT_FALSE(entries.contains(dir_.path() / "d0" / "s2" / "f0"));
+}
+
+TEST_F(DirWalkerTest, ExcludedEntriesAreReportedOnRequest)
+{
+    createTree();
+
+    std::map<fs::path, bool> excluded;
+    const DirWalker walker({
+        .exclusions = PathMatcher({"d1$", "f2$"}),
+        .reportExcluded = true,
+    });
+    walker.walk(dir_.path(), [&excluded](const auto& entry, const auto&) {
+        excluded.emplace(entry.path, entry.excluded);
+    });
+
+    EXPECT_EQ(excluded.size(), 3 + 6 + 18);
+    EXPECT_TRUE(excluded.at(dir_.path() / "d1"));
+    EXPECT_TRUE(excluded.at(dir_.path() / "d0" / "s0" / "f2"));
+    EXPECT_FALSE(excluded.at(dir_.path() / "d0" / "s0" / "f1"));
+
+    // Not entered
+    EXPECT_FALSE(excluded.contains(dir_.path() / "d1" / "s0"));
+}
+
+TEST_F(DirWalkerTest, SymlinkPolicies)
+{
+    const auto top = dir_.path() / "top";
+    fs::create_directories(top / "sub");
+    write(top / "sub" / "file", "data");
+
+    std::error_code ec;
+    fs::create_directory_symlink(top, top / "sub" / "loop", ec);
+    if (ec)
+    {
+        GTEST_SKIP() << "Symbolic links are not supported: " << ec.message();
+    }
+    fs::create_symlink(top / "sub" / "file", top / "link");
+
+    auto entries = walk({}, top);
+    EXPECT_EQ(entries.size(), 2U);
+
+    entries = walk({.symlinks = SymlinkPolicy::Report}, top);
+    EXPECT_EQ(entries.size(), 4U);
+    EXPECT_EQ(entries.at(top / "link"), EntryType::Symlink);
+    EXPECT_EQ(entries.at(top / "sub" / "loop"), EntryType::Symlink);
+
+    // The link to the walked directory is not entered
+    entries = walk({.symlinks = SymlinkPolicy::Follow}, top);
+    EXPECT_EQ(entries.size(), 3U);
+    EXPECT_EQ(entries.at(top / "link"), EntryType::Regular);
+}
+
+TEST_F(DirWalkerTest, ErrorsAreReported)
+{
+    const auto missing = dir_.path() / "missing";
+    std::vector<fs::path> failed;
+
+    DirWalker().walk(missing, [&failed](const auto& entry, const auto& ec) {
+        EXPECT_TRUE(ec);
+        failed.push_back(entry.path);
+    });
+
+    EXPECT_EQ(failed, std::vector<fs::path> {missing});
+}
+
+TEST_F(DirWalkerTest, CallbackExceptionsArePropagated)
+{
+    createTree();
+
+    EXPECT_THROW(DirWalker({.threads = 4}).walk(dir_.path(),
+                                                [](const auto&, const auto&) {
+                                                    throw std::runtime_error("stop");
+                                                }),
+                 std::runtime_error);
+}
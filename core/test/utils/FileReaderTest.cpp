@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include <core/utils/File.h>
+#include <core/utils/FileReader.h>
+
+#include <array>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+namespace fs = std::filesystem;
+using namespace core::file;
+
+namespace {
+
+class FileReaderTest : public ::testing::Test
+{
+protected:
+    TempDir dir_ {"file-reader"};
+    fs::path file_ {dir_.path() / "data.bin"};
+    std::string data_;
+
+    void SetUp() override
+    {
+        // Not a multiple of the alignment, so the last chunk is a partial one
+        for (size_t i = 0; i < 3 * FileReader::ALIGNMENT + 123; ++i)
+        {
+            data_.push_back(static_cast<char>('a' + i % 26));
+        }
+        write(file_, data_);
+    }
+
+    static std::string read(FileReader& reader,
+                            const fs::path& file,
+                            std::span<const ByteRange> ranges,
+                            size_t& chunks)
+    {
+        std::string content;
+        chunks = 0;
+
+        reader.read(file, ranges, [&content, &chunks](std::string_view chunk) {
+            EXPECT_LE(chunk.size(), FileReader::ALIGNMENT);
+            content += chunk;
+            ++chunks;
+        });
+
+        return content;
+    }
+};
+
+} // namespace
+
+TEST_F(FileReaderTest, BufferSizeIsAligned)
+{
+    constexpr auto alignment = FileReader::ALIGNMENT;
+
+    EXPECT_EQ(FileReader({.bufferSize = 0}).options().bufferSize, alignment);
+    EXPECT_EQ(FileReader({.bufferSize = alignment + 1}).options().bufferSize,
+              2 * alignment);
+}
+
+TEST_F(FileReaderTest, ReadsRangesInChunks)
+{
+    // Both the buffered and the mapped reads must produce the same content
+    for (const uint64_t mapThreshold : {0UL, 1UL})
+    {
+        FileReader reader({.bufferSize = 1, .mapThreshold = mapThreshold});
+        size_t chunks = 0;
+
+        std::string content;
+        reader.read(file_, [&content](std::string_view chunk) {
+            content += chunk;
+        });
+        EXPECT_EQ(content, data_);
+
+        const std::array whole {ByteRange {0, data_.size()}};
+        EXPECT_EQ(read(reader, file_, whole, chunks), data_);
+        EXPECT_EQ(chunks, 4U);
+
+        // The first chunk of an unaligned range ends at an aligned offset
+        const std::array pieces {ByteRange {10, FileReader::ALIGNMENT},
+                                 ByteRange {2, 3}};
+        const auto expected = data_.substr(10, FileReader::ALIGNMENT) +
+                              data_.substr(2, 3);
+        EXPECT_EQ(read(reader, file_, pieces, chunks), expected);
+        EXPECT_EQ(chunks, mapThreshold ? 2U : 3U);
+
+        // Parts past the end of the file are ignored
+        const std::array tail {ByteRange {data_.size() - 5, 100},
+                               ByteRange {data_.size() + 10, 10}};
+        EXPECT_EQ(read(reader, file_, tail, chunks), data_.substr(data_.size() - 5));
+    }
+}
+
+TEST_F(FileReaderTest, FileTruncatedWhileReadEndsTheRead)
+{
+    // Not mapped by default, the pages past the end would raise SIGBUS otherwise
+    FileReader reader({.bufferSize = 1});
+    std::string content;
+
+    reader.read(file_, [this, &content](std::string_view chunk) {
+        content += chunk;
+        fs::resize_file(file_, 10);
+    });
+
+    EXPECT_EQ(content, data_.substr(0, FileReader::ALIGNMENT));
+}
+
+TEST_F(FileReaderTest, EmptyFile)
+{
+    const auto empty = dir_.path() / "empty.bin";
+    write(empty, "");
+
+    FileReader reader;
+    size_t chunks = 0;
+    const std::array whole {ByteRange {0, 100}};
+
+    EXPECT_TRUE(read(reader, empty, whole, chunks).empty());
+    EXPECT_EQ(chunks, 0U);
+}
+
+TEST_F(FileReaderTest, MissingFileThrows)
+{
+    FileReader reader;
+
+    EXPECT_THROW(reader.read(dir_.path() / "missing", [](std::string_view) {}),
+                 std::system_error);
+}
+
+TEST_F(FileReaderTest, CountsTheReads)
+{
+    for (const uint64_t mapThreshold : {0UL, 1UL})
+    {
+        FileReader reader({.bufferSize = 1, .mapThreshold = mapThreshold});
+        const auto before = ioCounters();
+
+        reader.read(file_, [](std::string_view) {});
+
+        // A mapped file is read at once
+        const auto after = ioCounters();
+        EXPECT_EQ(after.opens - before.opens, 1U);
+        EXPECT_EQ(after.reads - before.reads, mapThreshold ? 1U : 4U);
+        EXPECT_EQ(after.bytes - before.bytes, data_.size());
+    }
+
+    const auto before = ioCounters();
+    countIo({.opens = 1, .reads = 2, .bytes = 3});
+
+    const auto after = ioCounters();
+    EXPECT_EQ(after.opens - before.opens, 1U);
+    EXPECT_EQ(after.reads - before.reads, 2U);
+    EXPECT_EQ(after.bytes - before.bytes, 3U);
+}
+
+TEST_F(FileReaderTest, BlockReaderKeepsTheBlockUntilTheNextRead)
+{
+    constexpr auto alignment = FileReader::ALIGNMENT;
+    const auto before = ioCounters();
+    BlockReader first(file_, {.bufferSize = 2 * alignment});
+    BlockReader second(file_, {.bufferSize = 1});
+
+    const auto a = first.read(10, 100);
+    const auto b = second.read(10, 100);
+    EXPECT_EQ(a, data_.substr(10, 100));
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a.data(), b.data());
+
+    // The length is capped by the buffer, the block is shorter at the end of the file
+    EXPECT_EQ(first.read(0, 10 * alignment), data_.substr(0, 2 * alignment));
+    EXPECT_EQ(second.read(data_.size() - 5, 100), data_.substr(data_.size() - 5));
+    EXPECT_TRUE(second.read(data_.size() + 1, 100).empty());
+
+    const auto after = ioCounters();
+    EXPECT_EQ(after.opens - before.opens, 2U);
+
+    EXPECT_THROW(BlockReader(dir_.path() / "missing"), std::system_error);
+}
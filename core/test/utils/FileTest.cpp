@@ -4,6 +4,7 @@
 
 #include <exception>
 #include <filesystem>
+#include <string>
 
 namespace fs = std::filesystem;
 using testing::_;
@@ -99,4 +100,61 @@ TEST_F(UtilsFileTests, ReadLinesFails)
     EXPECT_THROW(readLines(file, lambda), std::exception);
 }
 
+TEST_F(UtilsFileTests, FileInfo)
+{
+    const fs::path file = testDir_ / "info.txt";
+    const fs::path link = testDir_ / "info-link.txt";
+    write(file, "12345");
+    fs::create_hard_link(file, link);
+
+    FileInfo info;
+    FileInfo linkInfo;
+    std::error_code ec;
+
+    ASSERT_TRUE(fileInfo(file, info, ec));
+    ASSERT_TRUE(fileInfo(link, linkInfo, ec));
+    EXPECT_EQ(info.size, 5U);
+    EXPECT_EQ(info.links, 2U);
+    EXPECT_NE(info.mtime, 0);
+
+    // Hard links share the identity
+    EXPECT_EQ(info.device, linkInfo.device);
+    EXPECT_EQ(info.inode, linkInfo.inode);
+
+    write(testDir_ / "other.txt", "12345");
+    FileInfo otherInfo;
+    ASSERT_TRUE(fileInfo(testDir_ / "other.txt", otherInfo, ec));
+    EXPECT_NE(info.inode, otherInfo.inode);
+
+    EXPECT_FALSE(fileInfo(testDir_ / "missing.txt", info, ec));
+    EXPECT_TRUE(ec);
+}
+
+TEST_F(UtilsFileTests, RotationalDevice)
+{
+    // There is no block device 0:0
+    EXPECT_FALSE(rotationalDevice(0).has_value());
+
+    // The answer depends on the machine, the query must not fail
+    FileInfo info;
+    std::error_code ec;
+    ASSERT_TRUE(fileInfo(testDir_, info, ec));
+    EXPECT_NO_THROW(rotationalDevice(info.device));
+}
+
+TEST_F(UtilsFileTests, PhysicalOffset)
+{
+    EXPECT_FALSE(physicalOffset(testDir_ / "missing").has_value());
+
+    // Not all file systems report the extents, e.g. tmpfs, the query must not fail
+    const auto file = testDir_ / "extent.bin";
+    write(file, std::string(64 * 1024, 'x'));
+    EXPECT_NO_THROW(physicalOffset(file));
+
+    // Nothing is allocated for an empty file
+    const auto empty = testDir_ / "empty.bin";
+    write(empty, "");
+    EXPECT_FALSE(physicalOffset(empty).has_value());
+}
+
 } // namespace
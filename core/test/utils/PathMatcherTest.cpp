@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <core/utils/PathMatcher.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace core::file;
+
+namespace {
+
+bool regexSearch(const std::vector<std::string>& patterns, const fs::path& path)
+{
+    return std::ranges::any_of(patterns, [&path](const auto& pattern) {
+        return std::regex_search(path.string(), std::regex(pattern));
+    });
+}
+
+const std::vector<fs::path> PATHS {
+    "/home/user/data/report.log",
+    "/home/user/data/report.log.bak",
+    "/home/user/archive.zip",
+    "/home/user/archive.ZIP",
+    "/home/user/project/node_modules/pkg/index.js",
+    "/home/user/project/node_modules",
+    "/home/user/project/my_node_modules/index.js",
+    "/home/user/project/build",
+    "/home/user/project/build/out.o",
+    "/home/user/project/rebuild",
+    "/home/user/project/.git/config",
+    "/home/user/project/.gitignore",
+    "/abs/file.tmp",
+    "/home/abs/file.txt",
+    "/home/user/price$",
+    "/home/user/aa/aa",
+    "/home/user/ab/ab",
+    "/tmp",
+};
+
+} // namespace
+
+TEST(PathMatcherTest, EmptyMatchesNothing)
+{
+    const PathMatcher matcher;
+
+    EXPECT_TRUE(matcher.empty());
+    EXPECT_FALSE(matcher.matches("/home/user/file"));
+    EXPECT_FALSE(matcher.prunable("/home/user"));
+}
+
+TEST(PathMatcherTest, SameResultAsRegexSearch)
+{
+    const std::vector<std::vector<std::string>> patternSets {
+        {R"(\.(log|zip)$)"},
+        {R"(.*\.tmp$)", R"(\.(?:bak|old)$)"},
+        {"/node_modules/"},
+        {"/node_modules$", "/build/"},
+        {"/project/build$"},
+        {"^/abs"},
+        {R"(\.git)"},
+        {R"(\.git/)"},
+        {R"(price\$)"},
+        {R"(/(\w+)/\1$)"},
+        {"/aa/aa$", "/node_modules/", R"(\.log$)", "^/tmp"},
+        {"config$", "index.js$", R"(/\.git/)"},
+    };
+
+    for (const auto& patterns : patternSets)
+    {
+        const PathMatcher matcher(patterns);
+        EXPECT_FALSE(matcher.empty());
+
+        for (const auto& path : PATHS)
+        {
+            EXPECT_EQ(matcher.matches(path), regexSearch(patterns, path))
+                << path << " with " << patterns.front();
+        }
+    }
+}
+
+TEST(PathMatcherTest, DirectoriesArePrunable)
+{
+    const PathMatcher matcher({"/node_modules/", "/build$", R"(\.log$)"});
+
+    EXPECT_TRUE(matcher.prunable("/home/user/project/node_modules"));
+    EXPECT_TRUE(matcher.prunable("/node_modules"));
+    EXPECT_FALSE(matcher.prunable("/home/user/project/my_node_modules"));
+    EXPECT_FALSE(matcher.prunable("/home/user/project"));
+
+    // Matches the directory, but not its descendants
+    EXPECT_FALSE(matcher.prunable("/home/user/project/build"));
+    EXPECT_TRUE(matcher.matches("/home/user/project/build"));
+    EXPECT_FALSE(matcher.matches("/home/user/project/build/out.o"));
+
+    // Only the patterns with literal components can prune
+    EXPECT_FALSE(matcher.prunable("/home/user/data.log"));
+}
+
+TEST(PathMatcherTest, InvalidPatternThrows)
+{
+    EXPECT_THROW(PathMatcher({"(unclosed"}), std::regex_error);
+}
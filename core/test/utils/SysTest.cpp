@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include <core/utils/Sys.h>
 
+#include <chrono>
+#include <vector>
+
 namespace {
 
 TEST(UtilsSysTests, CurrentProcessPath)
@@ -9,4 +12,59 @@ TEST(UtilsSysTests, CurrentProcessPath)
     EXPECT_EQ(path.filename().stem().string(), "core-test");
 }
 
-} // namespace
\ No newline at end of file
+TEST(UtilsSysTests, PeakMemoryUsage)
+{
+    using namespace core::sys;
+
+    if (currentProcessMemoryUsage() == 0)
+    {
+        GTEST_SKIP() << "The memory usage is not available";
+    }
+
+    constexpr size_t blockSize = 64 * 1024 * 1024;
+    {
+        // Every page is touched
+        const std::vector<char> block(blockSize, 'x');
+        EXPECT_GE(currentProcessMemoryUsage(), blockSize);
+    }
+
+    const auto peak = currentProcessPeakMemoryUsage();
+    EXPECT_GE(peak, blockSize);
+    EXPECT_GE(peak, currentProcessMemoryUsage());
+
+    if (!resetPeakMemoryUsage())
+    {
+        GTEST_SKIP() << "The peak memory usage can't be reset";
+    }
+
+    EXPECT_LT(currentProcessPeakMemoryUsage(), peak);
+}
+
+TEST(UtilsSysTests, CpuTimeGrowsWhileBusy)
+{
+    using namespace core::sys;
+    using namespace std::chrono_literals;
+
+    const auto start = currentProcessCpuTime();
+    if (start == 0ns)
+    {
+        GTEST_SKIP() << "The CPU time is not available";
+    }
+
+    // Spin until some CPU time is consumed, the wall time bounds the loop
+    volatile uint64_t sink = 0;
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+
+    while (currentProcessCpuTime() - start < 10ms &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        for (uint64_t i = 0; i < 100000; ++i)
+        {
+            sink = sink + i;
+        }
+    }
+
+    EXPECT_GE(currentProcessCpuTime() - start, 10ms);
+}
+
+} // namespace
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include <core/utils/File.h>
+#include <core/utils/UringReader.h>
+
+#include <filesystem>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace core::file;
+
+namespace {
+
+class UringReaderTest : public ::testing::Test
+{
+protected:
+    TempDir dir_ {"uring-reader"};
+
+    void SetUp() override
+    {
+        if (!UringReader::supported())
+        {
+            GTEST_SKIP() << "The io_uring is not supported";
+        }
+    }
+
+    // Files of different sizes, some of them larger than a buffer
+    std::vector<std::pair<fs::path, std::string>> createFiles(size_t count) const
+    {
+        std::vector<std::pair<fs::path, std::string>> files;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::string data;
+            for (size_t k = 0; k < i * 1000; ++k)
+            {
+                data.push_back(static_cast<char>('a' + (i + k) % 26));
+            }
+
+            const auto path = dir_.path() / std::format("f{}", i);
+            write(path, data);
+            files.emplace_back(path, std::move(data));
+        }
+
+        return files;
+    }
+};
+
+} // namespace
+
+TEST_F(UringReaderTest, ReadsAllRequests)
+{
+    const auto files = createFiles(20);
+    UringReader reader({.depth = 4, .bufferSize = FileReader::ALIGNMENT});
+
+    std::vector<std::string> contents(files.size() + 1);
+    std::vector<int> finished(files.size() + 1, 0);
+    std::vector<std::error_code> errors(files.size() + 1);
+
+    reader.read(
+        files.size() + 1,
+        [&files, this](size_t i) {
+            // The last one doesn't exist
+            if (i == files.size())
+            {
+                return ReadRequest {.path = dir_.path() / "missing", .ranges = {{0, 1}}};
+            }
+
+            // Whole file followed by a range past its end
+            return ReadRequest {
+                .path = files[i].first,
+                .ranges = {{0, UINT64_MAX}, {files[i].second.size() + 1, 10}},
+            };
+        },
+        [&contents](size_t i, std::string_view chunk) {
+            EXPECT_LE(chunk.size(), FileReader::ALIGNMENT);
+            contents[i] += chunk;
+        },
+        [&finished, &errors](size_t i, const std::error_code& ec) {
+            ++finished[i];
+            errors[i] = ec;
+        });
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        EXPECT_EQ(finished[i], 1);
+        EXPECT_FALSE(errors[i]) << errors[i].message();
+        EXPECT_EQ(contents[i], files[i].second) << files[i].first;
+    }
+
+    EXPECT_EQ(finished.back(), 1);
+    EXPECT_EQ(errors.back(), std::errc::no_such_file_or_directory);
+}
+
+TEST_F(UringReaderTest, ReadsRangesInOrder)
+{
+    const auto files = createFiles(6);
+    const auto& [path, data] = files.back();
+    UringReader reader({.depth = 2, .bufferSize = FileReader::ALIGNMENT});
+
+    std::string content;
+    reader.read(
+        1,
+        [&path](size_t) {
+            return ReadRequest {.path = path, .ranges = {{4500, 10}, {3, 4100}}};
+        },
+        [&content](size_t, std::string_view chunk) {
+            content += chunk;
+        },
+        [](size_t, const std::error_code& ec) {
+            EXPECT_FALSE(ec);
+        });
+
+    EXPECT_EQ(content, data.substr(4500, 10) + data.substr(3, 4100));
+}
+
+TEST_F(UringReaderTest, CallbackExceptionsArePropagated)
+{
+    const auto files = createFiles(10);
+    UringReader reader({.depth = 4, .bufferSize = FileReader::ALIGNMENT});
+
+    auto source = [&files](size_t i) {
+        return ReadRequest {.path = files[i].first, .ranges = {{0, UINT64_MAX}}};
+    };
+
+    EXPECT_THROW(reader.read(
+                     files.size(),
+                     source,
+                     [](size_t, std::string_view) {
+                         throw std::runtime_error("stop");
+                     },
+                     [](size_t, const std::error_code&) {}),
+                 std::runtime_error);
+
+    // The reader stays usable
+    size_t finished = 0;
+    reader.read(
+        files.size(),
+        source,
+        [](size_t, std::string_view) {},
+        [&finished](size_t, const std::error_code&) {
+            ++finished;
+        });
+    EXPECT_EQ(finished, files.size());
+}
@@ -0,0 +1,96 @@
+#include "Allocations.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+    #include <malloc.h>
+#endif
+
+namespace tools::dups::bench {
+namespace {
+
+std::atomic<uint64_t> allocations {0};
+std::atomic<uint64_t> allocatedBytes {0};
+
+void* allocate(size_t size, size_t alignment)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+    // Every allocation returns a unique pointer, even of zero bytes
+    const size_t bytes = size > 0 ? size : 1;
+    void* ptr = nullptr;
+
+    if (alignment <= alignof(std::max_align_t))
+    {
+        ptr = std::malloc(bytes);
+    }
+    else
+    {
+#ifdef _WIN32
+        ptr = _aligned_malloc(bytes, alignment);
+#else
+        // The size of an aligned allocation is a multiple of the alignment
+        ptr = std::aligned_alloc(alignment,
+                                 (bytes + alignment - 1) / alignment * alignment);
+#endif
+    }
+
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return ptr;
+}
+
+} // namespace
+
+AllocationCounts allocationCounts() noexcept
+{
+    return {
+        .count = allocations.load(std::memory_order_relaxed),
+        .bytes = allocatedBytes.load(std::memory_order_relaxed),
+    };
+}
+
+} // namespace tools::dups::bench
+
+// The other forms of the operators, e.g. the arrays and the nothrow ones, are
+// implemented by the standard library in terms of these
+void* operator new(size_t size)
+{
+    return tools::dups::bench::allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    return tools::dups::bench::allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(ptr, alignment);
+}
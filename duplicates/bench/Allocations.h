@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+namespace tools::dups::bench {
+
+struct AllocationCounts
+{
+    // Number of calls of the global operator new
+    uint64_t count {};
+
+    // Bytes requested by them
+    uint64_t bytes {};
+};
+
+/**
+ * @brief Allocations made by the whole process since it started. The global
+ * operators new and delete of the benchmark count them.
+ */
+AllocationCounts allocationCounts() noexcept;
+
+} // namespace tools::dups::bench
@@ -0,0 +1,225 @@
+#include "Benchmark.h"
+#include "Allocations.h"
+
+#include <duplicates/DuplicateDetector.h>
+#include <core/utils/DirWalker.h>
+#include <core/utils/FmtExt.h>
+#include <core/utils/Sys.h>
+#include <spdlog/spdlog.h>
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include <optional>
+#include <system_error>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+namespace tools::dups::bench {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Measures a stage from the construction until `finish` is called. The
+ * measurement itself is left out as much as possible.
+ */
+class StageMeter
+{
+public:
+    explicit StageMeter(std::string name)
+        : name_ {std::move(name)}
+    {
+        core::sys::resetPeakMemoryUsage();
+        allocations_ = allocationCounts();
+        start_ = Clock::now();
+    }
+
+    StageResult finish() const
+    {
+        const auto end = Clock::now();
+        const auto allocations = allocationCounts();
+
+        return {
+            .name = name_,
+            .wall = end - start_,
+            .peakRssBytes = core::sys::currentProcessPeakMemoryUsage(),
+            .allocations = allocations.count - allocations_.count,
+            .allocatedBytes = allocations.bytes - allocations_.bytes,
+        };
+    }
+
+private:
+    std::string name_;
+    AllocationCounts allocations_;
+    Clock::time_point start_;
+};
+
+void dropCache(const fs::path& root)
+{
+#ifdef __linux__
+    for (const auto& entry : fs::recursive_directory_iterator(root))
+    {
+        if (!entry.is_regular_file())
+        {
+            continue;
+        }
+
+        const int fd = ::open(entry.path().c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        // Dirty pages can't be dropped, they are written first
+        ::fdatasync(fd);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+#else
+    std::ignore = root;
+    spdlog::warn("The page cache can't be dropped on this platform");
+#endif
+}
+
+void scan(const fs::path& root, bool scanSizes, DuplicateDetector& detector)
+{
+    const core::file::DirWalker walker({
+        .stat = scanSizes,
+        .deterministic = true,
+    });
+
+    walker.walk(root, [&detector](const auto& entry, const std::error_code& ec) {
+        if (ec)
+        {
+            spdlog::error("Error: '{}' while processing path: '{}'",
+                          ec.message(),
+                          entry.path);
+            return;
+        }
+
+        if (entry.type != core::file::EntryType::Regular)
+        {
+            return;
+        }
+
+        FileMeta meta;
+        if (entry.info)
+        {
+            meta.id = {entry.info->device, entry.info->inode};
+            meta.size = entry.info->size;
+        }
+
+        detector.addFile(entry.path, meta);
+    });
+}
+
+} // namespace
+
+double StageResult::seconds() const noexcept
+{
+    return std::chrono::duration<double>(wall).count();
+}
+
+double StageResult::filesPerSecond() const noexcept
+{
+    return wall.count() > 0 ? static_cast<double>(files) / seconds() : 0;
+}
+
+double StageResult::mbPerSecond() const noexcept
+{
+    return wall.count() > 0 ? static_cast<double>(bytes) / 1e6 / seconds() : 0;
+}
+
+RunResult runPipeline(const fs::path& root, const RunOptions& opts)
+{
+    if (opts.dropCache)
+    {
+        dropCache(root);
+    }
+
+    RunResult result;
+    DuplicateDetector detector;
+
+    StageMeter scanMeter("scan");
+    scan(root, opts.scanSizes, detector);
+    auto scanned = scanMeter.finish();
+
+    // The first hashed file ends the preparation
+    std::optional<StageMeter> hashMeter;
+    std::optional<StageResult> prepared;
+
+    Options detection = opts.detection;
+    detection.checkpoint = {};
+    detection.resume = nullptr;
+    detection.onGroup = {};
+
+    StageMeter prepareMeter("prepare");
+    detector.detect(detection, [&](Stage stage, const Node*, size_t) {
+        if (stage != Stage::Prepare && !hashMeter)
+        {
+            prepared = prepareMeter.finish();
+            hashMeter.emplace("hash");
+        }
+    });
+
+    if (!hashMeter)
+    {
+        prepared = prepareMeter.finish();
+        hashMeter.emplace("hash");
+    }
+    auto hashed = hashMeter->finish();
+
+    // The bytes are the ones actually read by the rounds
+    for (const auto& stage : detector.stats().stages)
+    {
+        hashed.bytes += stage.bytes;
+    }
+
+    // The files sharing the size with another file are candidates
+    std::unordered_map<uint64_t, size_t> sizes;
+    detector.root()->enumLeafs([&](const Node* node) {
+        ++sizes[node->size()];
+        ++scanned.files;
+        scanned.bytes += node->size();
+    });
+
+    for (const auto& [size, count] : sizes)
+    {
+        if (count > 1)
+        {
+            hashed.files += count;
+        }
+    }
+
+    prepared->files = scanned.files;
+    prepared->bytes = scanned.bytes;
+
+    StageMeter groupMeter("group");
+    size_t groupFiles = 0;
+    uint64_t groupBytes = 0;
+
+    for (const auto& group : detector.groups())
+    {
+        ++result.groups;
+        groupFiles += group.entries.size();
+        groupBytes += group.entries.front().size() * group.entries.size();
+    }
+
+    auto grouped = groupMeter.finish();
+    grouped.files = groupFiles;
+    grouped.bytes = groupBytes;
+    result.duplicates = groupFiles - result.groups;
+
+    result.stages = {std::move(scanned),
+                     std::move(*prepared),
+                     std::move(hashed),
+                     std::move(grouped)};
+
+    return result;
+}
+
+} // namespace tools::dups::bench
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <duplicates/IDuplicates.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace tools::dups::bench {
+
+/**
+ * @brief Measurements of a stage of the pipeline
+ */
+struct StageResult
+{
+    std::string name {};
+    std::chrono::nanoseconds wall {};
+
+    // Files and bytes taking part in the stage
+    size_t files {};
+    uint64_t bytes {};
+
+    // Peak resident memory of the process during the stage, 0 if not available
+    size_t peakRssBytes {};
+
+    // Allocations made during the stage
+    uint64_t allocations {};
+    uint64_t allocatedBytes {};
+
+    double seconds() const noexcept;
+    double filesPerSecond() const noexcept;
+    double mbPerSecond() const noexcept;
+};
+
+struct RunResult
+{
+    std::vector<StageResult> stages {};
+    size_t groups {};
+
+    // Files which can be deleted, all but one of every group
+    size_t duplicates {};
+};
+
+struct RunOptions
+{
+    // Settings of the detection, the callbacks are set by the benchmark
+    Options detection {};
+
+    // The scan records the sizes of the files, otherwise they are queried by the
+    // detection
+    bool scanSizes {true};
+
+    // The files are evicted from the page cache before the run, Linux only
+    bool dropCache {false};
+};
+
+/**
+ * @brief Find the duplicates of the tree and measure the stages of the pipeline:
+ *
+ *   - scan:    walking the tree and adding the files to the detector
+ *   - prepare: grouping the files by size until the first file is hashed
+ *   - hash:    narrowing the groups down to the files with equal content
+ *   - group:   enumerating the detected groups
+ */
+RunResult runPipeline(const fs::path& root, const RunOptions& opts);
+
+} // namespace tools::dups::bench
@@ -0,0 +1,250 @@
+#include "Benchmark.h"
+#include "SyntheticTree.h"
+
+#include <duplicates/Config.h>
+
+#include <BuildInfo.h>
+
+#include <core/utils/File.h>
+#include <core/utils/FmtExt.h>
+
+#include <cxxopts.hpp>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+using namespace tools::dups;
+using namespace tools::dups::bench;
+using nlohmann::json;
+
+namespace {
+
+void defineOptions(cxxopts::Options& opts)
+{
+    // clang-format off
+    opts.add_options()
+        ("h,help", "Print usage")
+
+        ("dir", "Empty or missing directory to generate the tree in and keep it, a "
+                "temporary one is used otherwise",
+            cxxopts::value<std::string>())
+
+        ("files", "Number of files of the tree",
+            cxxopts::value<uint64_t>()->default_value("10000"))
+
+        ("depth", "Levels of directories below the root",
+            cxxopts::value<uint64_t>()->default_value("3"))
+
+        ("fanout", "Subdirectories of every directory",
+            cxxopts::value<uint64_t>()->default_value("8"))
+
+        ("min-size", "Size of the smallest file (bytes)",
+            cxxopts::value<uint64_t>()->default_value("1024"))
+
+        ("max-size", "Size of the largest file (bytes)",
+            cxxopts::value<uint64_t>()->default_value("1048576"))
+
+        ("distribution", "Distribution of the sizes, 'uniform' or 'log-uniform'",
+            cxxopts::value<std::string>()->default_value("log-uniform"))
+
+        ("dup-ratio", "Fraction of the files which are copies of another file",
+            cxxopts::value<double>()->default_value("0.2"))
+
+        ("seed", "Seed of the generated tree",
+            cxxopts::value<uint64_t>()->default_value("1"))
+
+        ("runs", "Number of the measured runs",
+            cxxopts::value<uint64_t>()->default_value("3"))
+
+        ("hash-workers", "Number of hashing threads (0 uses all hardware threads)",
+            cxxopts::value<uint64_t>()->default_value("0"))
+
+        ("read-backend", "Reading files with 'threads' or 'io_uring' (Linux only)",
+            cxxopts::value<std::string>()->default_value("threads"))
+
+        ("scan-sizes", "Take the sizes of the files from the scan",
+            cxxopts::value<bool>()->default_value("true"))
+
+        ("drop-cache", "Evict the files from the page cache before every run",
+            cxxopts::value<bool>()->default_value("false"))
+
+        ("out", "File to write the results to as JSON",
+            cxxopts::value<std::string>()->default_value("bench.json"));
+    // clang-format on
+}
+
+json toJson(const StageResult& stage)
+{
+    return {
+        {"name", stage.name},
+        {"seconds", stage.seconds()},
+        {"files", stage.files},
+        {"bytes", stage.bytes},
+        {"filesPerSec", stage.filesPerSecond()},
+        {"mbPerSec", stage.mbPerSecond()},
+        {"peakRssBytes", stage.peakRssBytes},
+        {"allocations", stage.allocations},
+        {"allocatedBytes", stage.allocatedBytes},
+    };
+}
+
+void printRun(size_t run, const RunResult& result)
+{
+    std::cout << std::format("Run {}: {} groups, {} duplicates\n",
+                             run,
+                             result.groups,
+                             result.duplicates);
+
+    for (const auto& stage : result.stages)
+    {
+        std::cout << std::format(
+            "  {:<8} {:>9.3f} s {:>12.0f} files/s {:>9.1f} MB/s {:>8} MB peak "
+            "{:>10} allocs\n",
+            stage.name,
+            stage.seconds(),
+            stage.filesPerSecond(),
+            stage.mbPerSecond(),
+            stage.peakRssBytes / (1024 * 1024),
+            stage.allocations);
+    }
+}
+
+} // namespace
+
+int main(int argc, const char* argv[])
+{
+    try
+    {
+        cxxopts::Options opts("duplicates-bench",
+                              "Benchmark of the duplicates detection on a synthetic "
+                              "tree");
+        defineOptions(opts);
+        const auto args = opts.parse(argc, argv);
+
+        if (args.contains("help"))
+        {
+            std::cout << opts.help() << '\n';
+            return 0;
+        }
+
+        spdlog::set_level(spdlog::level::warn);
+
+        const TreeSpec spec {
+            .files = args["files"].as<uint64_t>(),
+            .depth = args["depth"].as<uint64_t>(),
+            .fanout = args["fanout"].as<uint64_t>(),
+            .minSize = args["min-size"].as<uint64_t>(),
+            .maxSize = args["max-size"].as<uint64_t>(),
+            .distribution = str2distribution(args["distribution"].as<std::string>()),
+            .duplicateRatio = args["dup-ratio"].as<double>(),
+            .seed = args["seed"].as<uint64_t>(),
+        };
+
+        RunOptions runOpts {
+            .detection = {.hashWorkers = args["hash-workers"].as<uint64_t>(),
+                          .readBackend =
+                              str2backend(args["read-backend"].as<std::string>())},
+            .scanSizes = args["scan-sizes"].as<bool>(),
+            .dropCache = args["drop-cache"].as<bool>(),
+        };
+
+        // The tree is never generated over existing files
+        std::optional<core::file::TempDir> tempDir;
+        fs::path root;
+
+        if (args.contains("dir"))
+        {
+            root = args["dir"].as<std::string>();
+            if (fs::exists(root) && !fs::is_empty(root))
+            {
+                throw std::invalid_argument(
+                    std::format("The directory is not empty: '{}'", root));
+            }
+        }
+        else
+        {
+            root = tempDir.emplace("duplicates-bench").path();
+        }
+
+        std::cout << std::format("Generating {} files in: '{}'\n", spec.files, root);
+        const auto tree = generateTree(root, spec);
+
+        json results {
+            {"version", BuildInfo::Version},
+            {"commit", BuildInfo::CommitSHA},
+            {"buildTimestamp", BuildInfo::Timestamp},
+            {"tree",
+             {
+                 {"files", tree.files},
+                 {"directories", tree.directories},
+                 {"bytes", tree.bytes},
+                 {"copies", tree.copies},
+                 {"depth", spec.depth},
+                 {"fanout", spec.fanout},
+                 {"minSize", spec.minSize},
+                 {"maxSize", spec.maxSize},
+                 {"distribution", distribution2str(spec.distribution)},
+                 {"duplicateRatio", spec.duplicateRatio},
+                 {"seed", spec.seed},
+             }},
+            {"options",
+             {
+                 {"hashWorkers", runOpts.detection.hashWorkers},
+                 {"readBackend", backend2str(runOpts.detection.readBackend)},
+                 {"scanSizes", runOpts.scanSizes},
+                 {"dropCache", runOpts.dropCache},
+             }},
+        };
+
+        json runs = json::array();
+        const auto numRuns = args["runs"].as<uint64_t>();
+
+        for (size_t run = 1; run <= numRuns; ++run)
+        {
+            const auto result = runPipeline(root, runOpts);
+            printRun(run, result);
+
+            json stages = json::array();
+            for (const auto& stage : result.stages)
+            {
+                stages.push_back(toJson(stage));
+            }
+
+            runs.push_back({
+                {"groups", result.groups},
+                {"duplicates", result.duplicates},
+                {"stages", std::move(stages)},
+            });
+        }
+
+        results["runs"] = std::move(runs);
+
+        const fs::path out = args["out"].as<std::string>();
+        std::ofstream outf(out, std::ios::out | std::ios::binary);
+
+        if (!outf)
+        {
+            throw std::system_error(
+                std::make_error_code(std::errc::no_such_file_or_directory),
+                std::format("Unable to open file: '{}'", out));
+        }
+
+        outf << results.dump(2) << '\n';
+        std::cout << std::format("Results written to: '{}'\n", out);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "SyntheticTree.h"
+
+#include <core/utils/File.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace tools::dups::bench {
+namespace {
+
+/**
+ * @brief The splitmix64 generator. Unlike the distributions of the standard library
+ * it produces the same sequence with every compiler.
+ */
+class Random
+{
+public:
+    explicit Random(uint64_t seed)
+        : state_ {seed}
+    {
+    }
+
+    uint64_t next() noexcept
+    {
+        uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27U)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31U);
+    }
+
+    // In [0, 1)
+    double uniform() noexcept
+    {
+        return static_cast<double>(next() >> 11U) * 0x1.0p-53;
+    }
+
+    // In [0, n)
+    uint64_t below(uint64_t n) noexcept
+    {
+        return n > 0 ? next() % n : 0;
+    }
+
+private:
+    uint64_t state_ {};
+};
+
+uint64_t randomSize(Random& random, const TreeSpec& spec)
+{
+    const auto minSize = std::max<uint64_t>(spec.minSize, 1);
+    const auto maxSize = std::max(spec.maxSize, minSize);
+
+    if (spec.distribution == SizeDistribution::Uniform)
+    {
+        return minSize + random.below(maxSize - minSize + 1);
+    }
+
+    const auto low = std::log2(static_cast<double>(minSize));
+    const auto high = std::log2(static_cast<double>(maxSize));
+    const auto size =
+        static_cast<uint64_t>(std::exp2(low + (high - low) * random.uniform()));
+
+    return std::clamp(size, minSize, maxSize);
+}
+
+void fillContent(uint64_t seed, uint64_t size, std::string& content)
+{
+    Random random(seed);
+    content.resize(size);
+
+    for (size_t i = 0; i < content.size(); i += sizeof(uint64_t))
+    {
+        const auto value = random.next();
+        const auto bytes = std::min(sizeof(uint64_t), content.size() - i);
+        std::copy_n(reinterpret_cast<const char*>(&value), bytes, content.data() + i);
+    }
+}
+
+std::vector<fs::path> createDirectories(const fs::path& root, const TreeSpec& spec)
+{
+    std::vector<fs::path> dirs {root};
+    size_t levelBegin = 0;
+
+    for (size_t level = 0; level < spec.depth; ++level)
+    {
+        const size_t levelEnd = dirs.size();
+
+        for (size_t d = levelBegin; d < levelEnd; ++d)
+        {
+            for (size_t k = 0; k < spec.fanout; ++k)
+            {
+                dirs.push_back(dirs[d] / std::format("d{}", k));
+            }
+        }
+
+        levelBegin = levelEnd;
+    }
+
+    for (const auto& dir : dirs)
+    {
+        fs::create_directories(dir);
+    }
+
+    return dirs;
+}
+
+constexpr std::array<std::string_view, 2> DISTRIBUTION_NAMES {"uniform",
+                                                              "log-uniform"};
+
+} // namespace
+
+TreeStats generateTree(const fs::path& root, const TreeSpec& spec)
+{
+    const auto dirs = createDirectories(root, spec);
+
+    // Seeds and sizes of the original contents, the copies repeat them
+    struct Original
+    {
+        uint64_t seed {};
+        uint64_t size {};
+    };
+
+    std::vector<Original> originals;
+    Random random(spec.seed);
+    TreeStats stats {.directories = dirs.size()};
+    std::string content;
+
+    for (size_t i = 0; i < spec.files; ++i)
+    {
+        const auto& dir = dirs[random.below(dirs.size())];
+        const bool copy = !originals.empty() && random.uniform() < spec.duplicateRatio;
+        Original original;
+
+        if (copy)
+        {
+            original = originals[random.below(originals.size())];
+            ++stats.copies;
+        }
+        else
+        {
+            original = {.seed = random.next(), .size = randomSize(random, spec)};
+            originals.push_back(original);
+        }
+
+        fillContent(original.seed, original.size, content);
+        core::file::write(dir / std::format("f{}.bin", i), content);
+
+        ++stats.files;
+        stats.bytes += original.size;
+    }
+
+    return stats;
+}
+
+std::string_view distribution2str(SizeDistribution distribution) noexcept
+{
+    return DISTRIBUTION_NAMES[static_cast<size_t>(distribution)];
+}
+
+SizeDistribution str2distribution(std::string_view name)
+{
+    for (const auto distribution :
+         {SizeDistribution::Uniform, SizeDistribution::LogUniform})
+    {
+        if (distribution2str(distribution) == name)
+        {
+            return distribution;
+        }
+    }
+
+    throw std::invalid_argument(std::format("Unknown size distribution: '{}'", name));
+}
+
+} // namespace tools::dups::bench
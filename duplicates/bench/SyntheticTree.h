@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+namespace tools::dups::bench {
+
+enum class SizeDistribution
+{
+    // Every size of the range is equally likely
+    Uniform,
+
+    // Every power of two of the range is equally likely, small files dominate like
+    // in real trees
+    LogUniform
+};
+
+/**
+ * @brief Shape of a synthetic tree, the same specification always produces the same
+ * tree
+ */
+struct TreeSpec
+{
+    size_t files {10'000};
+
+    // Levels of directories below the root and the number of subdirectories of every
+    // directory above the last level. The files are spread over all of them.
+    size_t depth {3};
+    size_t fanout {8};
+
+    uint64_t minSize {1024};
+    uint64_t maxSize {1024 * 1024};
+    SizeDistribution distribution {SizeDistribution::LogUniform};
+
+    // Fraction of the files which are copies of another file
+    double duplicateRatio {0.2};
+
+    uint64_t seed {1};
+};
+
+struct TreeStats
+{
+    size_t files {};
+    size_t directories {};
+    uint64_t bytes {};
+
+    // Files with the content of another file
+    size_t copies {};
+};
+
+/**
+ * @brief Create the files of the tree in the given directory
+ *
+ * @throw std::system_error if a file or directory can't be created
+ */
+TreeStats generateTree(const fs::path& root, const TreeSpec& spec);
+
+/**
+ * @brief Name of the distribution as used by the command line
+ */
+std::string_view distribution2str(SizeDistribution distribution) noexcept;
+
+/**
+ * @brief Parse the name of a distribution, `uniform` or `log-uniform`
+ *
+ * @throw std::invalid_argument for unknown names
+ */
+SizeDistribution str2distribution(std::string_view name);
+
+} // namespace tools::dups::bench
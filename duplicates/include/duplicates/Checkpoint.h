@@ -0,0 +1,88 @@
+#pragma once
+
+#include <duplicates/DuplicateDetector.h>
+#include <core/utils/Crypto.h>
+
+#include <cstddef>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace tools::dups {
+
+/**
+ * @brief Persistent progress of a detection, allows an interrupted run to continue
+ * where it stopped
+ *
+ * The checkpoint consists of two files:
+ *
+ *   - the scanned files with their identities, sizes and modification times,
+ *     written once the scan is over. The paths are listed in the order of their
+ *     enumeration, every path omits the prefix it shares with the previous one.
+ *     They are followed by the directories the scan left some entries of out.
+ *   - the state of the detection, replaced every time a new one is reported
+ *
+ * Both files start with the fingerprint of the settings the scan depends on, the
+ * checkpoint of a different scan is never loaded. The files are replaced
+ * atomically, an interrupted write leaves the previous version in place.
+ */
+class Checkpoint
+{
+public:
+    using Fingerprint = core::crypto::Digest;
+
+    /**
+     * @brief Open the checkpoint stored in the given directory, the directory is
+     * created if it doesn't exist
+     */
+    Checkpoint(fs::path dir, const Fingerprint& fingerprint);
+
+    /**
+     * @brief Store the files of the detector, the previous checkpoint no longer
+     * applies and is removed
+     *
+     * @throw std::system_error if the file can't be written
+     */
+    void saveFiles(const DuplicateDetector& detector);
+
+    /**
+     * @brief Add the stored files to the detector, the way the scan added them
+     *
+     * @return false if there are no files with the same fingerprint, nothing is
+     *         added in that case
+     */
+    bool loadFiles(DuplicateDetector& detector) const;
+
+    /**
+     * @brief Store the state of the detection of `numFiles` files
+     *
+     * @throw std::system_error if the file can't be written
+     */
+    void saveState(size_t numFiles, const DetectionState& state);
+
+    /**
+     * @brief Load the stored state of the detection of `numFiles` files
+     *
+     * @return false if there is no state with the same fingerprint and number of
+     *         files
+     */
+    bool loadState(size_t numFiles, DetectionState& state) const;
+
+    /**
+     * @brief Same as above for the files of the detector, restored from the
+     * checkpoint. The files are queried again, the ones which changed since the
+     * scan or are gone are dropped from the state along with their digests, the
+     * groups left with a single file as well.
+     */
+    bool loadState(const DuplicateDetector& detector, DetectionState& state) const;
+
+    const fs::path& filesPath() const noexcept;
+    const fs::path& statePath() const noexcept;
+
+private:
+    fs::path filesPath_;
+    fs::path statePath_;
+    Fingerprint fingerprint_;
+};
+
+} // namespace tools::dups
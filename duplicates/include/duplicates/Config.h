@@ -1,7 +1,10 @@
 #pragma once
 
+#include <duplicates/IDuplicates.h>
+
 #include <vector>
-#include <regex>
+#include <string>
+#include <string_view>
 #include <filesystem>
 #include <chrono>
 
@@ -18,6 +21,28 @@ public:
     void setScanDirs(std::vector<fs::path> dirs);
     void addScanDir(fs::path dir);
 
+    /**
+     * @brief Directories of the backup set. When given, only the files of the scan
+     * directories which have copies in the backup set are reported.
+     */
+    const std::vector<fs::path>& backupDirs() const noexcept;
+    void setBackupDirs(std::vector<fs::path> dirs);
+    void addBackupDir(fs::path dir);
+
+    /**
+     * @brief Manifests of the files of other hosts, their files are detected together
+     * with the scanned ones without being read
+     */
+    const std::vector<fs::path>& manifests() const noexcept;
+    void setManifests(std::vector<fs::path> files);
+    void addManifest(fs::path file);
+
+    /**
+     * @brief File to write the manifest of the scanned files to, empty skips it
+     */
+    const fs::path& exportManifestPath() const noexcept;
+    void setExportManifestPath(fs::path path);
+
     const std::vector<fs::path>& dirsToKeepFrom() const noexcept;
     void setDirsToKeepFrom(std::vector<fs::path> dirs);
     void addDirToKeepFrom(fs::path dir);
@@ -26,7 +51,7 @@ public:
     void setDirsToDeleteFrom(std::vector<fs::path> dirs);
     void addDirToDeleteFrom(fs::path dir);
 
-    const std::vector<std::regex>& exclusionPatterns() const noexcept;
+    const std::vector<std::string>& exclusionPatterns() const noexcept;
     void setExclusionPatterns(const std::vector<std::string>& patterns);
     void addExclusionPattern(std::string_view pattern);
 
@@ -39,6 +64,9 @@ public:
     const fs::path& dupFilesPath() const noexcept;
     void setDupFilesPath(fs::path path);
 
+    const fs::path& statsFilePath() const noexcept;
+    void setStatsFilePath(fs::path path);
+
     const fs::path& ignFilesPath() const noexcept;
     void setIgnFilesPath(fs::path path);
 
@@ -60,9 +88,48 @@ public:
     size_t maxFileSizeBytes() const noexcept;
     void setMaxFileSizeBytes(size_t bytes);
 
+    size_t hashWorkers() const noexcept;
+    void setHashWorkers(size_t workers);
+
+    size_t hddWorkers() const noexcept;
+    void setHddWorkers(size_t workers);
+
+    size_t ssdWorkers() const noexcept;
+    void setSsdWorkers(size_t workers);
+
+    bool physicalOrder() const noexcept;
+    void setPhysicalOrder(bool value);
+
+    bool hashCache() const noexcept;
+    void setHashCache(bool value);
+
+    size_t compareMaxFiles() const noexcept;
+    void setCompareMaxFiles(size_t files);
+
+    size_t readBufferBytes() const noexcept;
+    void setReadBufferBytes(size_t bytes);
+
+    ReadBackend readBackend() const noexcept;
+    void setReadBackend(ReadBackend backend);
+
+    uint64_t treeHashMinBytes() const noexcept;
+    void setTreeHashMinBytes(uint64_t bytes);
+
     std::chrono::milliseconds updateFrequency() const noexcept;
     void setUpdateFrequency(std::chrono::milliseconds freq);
 
+    std::chrono::seconds checkpointInterval() const noexcept;
+    void setCheckpointInterval(std::chrono::seconds interval);
+
+    bool resume() const noexcept;
+    void setResume(bool value);
+
+    bool streamGroups() const noexcept;
+    void setStreamGroups(bool value);
+
+    bool directoryGroups() const noexcept;
+    void setDirectoryGroups(bool value);
+
     bool skipDetection() const noexcept;
     void setSkipDetection(bool value);
 
@@ -71,13 +138,17 @@ public:
 
 private:
     std::vector<fs::path> scanDirs_;
+    std::vector<fs::path> backupDirs_;
+    std::vector<fs::path> manifests_;
     std::vector<fs::path> dirsToKeepFrom_;
     std::vector<fs::path> dirsToDeleteFrom_;
-    std::vector<std::regex> exclusionPatterns_;
+    std::vector<std::string> exclusionPatterns_;
     fs::path dataDir_;
     fs::path cacheDir_;
     fs::path allFilesPath_;
     fs::path dupFilesPath_;
+    fs::path statsFilePath_;
+    fs::path exportManifestPath_;
     fs::path ignFilesPath_;
     fs::path keepFilesPath_;
     fs::path delFilesPath_;
@@ -85,11 +156,36 @@ private:
     fs::path logFilename_;
     size_t minFileSizeBytes_ {};
     size_t maxFileSizeBytes_ {};
+    size_t hashWorkers_ {};
+    size_t hddWorkers_ {1};
+    size_t ssdWorkers_ {};
+    bool physicalOrder_ {true};
+    size_t compareMaxFiles_ {4};
+    size_t readBufferBytes_ {1024 * 1024};
+    ReadBackend readBackend_ {ReadBackend::Threads};
+    uint64_t treeHashMinBytes_ {1024ULL * 1024 * 1024};
     std::chrono::milliseconds updateFrequency_ {};
+    std::chrono::seconds checkpointInterval_ {60};
+    bool resume_ {false};
+    bool streamGroups_ {false};
+    bool directoryGroups_ {false};
     bool skipDetection_ {false};
     bool dryRun_ {true};
+    bool hashCache_ {true};
 };
 
+/**
+ * @brief Name of the read backend as used by the configuration
+ */
+std::string_view backend2str(ReadBackend backend) noexcept;
+
+/**
+ * @brief Parse the name of a read backend, `threads` or `io_uring`
+ *
+ * @throw std::invalid_argument for unknown names
+ */
+ReadBackend str2backend(std::string_view name);
+
 void logConfig(const Config& cfg);
 
 void applyDefaults(Config& cfg);
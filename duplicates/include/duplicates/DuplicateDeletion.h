@@ -102,4 +102,15 @@ Flow deleteInteractively(PathsVec& files, DeletionConfig& cfg);
  */
 void deleteDuplicates(const IDuplicateGroups& duplicates, DeletionConfig& cfg);
 
+/**
+ * @brief Same as above, for the groups handed over one by one while they are still
+ * detected
+ *
+ * @param cfg Settings for deletion process, must outlive the returned callback
+ *
+ * @return Callback deleting the duplicates of a single group, it returns false once
+ *         the user selected quit
+ */
+DupGroupCallback duplicatesDeleter(DeletionConfig& cfg);
+
 } // namespace tools::dups
\ No newline at end of file
@@ -3,12 +3,71 @@
 #include <duplicates/IDuplicates.h>
 #include <duplicates/Node.h>
 
+#include <memory>
+#include <set>
+#include <span>
 #include <unordered_map>
-#include <unordered_set>
-#include <map>
+#include <utility>
+#include <vector>
 
 namespace tools::dups {
 
+/**
+ * @brief File or directory of a detected group. It refers to the node of the entry,
+ * the path is built only when asked for.
+ */
+class DupEntryView
+{
+public:
+    /**
+     * @brief Entry of a file, or of a directory with the given digest of its content
+     */
+    DupEntryView(const Node* node,
+                 bool link,
+                 const core::crypto::Digest* digest = nullptr,
+                 bool backup = false,
+                 bool remote = false) noexcept;
+
+    const Node* node() const noexcept;
+    size_t size() const noexcept;
+    const core::crypto::Digest& sha256() const;
+
+    // The file shares its data with another entry of the group through a hard link
+    bool link() const noexcept;
+    bool directory() const noexcept;
+
+    // The entry belongs to the backup set of a cross-set detection
+    bool backup() const noexcept;
+
+    // The entry is a file of another host taken from a manifest, or a directory of
+    // such files, it can't be acted upon
+    bool remote() const noexcept;
+
+    fs::path file() const;
+
+    /**
+     * @brief Same as above, reuses the memory of the given path
+     */
+    void file(fs::path& path) const;
+
+private:
+    const Node* node_;
+    const core::crypto::Digest* digest_;
+    bool link_;
+    bool backup_;
+    bool remote_;
+};
+
+/**
+ * @brief Files or directories with equal content, as detected by the
+ * `DuplicateDetector`
+ */
+struct DupGroupView
+{
+    size_t groupId {};
+    std::span<const DupEntryView> entries {};
+};
+
 class DuplicateDetector
     : public IDuplicateDetector
     , public IDuplicateFiles
@@ -19,6 +78,20 @@ public:
     ~DuplicateDetector() = default;
 
     void addFile(const fs::path& path) override;
+    void addFile(const fs::path& path, const FileMeta& meta) override;
+
+    /**
+     * @brief Record that the scan left out an entry of the directory, a file out of
+     * the size range, an excluded or a special one. The directory and the ones
+     * holding it are never reported as copies of others.
+     */
+    void addIncompleteDir(const fs::path& dir);
+
+    /**
+     * @brief Directories with the entries left out by the scan, in the order of
+     * their paths
+     */
+    const std::set<fs::path>& incompleteDirs() const noexcept;
 
     size_t numFiles() const noexcept override;
     size_t numGroups() const noexcept override;
@@ -26,21 +99,67 @@ public:
     void detect(const Options& opts, const ProgressCallback& cb) override;
 
     void enumFiles(const FileCallback& cb) const override;
+
+    /**
+     * @brief Same as `groups`, every group is copied together with the paths of its
+     * files
+     */
     void enumGroups(const DupGroupCallback& cb) const override;
 
+    /**
+     * @brief Groups of the last detection, the groups of the largest files first.
+     * The views stay valid until the next detection or reset.
+     */
+    std::span<const DupGroupView> groups() const noexcept;
+
+    /**
+     * @brief Metrics of the last detection, the stages which didn't run are empty
+     */
+    const DetectionStats& stats() const noexcept;
+
+    /**
+     * @brief Calculate the digests of the added files the way the detection with the
+     * given options does. They are handed over in the order of `enumFiles`, the files
+     * which can't be read and the ones added with their digests are left out.
+     */
+    void digestFiles(const Options& opts,
+                     const FileDigestsCallback& cb,
+                     const ProgressCallback& progress = defaultProgressCallback) const;
+
     const Node* root() const;
     void reset();
 
 private:
     using Nodes = std::vector<const Node*>;
-    using MapBySize = std::map<size_t, Nodes, std::greater<>>;
-    using MapByHash = std::unordered_map<std::string_view, Nodes>;
-    using PathTable = std::unordered_set<fs::path>;
-
-    PathTable names_;
-    NodePtr root_;
-    MapBySize dups_;
-    MapByHash grps_;
+
+    std::unique_ptr<NodeTree> tree_;
+
+    // Number of files added without the size
+    size_t unsizedFiles_ {0};
+
+    // Files of all the groups, every group is a range of them in the order of its
+    // detection
+    std::vector<DupEntryView> entries_;
+    std::vector<std::pair<size_t, size_t>> ranges_;
+    std::vector<DupGroupView> groups_;
+    DetectionStats stats_;
+
+    // Digests of the groups of directories, the entries point to them
+    std::vector<core::crypto::Digest> dirDigests_;
+
+    // Roots of the backup set of a cross-set detection
+    Nodes backupRoots_;
+
+    // Files added with their digests, they are never read
+    std::unordered_map<const Node*, FileDigests> known_;
+
+    // Directories with the entries left out by the scan
+    std::set<fs::path> incompleteDirs_;
+
+    void detectGroups(const Options& opts, const ProgressCallback& cb);
+    DupGroupView addGroup(const Nodes& nodes);
+    void groupDirectories(bool crossSets);
+    void sortGroups();
 };
 
 constexpr std::string_view stage2str(Stage stage)
@@ -49,8 +168,18 @@ constexpr std::string_view stage2str(Stage stage)
     {
         case Stage::Prepare:
             return "Prepare";
+        case Stage::Head:
+            return "Head";
+        case Stage::Tail:
+            return "Tail";
+        case Stage::Sample:
+            return "Sample";
+        case Stage::Compare:
+            return "Compare";
         case Stage::Calculate:
             return "Calculate";
+        case Stage::Confirm:
+            return "Confirm";
     }
     return "Unknown";
 }
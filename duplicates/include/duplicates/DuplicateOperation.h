@@ -19,6 +19,31 @@ void scanDirectories(const Config& cfg,
                      DuplicateDetector& detector,
                      Progress& progress);
 
+/**
+ * @brief Write the manifest of the scanned files, if the configuration asks for it.
+ * Every file is read to calculate its digests, the unchanged ones are taken from the
+ * hash cache.
+ *
+ * @param cfg      The configuration containing the manifest path and the read settings
+ * @param detector The DuplicateDetector instance populated with the scanned files
+ * @param progress The Progress instance to get updates during the operation
+ *
+ * @throw std::system_error if the manifest can't be written
+ */
+void exportManifest(const Config& cfg,
+                    const DuplicateDetector& detector,
+                    Progress& progress);
+
+/**
+ * @brief Add the files of the configured manifests of other hosts to the detector
+ *
+ * @param cfg      The configuration containing the manifests
+ * @param detector The DuplicateDetector instance to populate with files
+ *
+ * @throw std::runtime_error if a manifest can't be loaded
+ */
+void importManifests(const Config& cfg, DuplicateDetector& detector);
+
 /**
  * @brief Dump the content of all files scanned by the DuplicateDetector
  *
@@ -46,5 +71,30 @@ void detectDuplicates(const Config& cfg,
  */
 void reportDuplicates(const fs::path& reportPath, const DuplicateDetector& detector);
 
+/**
+ * @brief Write the metrics of a detection as JSON
+ *
+ * @param statsPath The path to the file where to write the metrics
+ * @param stats     The metrics of the detection
+ *
+ * @throw std::system_error if the file can't be opened
+ */
+void writeStats(const fs::path& statsPath, const DetectionStats& stats);
+
+/**
+ * @brief Detect duplicates in the background and hand every group over as soon as it
+ * is confirmed, the groups are reported to the file on the way
+ *
+ * @param cfg        The configuration containing the detection settings
+ * @param detector   The DuplicateDetector instance populated with files
+ * @param reportPath The path to the file where to report duplicates
+ * @param cb         Receives the groups on the calling thread, the detection stops
+ *                   once it returns false
+ */
+void streamDuplicates(const Config& cfg,
+                      DuplicateDetector& detector,
+                      const fs::path& reportPath,
+                      const DupGroupCallback& cb);
+
 
 } // namespace tools::dups
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <duplicates/IDuplicates.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace tools::dups {
+
+/**
+ * @brief Bounded queue of the detected groups, hands them over from the detection
+ * to the consumer running on another thread
+ *
+ * The producer is blocked while the queue is full, so a slow consumer doesn't let
+ * the detected groups pile up. Either side closes the stream: the producer once the
+ * detection is over, the consumer when it doesn't want more groups. All member
+ * functions are thread safe.
+ */
+class GroupStream
+{
+public:
+    /**
+     * @brief Construct a new stream holding at most `capacity` groups, 0 is taken
+     * for 1
+     */
+    explicit GroupStream(size_t capacity);
+
+    /**
+     * @brief Add the group, waits while the stream is full
+     *
+     * @return false if the stream is closed, the group is dropped in that case
+     */
+    bool push(DupGroup group);
+
+    /**
+     * @brief Take the oldest group, waits while the stream is empty
+     *
+     * @return nothing once the stream is closed and all its groups are taken
+     */
+    std::optional<DupGroup> pop();
+
+    /**
+     * @brief No more groups are accepted, the waiting sides are woken up
+     */
+    void close();
+
+    bool closed() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable notFull_;
+    std::condition_variable notEmpty_;
+    std::deque<DupGroup> groups_;
+    size_t capacity_ {1};
+    bool closed_ {false};
+};
+
+} // namespace tools::dups
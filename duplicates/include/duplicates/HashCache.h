@@ -0,0 +1,129 @@
+#pragma once
+
+#include <core/utils/Crypto.h>
+#include <core/utils/File.h>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <shared_mutex>
+#include <span>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace tools::dups {
+
+/**
+ * @brief Persistent cache of file digests
+ *
+ * Entries are identified by the device and inode of a file and are valid only as
+ * long as the size and modification time of the file stay the same. The digests of
+ * the large files are tree digests, the header of both files records the size they
+ * start from, the files of another one are ignored. The cache consists of two
+ * files:
+ *
+ *   - a table of records sorted by (device, inode), memory mapped and searched
+ *     with a binary search, so it is never loaded into memory as a whole
+ *   - an append log with the records stored since the last compaction
+ *
+ * The log is merged into the table by `compact`, which happens automatically when
+ * the cache is destroyed and the log grew large enough. All member functions are
+ * thread safe.
+ */
+class HashCache
+{
+public:
+    struct Record
+    {
+        uint64_t device {};
+        uint64_t inode {};
+        uint64_t size {};
+        int64_t mtime {};
+        core::crypto::Digest digest {};
+    };
+
+    /**
+     * @brief Open the cache stored in the given directory, the directory is created
+     * if it doesn't exist
+     *
+     * @param dir The directory of the cache files
+     * @param treeMinBytes The digests of the files of at least that size are tree
+     *                     digests, 0 if there are none, see `Options`
+     *
+     * @throw std::system_error if the cache files can't be opened
+     */
+    HashCache(fs::path dir, uint64_t treeMinBytes);
+    ~HashCache();
+
+    HashCache(const HashCache&) = delete;
+    HashCache(HashCache&&) = delete;
+    HashCache& operator=(const HashCache&) = delete;
+    HashCache& operator=(HashCache&&) = delete;
+
+    /**
+     * @brief Find the SHA256 of the file described by `info`
+     *
+     * @param info The identity and metadata of the file
+     * @param sha256 Receives the digest
+     *
+     * @return true if an up to date entry is found, otherwise false
+     */
+    bool lookup(const core::file::FileInfo& info, core::crypto::Digest& sha256) const;
+
+    /**
+     * @brief Remember the SHA256 of the file described by `info`
+     *
+     * @param info The identity and metadata of the file, obtained before the digest
+     *             calculation started
+     * @param sha256 The digest
+     */
+    void store(const core::file::FileInfo& info, const core::crypto::Digest& sha256);
+
+    /**
+     * @brief Merge the log into the sorted table
+     */
+    void compact();
+
+    /**
+     * @brief Number of entries in the table and the log, an entry present in both is
+     * counted twice
+     */
+    size_t size() const;
+
+    uint64_t treeMinBytes() const noexcept;
+    const fs::path& tablePath() const noexcept;
+    const fs::path& logPath() const noexcept;
+
+private:
+    struct Key
+    {
+        uint64_t device {};
+        uint64_t inode {};
+
+        bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const noexcept;
+    };
+
+    fs::path tablePath_;
+    fs::path logPath_;
+    uint64_t treeMinBytes_;
+    boost::iostreams::mapped_file_source tableFile_;
+    std::span<const Record> table_;
+    std::unordered_map<Key, Record, KeyHash> log_;
+    std::ofstream logFile_;
+    mutable std::shared_mutex mutex_;
+
+    void openTable();
+    void openLog();
+    void resetLog();
+    const Record* find(const Key& key) const;
+};
+
+} // namespace tools::dups
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace tools::dups {
+
+/**
+ * @brief Split of the jobs into queues, e.g. by the devices their files are on
+ */
+struct JobQueues
+{
+    // Queue of every job
+    std::vector<uint32_t> queueOf {};
+
+    // Maximum number of jobs of every queue running at a time, 0 doesn't limit
+    std::vector<size_t> limits {};
+
+    // Jobs of a queue start in the increasing order of these keys, of the indices
+    // when empty
+    std::vector<uint64_t> order {};
+};
+
+/**
+ * @brief Runs hashing jobs on a fixed number of worker threads, started together
+ * with the engine and kept until it is destroyed
+ *
+ * Jobs are identified by their index. Workers pick indices in increasing order, so
+ * the order of the input is respected as much as the parallelism allows. Completion
+ * notifications are always delivered on the thread that called `run`, which allows
+ * callers to keep progress reporting and bookkeeping single threaded.
+ */
+class HashEngine
+{
+public:
+    using WorkCallback = std::function<void(size_t index)>;
+    using DoneCallback = std::function<void(size_t index)>;
+
+    /**
+     * @brief Construct a new engine
+     *
+     * @param workers Number of worker threads, 0 selects the number of hardware
+     *                threads
+     */
+    explicit HashEngine(size_t workers = 0);
+
+    HashEngine(const HashEngine&) = delete;
+    HashEngine& operator=(const HashEngine&) = delete;
+
+    /**
+     * @brief Stop the workers, no run may be in progress
+     */
+    ~HashEngine();
+
+    size_t workers() const noexcept;
+
+    /**
+     * @brief Workers lent to a running job, they are returned once the lease is
+     * destroyed
+     */
+    class Lease
+    {
+    public:
+        Lease(const HashEngine& engine, size_t count) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease();
+
+        size_t count() const noexcept;
+
+    private:
+        const HashEngine& engine_;
+        size_t count_;
+    };
+
+    /**
+     * @brief Lend up to `wanted` of the workers without a job to the calling job,
+     * which runs threads of its own in their place. The workers of the jobs still to
+     * be started aren't lent, so the lease is granted mostly at the end of a run.
+     */
+    Lease borrowIdle(size_t wanted) const noexcept;
+
+    /**
+     * @brief Execute `work` for every index in [0, count). The runs of the engine
+     * don't overlap, a run started while another one is in progress waits for it,
+     * so `work` must not start one.
+     *
+     * @param count Number of jobs
+     * @param work  Invoked on a worker thread for each index, must be thread safe
+     * @param done  Invoked on the calling thread once the job with the given index
+     *              is finished
+     *
+     * @throw Rethrows the first exception thrown by `work` or `done` after all
+     *        workers are stopped
+     */
+    void run(size_t count, const WorkCallback& work, const DoneCallback& done) const;
+
+    /**
+     * @brief Same as above, with at most `queues.limits[q]` jobs of the queue `q`
+     *        running at a time. Workers pick the jobs of the queues in turns, jobs
+     *        of a queue start in the order given by `queues.order`.
+     */
+    void run(size_t count,
+             const JobQueues& queues,
+             const WorkCallback& work,
+             const DoneCallback& done) const;
+
+private:
+    struct Pool;
+
+    size_t workers_ {1};
+    std::unique_ptr<Pool> pool_;
+
+    // Workers running a job, together with the ones lent to the jobs
+    mutable std::atomic<size_t> busy_ {0};
+
+    void runQueued(size_t count,
+                   const JobQueues* queues,
+                   const WorkCallback& work,
+                   const DoneCallback& done) const;
+};
+
+} // namespace tools::dups
@@ -1,10 +1,18 @@
 #pragma once
 
+#include <core/utils/Crypto.h>
+
+#include <array>
+#include <chrono>
 #include <functional>
 #include <filesystem>
+#include <map>
 #include <vector>
 #include <string>
 #include <limits>
+#include <optional>
+#include <utility>
+#include <cstdint>
 
 namespace fs = std::filesystem;
 
@@ -12,34 +20,235 @@ namespace tools::dups {
 
 // @todo:hayk - reconsider presence of this class as part of progress callback
 class Node;
+class HashCache;
+
+/**
+ * @brief Identity of a file, paths with equal identities are hard links to the same
+ * data. A zero inode stands for an unknown identity.
+ */
+struct FileId
+{
+    uint64_t device {};
+    uint64_t inode {};
+
+    bool operator==(const FileId&) const = default;
+};
+
+/**
+ * @brief Digests the detection rounds compare a file by. The ranges not present in
+ * a file of its size have empty digests.
+ */
+struct FileDigests
+{
+    // Fast digests of the head, the tail and the sampled blocks
+    core::crypto::Digest head {};
+    core::crypto::Digest tail {};
+    core::crypto::Digest sample {};
+
+    // SHA256 of the content, the tree digest for the large files
+    core::crypto::Digest sha256 {};
+};
+
+/**
+ * @brief What is known about a file at the time it is discovered, so that it
+ * doesn't need to be queried again
+ */
+struct FileMeta
+{
+    FileId id {};
+
+    // Size of the file in bytes, unknown if not set
+    std::optional<uint64_t> size {};
+
+    // Last modification time in nanoseconds since the epoch, 0 if unknown
+    int64_t mtime {};
+
+    // A file with known digests is never read, like the one of another host listed
+    // in a manifest. Its size must be known as well.
+    std::optional<FileDigests> digests {};
+};
 
 struct DupEntry
 {
     fs::path file;
     size_t size {};
-    std::string sha256;
+    core::crypto::Digest sha256 {};
+
+    // The file shares its data with another entry of the group through a hard link
+    bool link {false};
+
+    // The entry is a directory, equal to the other ones with all of its content
+    bool directory {false};
+
+    // The entry belongs to the backup set of a cross-set detection
+    bool backup {false};
+
+    // The entry is a file of another host taken from a manifest, or a directory of
+    // such files, it can't be acted upon
+    bool remote {false};
 };
 
 struct DupGroup
 {
     size_t groupId {};
-    std::vector<DupEntry> entires;
+    std::vector<DupEntry> entires {};
+};
+
+enum class Stage
+{
+    Prepare,
+    Head,
+    Tail,
+    Sample,
+    Compare,
+    Calculate,
+    Confirm
+};
+
+constexpr size_t NUM_STAGES = static_cast<size_t>(Stage::Confirm) + 1;
+
+/**
+ * @brief Cost of a stage of the detection, summed over all the times it ran
+ */
+struct StageStats
+{
+    // Time spent in the stage, the CPU time counts all the threads of the process
+    std::chrono::nanoseconds wall {};
+    std::chrono::nanoseconds cpu {};
+
+    // Files the stage inspected and the bytes it read from them
+    size_t files {};
+    uint64_t bytes {};
+
+    // Digests taken from the hash cache or the checkpoint instead of the files
+    size_t cacheHits {};
+
+    // Files opened and read calls issued
+    uint64_t opens {};
+    uint64_t reads {};
+};
+
+/**
+ * @brief Where the time of a detection went
+ */
+struct DetectionStats
+{
+    std::array<StageStats, NUM_STAGES> stages {};
+
+    // Number of the groups of duplicates by the number of their files
+    std::map<size_t, size_t> groupSizes {};
+
+    StageStats& operator[](Stage stage) noexcept
+    {
+        return stages[static_cast<size_t>(stage)];
+    }
+
+    const StageStats& operator[](Stage stage) const noexcept
+    {
+        return stages[static_cast<size_t>(stage)];
+    }
+};
+
+/**
+ * @brief Progress of a detection, enough to resume it. Files are identified by their
+ * position in the enumeration of the files, which is the same for the same sequence
+ * of added paths.
+ */
+struct DetectionState
+{
+    // The last finished round, Prepare when none is finished
+    Stage stage {Stage::Prepare};
+
+    // Candidate groups left by that round
+    std::vector<std::vector<uint32_t>> groups {};
+
+    // Groups already found equal by the lock-step comparison and the SHA256 of the
+    // content of every group
+    std::vector<std::vector<uint32_t>> compared {};
+    std::vector<core::crypto::Digest> comparedDigests {};
+
+    // Digests calculated so far by the round following `stage`
+    std::vector<std::pair<uint32_t, core::crypto::Digest>> digests {};
+};
+
+using CheckpointCallback = std::function<void(const DetectionState&)>;
+using DupGroupCallback = std::function<bool(const DupGroup&)>;
+
+enum class ReadBackend
+{
+    // Every hash worker reads its files with blocking reads
+    Threads,
+
+    // Reads of many files are in flight at once, Linux only
+    IoUring
 };
 
 struct Options
 {
     size_t minSizeBytes {};
     size_t maxSizeBytes {std::numeric_limits<size_t>::max()};
-};
 
-enum class Stage
-{
-    Prepare,
-    Calculate
+    // Number of threads calculating digests, 0 selects the number of hardware threads
+    size_t hashWorkers {0};
+
+    // Files of a device are read by at most that many workers at a time, 0 doesn't
+    // limit. Concurrent seeks thrash rotational disks, while solid state drives and
+    // devices of unknown kind take advantage of many reads in flight.
+    size_t hddWorkers {1};
+    size_t ssdWorkers {0};
+
+    // Files of a rotational disk are read in the order of their physical location
+    // instead of the order of the groups, to minimise the seeks
+    bool physicalOrder {true};
+
+    // Groups with up to that many files are compared in lock-step instead of hashed,
+    // 0 disables the comparison
+    size_t compareMaxFiles {4};
+
+    // Size of the chunks the files are read in, 0 selects the default of the reader
+    size_t readBufferBytes {0};
+
+    // Backend reading the files of the fast rounds. The io_uring falls back to the
+    // threads when it is not available.
+    ReadBackend readBackend {ReadBackend::Threads};
+
+    // Full digests of the files of at least that size are tree digests, their chunks
+    // are digested in parallel by the idle hash workers. Such files are hashed
+    // instead of compared. The digests are comparable only if calculated with the
+    // same value, also in the runs sharing a hash cache. 0 disables.
+    uint64_t treeHashMinBytes {1024ULL * 1024 * 1024};
+
+    // Digests of unchanged files are taken from the cache, new ones are stored in it.
+    // The cache must be opened with the same tree digest size.
+    HashCache* hashCache {nullptr};
+
+    // Receives the state of the detection after every round and, within the rounds,
+    // at least that many seconds apart
+    CheckpointCallback checkpoint {};
+    std::chrono::seconds checkpointInterval {60};
+
+    // Continue from the given state instead of starting over, the same files must be
+    // added in the same order as the time it was reported
+    const DetectionState* resume {nullptr};
+
+    // Receives every group of equal files as soon as the detection of its size
+    // bucket is finished, the buckets are detected in batches for that. The detection
+    // stops if it returns false. No checkpoints are taken in that mode.
+    DupGroupCallback onGroup {};
+
+    // Directories with equal names, sizes and content of all their files are grouped
+    // as a whole, the files inside them are no longer reported on their own. Does
+    // not apply when the groups are streamed through `onGroup`.
+    bool directoryGroups {false};
+
+    // The files under these directories form the backup set, all the other ones the
+    // source set. When given, only the groups with files of both sets are detected,
+    // the candidates of every round without them are dropped before they are read.
+    std::vector<fs::path> backupDirs {};
 };
 
 using FileCallback = std::function<void(const fs::path&)>;
-using DupGroupCallback = std::function<bool(const DupGroup&)>;
+using FileDigestsCallback = std::function<void(const Node*, const FileDigests&)>;
 using ProgressCallback = std::function<void(const Stage, const Node*, size_t)>;
 
 extern const ProgressCallback& defaultProgressCallback;
@@ -72,6 +281,13 @@ public:
 
     virtual void addFile(const fs::path& path) = 0;
 
+    /**
+     * @brief Same as above, additionally records what is known about the file. The
+     * identity allows reading hard links to the same data only once, the detection
+     * doesn't query the sizes again when all of them are known.
+     */
+    virtual void addFile(const fs::path& path, const FileMeta& meta) = 0;
+
     virtual size_t numFiles() const noexcept = 0;
 
     virtual void enumFiles(const FileCallback& cb) const = 0;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <duplicates/DuplicateDetector.h>
+
+#include <cstddef>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace tools::dups {
+
+/**
+ * @brief Portable list of the scanned files with their sizes and digests. The
+ * manifest written on one host lets another one detect the copies of its files
+ * without reading them.
+ *
+ * The file starts with a header, followed by a record per file. The paths are
+ * listed in the order of their enumeration, every path omits the prefix it shares
+ * with the previous one. The paths are stored in UTF-8 with forward slashes and the
+ * numbers in little endian, whatever the system that wrote them.
+ */
+class Manifest
+{
+public:
+    explicit Manifest(fs::path path);
+
+    /**
+     * @brief Store the files of the detector, digested the way the detection with
+     * the given options digests them. The files which can't be read are left out.
+     *
+     * @throw std::system_error if the file can't be written
+     */
+    void save(const DuplicateDetector& detector,
+              const Options& opts,
+              const ProgressCallback& cb = defaultProgressCallback) const;
+
+    /**
+     * @brief Add the stored files to the detector with their digests, they are never
+     * read. Every file is added under the path of the manifest, followed by the path
+     * it has on its host without the root.
+     *
+     * @return Number of the added files
+     *
+     * @throw std::system_error if the file can't be opened
+     * @throw std::runtime_error if the manifest is damaged or its large files are
+     *        digested differently than the detection with the given options does,
+     *        nothing is added in that case
+     */
+    size_t load(DuplicateDetector& detector, const Options& opts) const;
+
+    const fs::path& path() const noexcept;
+
+private:
+    fs::path path_;
+};
+
+} // namespace tools::dups
@@ -1,33 +1,72 @@
 #pragma once
 
+#include <duplicates/IDuplicates.h>
+#include <core/utils/Crypto.h>
+
 #include <functional>
 #include <string>
+#include <string_view>
 #include <cstdint>
-#include <unordered_map>
+#include <deque>
+#include <vector>
 #include <memory>
 #include <filesystem>
+#include <mutex>
 
 namespace tools::dups {
 
 namespace fs = std::filesystem;
 
-using NodePtr = std::unique_ptr<class Node>;
+class NodeTree;
 
+/**
+ * @brief Handle of a node of the `NodeTree`. The data of the node lives in the
+ * tree, the handle only provides a convenient access to it. Handles are created by
+ * the tree and stay valid as long as the tree exists.
+ */
 class Node
 {
 public:
     using UpdateCallback = std::function<void(const Node*)>;
     using ConstNodeCallback = std::function<void(const Node*)>;
     using MutableNodeCallback = std::function<void(Node*)>;
-    using Children = std::unordered_map<const fs::path*, NodePtr>;
-
-    explicit Node(const fs::path* name, Node* parent = nullptr);
+    using Digest = core::crypto::Digest;
+    using DigestFunction = std::function<Digest(const fs::path&)>;
 
-    const fs::path& name() const noexcept;
+    fs::path name() const;
     bool leaf() const noexcept;
     size_t size() const noexcept;
     uint16_t depth() const noexcept;
-    const std::string& sha256() const;
+
+    /**
+     * @brief Set the size of a file, the sizes of the ancestors are adjusted by the
+     * difference
+     */
+    void setSize(size_t size) noexcept;
+
+    const FileId& id() const noexcept;
+    void setId(const FileId& id) noexcept;
+
+    /**
+     * @brief Last modification time of the file in nanoseconds since the epoch, as
+     * found by the scan, 0 if unknown
+     */
+    int64_t mtime() const noexcept;
+    void setMtime(int64_t mtime) noexcept;
+
+    /**
+     * @brief Lazily calculates the SHA256 of the file this node represents. Safe to
+     * be called concurrently, the digest is calculated only once.
+     *
+     * @throw Propagates errors of the digest calculation, a subsequent call retries
+     */
+    const Digest& sha256() const;
+
+    /**
+     * @brief Same as above, but the digest is obtained from the given function when
+     * it is not known yet
+     */
+    const Digest& sha256(const DigestFunction& digest) const;
 
     fs::path fullPath() const;
     void fullPath(fs::path& path) const;
@@ -40,6 +79,11 @@ public:
     void enumLeafs(const MutableNodeCallback& cb);
     void enumNodes(const ConstNodeCallback& cb) const;
 
+    /**
+     * @brief Enumerate the direct children in the order they were added
+     */
+    void enumChildren(const ConstNodeCallback& cb) const;
+
     size_t nodesCount() const noexcept;
     size_t leafsCount() const noexcept;
 
@@ -51,14 +95,80 @@ public:
     void update(const UpdateCallback& cb = [](const Node*) {});
 
 private:
-    Children children_;
-    mutable std::string sha256_;
-    const fs::path* name_ {nullptr};
-    Node* parent_ {nullptr};
-    size_t size_ {0};
-    uint16_t depth_ {0};
-
-    void updateHelper(const UpdateCallback& cb, Node* node, fs::path& p);
+    friend class NodeTree;
+
+    NodeTree* tree_ {nullptr};
+    uint32_t index_ {0};
+
+    Node(NodeTree* tree, uint32_t index) noexcept;
+
+    void appendPath(fs::path& path) const;
+    void updateHelper(const UpdateCallback& cb, fs::path& p);
+};
+
+/**
+ * @brief Tree of the file system paths with a compact memory layout
+ *
+ * Nodes are identified by 32-bit indices and linked to their parent, first child
+ * and next sibling. The node attributes are kept in parallel arrays, the names are
+ * interned once into a string arena, so a name shared by many directories is
+ * stored only once. Children are found through an open addressing hash table of
+ * indices keyed by (parent, name).
+ */
+class NodeTree
+{
+public:
+    using NameView = std::basic_string_view<fs::path::value_type>;
+
+    explicit NodeTree(const fs::path& rootName = {});
+
+    NodeTree(const NodeTree&) = delete;
+    NodeTree(NodeTree&&) = delete;
+    NodeTree& operator=(const NodeTree&) = delete;
+    NodeTree& operator=(NodeTree&&) = delete;
+
+    Node& root() noexcept;
+    const Node& root() const noexcept;
+
+    /**
+     * @brief Total number of nodes, including the root
+     */
+    size_t size() const noexcept;
+
+private:
+    friend class Node;
+
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // Node attributes, indexed by the node index
+    std::vector<uint32_t> parent_;
+    std::vector<uint32_t> firstChild_;
+    std::vector<uint32_t> lastChild_;
+    std::vector<uint32_t> nextSibling_;
+    std::vector<uint32_t> nameId_;
+    std::vector<uint16_t> depth_;
+    std::vector<uint64_t> size_;
+    std::vector<FileId> id_;
+    std::vector<int64_t> mtime_;
+    std::vector<Node::Digest> digest_;
+    std::deque<std::once_flag> digestOnce_;
+    std::deque<Node> nodes_;
+
+    // Index + 1 of the nodes, 0 marks an empty slot
+    std::vector<uint32_t> childSlots_;
+
+    // Interned names and the arena they point to
+    std::vector<NameView> names_;
+    std::vector<uint32_t> nameSlots_;
+    std::vector<std::unique_ptr<fs::path::value_type[]>> chunks_;
+    size_t chunkFree_ {0};
+
+    uint32_t findName(NameView name) const noexcept;
+    uint32_t internName(NameView name);
+    uint32_t findChild(uint32_t parent, uint32_t nameId) const noexcept;
+    uint32_t addChild(uint32_t parent, NameView name);
+    void insertChildSlot(uint32_t index) noexcept;
+    void insertNameSlot(uint32_t nameId) noexcept;
 };
 
 } // namespace tools::dups
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace tools::dups {
+
+/**
+ * @brief Stable LSD radix sort of the items in the ascending order of their 64-bit
+ * keys, a byte at a time
+ *
+ * The passes over the bytes which are the same in all the keys are skipped, small
+ * keys cost only a few passes. The key is taken once per item and pass, it should
+ * be cheap. `buffer` is the scratch space, its memory is reused between the calls.
+ */
+template <typename T, typename KeyFn>
+void radixSort(std::vector<T>& items, std::vector<T>& buffer, KeyFn key)
+{
+    constexpr size_t RADIX = 256;
+    constexpr size_t PASSES = sizeof(uint64_t);
+
+    if (items.size() < 2)
+    {
+        return;
+    }
+
+    // Histograms of all the passes are collected at once
+    std::array<std::array<size_t, RADIX>, PASSES> counts {};
+
+    for (const auto& item : items)
+    {
+        const uint64_t k = key(item);
+
+        for (size_t p = 0; p < PASSES; ++p)
+        {
+            ++counts[p][(k >> (p * 8)) & 0xFF];
+        }
+    }
+
+    buffer.resize(items.size());
+
+    for (size_t p = 0; p < PASSES; ++p)
+    {
+        auto& offsets = counts[p];
+
+        // A byte shared by all the keys doesn't change the order
+        if (std::ranges::find(offsets, items.size()) != offsets.end())
+        {
+            continue;
+        }
+
+        // Counts become the positions the items of every digit start at
+        size_t offset = 0;
+        for (auto& count : offsets)
+        {
+            const auto n = count;
+            count = offset;
+            offset += n;
+        }
+
+        for (auto& item : items)
+        {
+            const auto digit = (key(item) >> (p * 8)) & 0xFF;
+            buffer[offsets[digit]++] = std::move(item);
+        }
+
+        items.swap(buffer);
+    }
+}
+
+} // namespace tools::dups
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <core/utils/Crypto.h>
+#include <core/utils/FmtExt.h>
+
+#include <bit>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace tools::dups {
+
+/**
+ * @brief Values in the layout of the host, fit for the files read back by the same
+ * host only. Any trivially copyable value can be stored.
+ */
+struct NativeOrder
+{
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    static T convert(T value) noexcept
+    {
+        return value;
+    }
+};
+
+/**
+ * @brief Numbers in little endian, whatever the host. Only the integers and the
+ * digests can be stored.
+ */
+struct LittleEndian
+{
+    template <typename T>
+        requires std::is_integral_v<T> || std::is_same_v<T, core::crypto::Digest>
+    static T convert(T value) noexcept
+    {
+        if constexpr (std::is_integral_v<T> && std::endian::native == std::endian::big)
+        {
+            return std::byteswap(value);
+        }
+
+        return value;
+    }
+};
+
+/**
+ * @brief Writes to a temporary file, which replaces the target once committed. The
+ * values are laid out by the `Order`.
+ */
+template <typename Order>
+class BinaryWriter
+{
+public:
+    explicit BinaryWriter(fs::path path)
+        : path_ {std::move(path)}
+        , tmpPath_ {fs::path(path_) += ".tmp"}
+        , out_ {tmpPath_, std::ios::binary | std::ios::trunc}
+    {
+        if (!out_)
+        {
+            throw std::system_error(std::make_error_code(std::errc::io_error),
+                                    std::format("Unable to open: '{}'", tmpPath_));
+        }
+    }
+
+    template <typename T>
+    void put(const T& value)
+    {
+        const T stored = Order::convert(value);
+        put(&stored, sizeof(T));
+    }
+
+    void put(const void* data, size_t size)
+    {
+        out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+
+    /**
+     * @brief Replace the target with the written file
+     *
+     * @throw std::system_error if the file can't be written
+     */
+    void commit()
+    {
+        if (!out_.flush())
+        {
+            throw std::system_error(std::make_error_code(std::errc::io_error),
+                                    std::format("Unable to write: '{}'", tmpPath_));
+        }
+
+        out_.close();
+        fs::rename(tmpPath_, path_);
+    }
+
+private:
+    fs::path path_;
+    fs::path tmpPath_;
+    std::ofstream out_;
+};
+
+/**
+ * @brief Reads the values written by the `BinaryWriter` of the same `Order`, every
+ * read reports whether it succeeded
+ */
+template <typename Order>
+class BinaryReader
+{
+public:
+    explicit BinaryReader(const fs::path& path)
+        : in_ {path, std::ios::binary}
+    {
+    }
+
+    bool isOpen() const
+    {
+        return in_.is_open();
+    }
+
+    template <typename T>
+    bool get(T& value)
+    {
+        if (!get(&value, sizeof(T)))
+        {
+            return false;
+        }
+
+        value = Order::convert(value);
+        return true;
+    }
+
+    bool get(void* data, size_t size)
+    {
+        return static_cast<bool>(
+            in_.read(static_cast<char*>(data), static_cast<std::streamsize>(size)));
+    }
+
+    bool eof()
+    {
+        return in_.peek() == std::char_traits<char>::eof();
+    }
+
+private:
+    std::ifstream in_;
+};
+
+} // namespace tools::dups
@@ -0,0 +1,477 @@
+#include <duplicates/Checkpoint.h>
+#include <duplicates/Node.h>
+#include "BinaryFile.h"
+#include <core/utils/File.h>
+#include <core/utils/FmtExt.h>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace tools::dups {
+namespace {
+
+constexpr std::array<char, 8> FILES_MAGIC {'D', 'U', 'P', 'F', 'I', 'L', 'E', 'S'};
+constexpr std::array<char, 8> STATE_MAGIC {'D', 'U', 'P', 'S', 'T', 'A', 'T', 'E'};
+constexpr uint32_t VERSION = 4;
+
+// Longer paths are taken for a sign of a damaged file
+constexpr uint32_t MAX_PATH_LENGTH = 32 * 1024;
+
+struct Header
+{
+    std::array<char, 8> magic {};
+    uint32_t version {VERSION};
+    uint32_t reserved {};
+    Checkpoint::Fingerprint fingerprint {};
+
+    // Number of the scanned files
+    uint64_t numFiles {};
+};
+
+static_assert(sizeof(Header) == 56);
+
+using NativeString = fs::path::string_type;
+using Ids = std::vector<std::vector<uint32_t>>;
+
+/**
+ * @brief Scanned file as stored in the checkpoint, along with its path
+ */
+struct FileRecord
+{
+    FileId id {};
+    uint64_t size {};
+
+    // Last modification time, in nanoseconds since the epoch
+    int64_t mtime {};
+};
+
+/**
+ * @brief Writer of the checkpoint files, in the layout of the host
+ */
+class Writer : public BinaryWriter<NativeOrder>
+{
+public:
+    using BinaryWriter::BinaryWriter;
+    using BinaryWriter::put;
+
+    void put(const Ids& groups)
+    {
+        put(static_cast<uint64_t>(groups.size()));
+
+        for (const auto& ids : groups)
+        {
+            put(static_cast<uint32_t>(ids.size()));
+            put(ids.data(), ids.size() * sizeof(uint32_t));
+        }
+    }
+};
+
+/**
+ * @brief Reads the values written by the `Writer`, every read reports whether it
+ * succeeded
+ */
+class Reader : public BinaryReader<NativeOrder>
+{
+public:
+    using BinaryReader::BinaryReader;
+    using BinaryReader::get;
+
+    bool get(Ids& groups, size_t numFiles)
+    {
+        uint64_t count = 0;
+        if (!get(count))
+        {
+            return false;
+        }
+
+        // The counts are not trusted to reserve the memory upfront
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            uint32_t size = 0;
+            if (!get(size) || size > numFiles)
+            {
+                return false;
+            }
+
+            auto& ids = groups.emplace_back(size);
+            if (!get(ids.data(), ids.size() * sizeof(uint32_t)) ||
+                std::ranges::any_of(ids, [numFiles](uint32_t id) {
+                    return id >= numFiles;
+                }))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Read the record of the next file, `path` holds the previous one and is
+     * replaced by its path
+     */
+    bool get(NativeString& path, FileRecord& record)
+    {
+        uint32_t shared = 0;
+        uint32_t suffix = 0;
+
+        if (!get(shared) || !get(suffix) || shared > path.size() ||
+            suffix > MAX_PATH_LENGTH)
+        {
+            return false;
+        }
+
+        path.resize(shared + suffix);
+
+        return get(path.data() + shared, suffix * sizeof(NativeString::value_type)) &&
+               get(record.id) && get(record.size) && get(record.mtime);
+    }
+
+    /**
+     * @brief Check that the file starts with a header of the given kind
+     */
+    bool header(const std::array<char, 8>& magic,
+                const Checkpoint::Fingerprint& fingerprint,
+                uint64_t& numFiles)
+    {
+        Header header;
+
+        if (!get(header) || header.magic != magic || header.version != VERSION ||
+            header.fingerprint != fingerprint)
+        {
+            return false;
+        }
+
+        numFiles = header.numFiles;
+        return true;
+    }
+};
+
+/**
+ * @brief Remove the dropped files from the state along with their digests, the
+ * groups left with a single file are removed as well
+ */
+void dropFiles(const std::vector<bool>& dropped, DetectionState& state)
+{
+    const auto isDropped = [&dropped](uint32_t id) {
+        return dropped[id];
+    };
+
+    for (auto& ids : state.groups)
+    {
+        std::erase_if(ids, isDropped);
+    }
+
+    std::erase_if(state.groups, [](const auto& ids) {
+        return ids.size() < 2;
+    });
+
+    // Every compared group keeps its digest
+    size_t kept = 0;
+
+    for (size_t i = 0; i < state.compared.size(); ++i)
+    {
+        std::erase_if(state.compared[i], isDropped);
+
+        if (state.compared[i].size() < 2)
+        {
+            continue;
+        }
+
+        if (kept != i)
+        {
+            state.compared[kept] = std::move(state.compared[i]);
+            state.comparedDigests[kept] = state.comparedDigests[i];
+        }
+        ++kept;
+    }
+
+    state.compared.resize(kept);
+    state.comparedDigests.resize(kept);
+
+    std::erase_if(state.digests, [&isDropped](const auto& digest) {
+        return isDropped(digest.first);
+    });
+}
+
+} // namespace
+
+Checkpoint::Checkpoint(fs::path dir, const Fingerprint& fingerprint)
+    : filesPath_ {dir / "files.bin"}
+    , statePath_ {dir / "state.bin"}
+    , fingerprint_ {fingerprint}
+{
+    fs::create_directories(dir);
+}
+
+void Checkpoint::saveFiles(const DuplicateDetector& detector)
+{
+    // The state refers to the files by their index, it must not outlive them. The
+    // previous files are gone as well if the new ones can't be written.
+    std::error_code ec;
+    fs::remove(statePath_, ec);
+    fs::remove(filesPath_, ec);
+
+    Writer out(filesPath_);
+    const auto numFiles = detector.numFiles();
+    out.put(Header {
+        .magic = FILES_MAGIC,
+        .fingerprint = fingerprint_,
+        .numFiles = numFiles,
+    });
+
+    NativeString prev;
+    fs::path path;
+
+    if (numFiles > 0)
+    {
+        detector.root()->enumLeafs([&out, &prev, &path](const Node* node) {
+            node->fullPath(path);
+            const auto& curr = path.native();
+            const auto shared = static_cast<size_t>(
+                std::ranges::mismatch(prev, curr).in2 - curr.begin());
+            const auto suffix = curr.size() - shared;
+
+            out.put(static_cast<uint32_t>(shared));
+            out.put(static_cast<uint32_t>(suffix));
+            out.put(curr.data() + shared, suffix * sizeof(NativeString::value_type));
+            out.put(node->id());
+            out.put(static_cast<uint64_t>(node->size()));
+            out.put(node->mtime());
+            prev = curr;
+        });
+    }
+
+    // The directories the scan left something of out are never copies of others
+    const auto& incomplete = detector.incompleteDirs();
+    out.put(static_cast<uint64_t>(incomplete.size()));
+
+    for (const auto& dir : incomplete)
+    {
+        const auto& native = dir.native();
+        out.put(static_cast<uint32_t>(native.size()));
+        out.put(native.data(), native.size() * sizeof(NativeString::value_type));
+    }
+
+    out.commit();
+    spdlog::debug("Checkpoint of {} files saved: '{}'", numFiles, filesPath_);
+}
+
+bool Checkpoint::loadFiles(DuplicateDetector& detector) const
+{
+    Reader in(filesPath_);
+    uint64_t numFiles = 0;
+
+    if (!in.header(FILES_MAGIC, fingerprint_, numFiles))
+    {
+        return false;
+    }
+
+    std::vector<std::pair<fs::path, FileMeta>> files;
+    NativeString curr;
+
+    for (uint64_t i = 0; i < numFiles; ++i)
+    {
+        FileRecord record;
+
+        if (!in.get(curr, record))
+        {
+            spdlog::warn("Ignoring damaged checkpoint: '{}'", filesPath_);
+            return false;
+        }
+
+        // Files the scan couldn't query have no identity, their sizes are queried
+        // by the detection as before
+        auto& [path, meta] = files.emplace_back(
+            curr, FileMeta {.id = record.id, .mtime = record.mtime});
+        if (record.id.inode != 0)
+        {
+            meta.size = record.size;
+        }
+    }
+
+    std::vector<fs::path> incomplete;
+    uint64_t numDirs = 0;
+    bool valid = in.get(numDirs);
+
+    for (uint64_t i = 0; valid && i < numDirs; ++i)
+    {
+        uint32_t length = 0;
+        valid = in.get(length) && length <= MAX_PATH_LENGTH;
+
+        if (valid)
+        {
+            curr.resize(length);
+            valid = in.get(curr.data(), length * sizeof(NativeString::value_type));
+            incomplete.emplace_back(curr);
+        }
+    }
+
+    if (!valid || !in.eof())
+    {
+        spdlog::warn("Ignoring damaged checkpoint: '{}'", filesPath_);
+        return false;
+    }
+
+    for (const auto& [path, meta] : files)
+    {
+        detector.addFile(path, meta);
+    }
+
+    for (const auto& dir : incomplete)
+    {
+        detector.addIncompleteDir(dir);
+    }
+
+    spdlog::debug("Checkpoint of {} files loaded: '{}'", numFiles, filesPath_);
+    return true;
+}
+
+void Checkpoint::saveState(size_t numFiles, const DetectionState& state)
+{
+    Writer out(statePath_);
+    out.put(Header {
+        .magic = STATE_MAGIC,
+        .fingerprint = fingerprint_,
+        .numFiles = numFiles,
+    });
+
+    out.put(static_cast<uint32_t>(state.stage));
+    out.put(state.groups);
+    out.put(state.compared);
+    out.put(state.comparedDigests.data(),
+            state.comparedDigests.size() * sizeof(core::crypto::Digest));
+    out.put(static_cast<uint64_t>(state.digests.size()));
+
+    for (const auto& [id, digest] : state.digests)
+    {
+        out.put(id);
+        out.put(digest);
+    }
+
+    out.commit();
+}
+
+bool Checkpoint::loadState(size_t numFiles, DetectionState& state) const
+{
+    Reader in(statePath_);
+    uint64_t stateFiles = 0;
+
+    if (!in.header(STATE_MAGIC, fingerprint_, stateFiles) || stateFiles != numFiles)
+    {
+        return false;
+    }
+
+    DetectionState loaded;
+    uint32_t stage = 0;
+    uint64_t numDigests = 0;
+    bool valid = in.get(stage) && stage <= static_cast<uint32_t>(Stage::Confirm) &&
+                 in.get(loaded.groups, numFiles) && in.get(loaded.compared, numFiles);
+
+    // Every compared group has a digest
+    loaded.comparedDigests.resize(loaded.compared.size());
+    valid = valid &&
+            in.get(loaded.comparedDigests.data(),
+                   loaded.comparedDigests.size() * sizeof(core::crypto::Digest)) &&
+            in.get(numDigests);
+
+    for (uint64_t i = 0; valid && i < numDigests; ++i)
+    {
+        auto& [id, digest] = loaded.digests.emplace_back();
+        valid = in.get(id) && id < numFiles && in.get(digest);
+    }
+
+    if (!valid || !in.eof())
+    {
+        spdlog::warn("Ignoring damaged checkpoint: '{}'", statePath_);
+        return false;
+    }
+
+    loaded.stage = static_cast<Stage>(stage);
+    state = std::move(loaded);
+    return true;
+}
+
+bool Checkpoint::loadState(const DuplicateDetector& detector,
+                           DetectionState& state) const
+{
+    const auto numFiles = detector.numFiles();
+    DetectionState loaded;
+
+    if (!loadState(numFiles, loaded))
+    {
+        return false;
+    }
+
+    Reader in(filesPath_);
+    uint64_t numRecords = 0;
+
+    if (!in.header(FILES_MAGIC, fingerprint_, numRecords) || numRecords > numFiles)
+    {
+        return false;
+    }
+
+    // The files imported from the manifests are not stored, the scanned ones keep
+    // their order among them
+    std::vector<bool> changed(numFiles);
+    NativeString stored;
+    FileRecord record;
+    uint64_t matched = 0;
+    bool valid = numRecords == 0 || in.get(stored, record);
+    size_t id = 0;
+    fs::path path;
+
+    detector.root()->enumLeafs([&](const Node* node) {
+        node->fullPath(path);
+
+        if (valid && matched < numRecords && path.native() == stored)
+        {
+            // Files the scan couldn't query are taken for changed
+            core::file::FileInfo info;
+            std::error_code ec;
+            changed[id] = record.id.inode == 0 ||
+                          !core::file::fileInfo(path, info, ec) ||
+                          FileId {info.device, info.inode} != record.id ||
+                          info.size != record.size || info.mtime != record.mtime;
+
+            valid = ++matched == numRecords || in.get(stored, record);
+        }
+
+        ++id;
+    });
+
+    if (!valid || matched != numRecords)
+    {
+        spdlog::warn("Ignoring damaged checkpoint: '{}'", filesPath_);
+        return false;
+    }
+
+    if (const auto numChanged = std::ranges::count(changed, true); numChanged > 0)
+    {
+        dropFiles(changed, loaded);
+        spdlog::info("Files changed since the checkpoint, left out of the resumed "
+                     "detection: {}",
+                     numChanged);
+    }
+
+    state = std::move(loaded);
+    return true;
+}
+
+const fs::path& Checkpoint::filesPath() const noexcept
+{
+    return filesPath_;
+}
+
+const fs::path& Checkpoint::statePath() const noexcept
+{
+    return statePath_;
+}
+
+} // namespace tools::dups
@@ -56,6 +56,17 @@ void defineOptions(cxxopts::Options& opts)
         ("exclude", "Exclude regex pattern (repeatable)",
             cxxopts::value<std::vector<std::string>>())
 
+        ("backup-dir", "Directory of the backup set, only the files of the scanned "
+            "directories with copies in it are reported (repeatable)",
+            cxxopts::value<std::vector<std::string>>())
+
+        ("manifest", "Manifest of the files of another host, detected together with "
+            "the scanned ones without reading them (repeatable)",
+            cxxopts::value<std::vector<std::string>>())
+
+        ("export-manifest", "File to write the manifest of the scanned files to",
+            cxxopts::value<std::string>())
+
         ("keep-path", "Path to keep from (repeatable)",
             cxxopts::value<std::vector<std::string>>())
 
@@ -68,15 +79,57 @@ void defineOptions(cxxopts::Options& opts)
         ("max-size", "Ignore files larger than this (bytes)",
             cxxopts::value<uint64_t>()->default_value("10737418240"))
 
+        ("hash-workers", "Number of hashing threads (0 uses all hardware threads)",
+            cxxopts::value<uint64_t>()->default_value("0"))
+
+        ("hdd-workers", "Concurrent reads per rotational disk (0 for no limit)",
+            cxxopts::value<uint64_t>()->default_value("1"))
+
+        ("ssd-workers", "Concurrent reads per other device (0 for no limit)",
+            cxxopts::value<uint64_t>()->default_value("0"))
+
+        ("physical-order", "Read files of rotational disks in their on-disk order",
+            cxxopts::value<bool>()->default_value("true"))
+
+        ("hash-cache", "Reuse digests of unchanged files from previous runs",
+            cxxopts::value<bool>()->default_value("true"))
+
+        ("compare-max-files", "Compare groups up to this many files instead of hashing",
+            cxxopts::value<uint64_t>()->default_value("4"))
+
+        ("read-buffer", "Size of the chunks files are read in (bytes)",
+            cxxopts::value<uint64_t>()->default_value("1048576"))
+
+        ("read-backend", "Reading files with 'threads' or 'io_uring' (Linux only)",
+            cxxopts::value<std::string>()->default_value("threads"))
+
+        ("tree-hash-min", "Files of that size get a tree digest (bytes, 0 disables)",
+            cxxopts::value<uint64_t>()->default_value("1073741824"))
+
         ("update-freq", "Progress update frequency (ms, 0 disables)",
             cxxopts::value<uint64_t>()->default_value("100"))
 
+        ("checkpoint-interval", "Seconds between detection checkpoints (0 disables)",
+            cxxopts::value<uint64_t>()->default_value("60"))
+
+        ("resume", "Continue the interrupted detection from its checkpoint",
+            cxxopts::value<bool>()->default_value("false"))
+
+        ("stream", "Review the groups while the detection of the others goes on",
+            cxxopts::value<bool>()->default_value("false"))
+
+        ("dir-groups", "Report the equal directories as a whole",
+            cxxopts::value<bool>()->default_value("false"))
+
         ("all-files", "File to dump all scanned files",
             cxxopts::value<std::string>()->default_value("all.txt"))
 
         ("dup-files", "File to dump duplicate files",
             cxxopts::value<std::string>()->default_value("duplicates.txt"))
 
+        ("stats-file", "File to write the metrics of the detection to as JSON",
+            cxxopts::value<std::string>())
+
         ("ign-files", "File to store ignored files",
             cxxopts::value<std::string>()->default_value("ignored.txt"))
 
@@ -127,6 +180,27 @@ void populateConfig(const cxxopts::ParseResult& opts, Config& cfg)
         }
     }
 
+    if (opts.contains("backup-dir"))
+    {
+        for (const auto& backupDir : opts["backup-dir"].as<std::vector<std::string>>())
+        {
+            cfg.addBackupDir(backupDir);
+        }
+    }
+
+    if (opts.contains("manifest"))
+    {
+        for (const auto& manifest : opts["manifest"].as<std::vector<std::string>>())
+        {
+            cfg.addManifest(manifest);
+        }
+    }
+
+    if (opts.contains("export-manifest"))
+    {
+        cfg.setExportManifestPath(opts["export-manifest"].as<std::string>());
+    }
+
     if (opts.contains("keep-path"))
     {
         for (const auto& keepPath : opts["keep-path"].as<std::vector<std::string>>())
@@ -154,12 +228,78 @@ void populateConfig(const cxxopts::ParseResult& opts, Config& cfg)
         cfg.setMaxFileSizeBytes(opts["max-size"].as<uint64_t>());
     }
 
+    if (opts.contains("hash-workers"))
+    {
+        cfg.setHashWorkers(opts["hash-workers"].as<uint64_t>());
+    }
+
+    if (opts.contains("hdd-workers"))
+    {
+        cfg.setHddWorkers(opts["hdd-workers"].as<uint64_t>());
+    }
+
+    if (opts.contains("ssd-workers"))
+    {
+        cfg.setSsdWorkers(opts["ssd-workers"].as<uint64_t>());
+    }
+
+    if (opts.contains("physical-order"))
+    {
+        cfg.setPhysicalOrder(opts["physical-order"].as<bool>());
+    }
+
+    if (opts.contains("hash-cache"))
+    {
+        cfg.setHashCache(opts["hash-cache"].as<bool>());
+    }
+
+    if (opts.contains("compare-max-files"))
+    {
+        cfg.setCompareMaxFiles(opts["compare-max-files"].as<uint64_t>());
+    }
+
+    if (opts.contains("read-buffer"))
+    {
+        cfg.setReadBufferBytes(opts["read-buffer"].as<uint64_t>());
+    }
+
+    if (opts.contains("read-backend"))
+    {
+        cfg.setReadBackend(str2backend(opts["read-backend"].as<std::string>()));
+    }
+
+    if (opts.contains("tree-hash-min"))
+    {
+        cfg.setTreeHashMinBytes(opts["tree-hash-min"].as<uint64_t>());
+    }
+
     if (opts.contains("update-freq"))
     {
         cfg.setUpdateFrequency(
             std::chrono::milliseconds(opts["update-freq"].as<uint64_t>()));
     }
 
+    if (opts.contains("checkpoint-interval"))
+    {
+        cfg.setCheckpointInterval(
+            std::chrono::seconds(opts["checkpoint-interval"].as<uint64_t>()));
+    }
+
+    if (opts.contains("resume"))
+    {
+        cfg.setResume(opts["resume"].as<bool>());
+    }
+
+    if (opts.contains("stream"))
+    {
+        cfg.setStreamGroups(opts["stream"].as<bool>());
+    }
+
+    if (opts.contains("dir-groups"))
+    {
+        cfg.setDirectoryGroups(opts["dir-groups"].as<bool>());
+    }
+
     if (opts.contains("all-files"))
     {
         cfg.setAllFilesPath(opts["all-files"].as<std::string>());
@@ -170,6 +310,11 @@ void populateConfig(const cxxopts::ParseResult& opts, Config& cfg)
         cfg.setDupFilesPath(opts["dup-files"].as<std::string>());
     }
 
+    if (opts.contains("stats-file"))
+    {
+        cfg.setStatsFilePath(opts["stats-file"].as<std::string>());
+    }
+
     if (opts.contains("ign-files"))
     {
         cfg.setIgnFilesPath(opts["ign-files"].as<std::string>());
@@ -9,9 +9,12 @@
 #include <filesystem>
 #include <regex>
 #include <algorithm>
+#include <format>
+#include <stdexcept>
 
 using namespace std::literals;
 using std::chrono::milliseconds;
+using std::chrono::seconds;
 
 namespace tools::dups {
 namespace {
@@ -99,6 +102,55 @@ void Config::addScanDir(fs::path dir)
     scanDirs_.push_back(std::move(dir));
 }
 
+const std::vector<fs::path>& Config::backupDirs() const noexcept
+{
+    return backupDirs_;
+}
+
+void Config::setBackupDirs(std::vector<fs::path> dirs)
+{
+    normalizePaths(dirs);
+    backupDirs_ = std::move(dirs);
+}
+
+void Config::addBackupDir(fs::path dir)
+{
+    normalizePath(dir);
+    backupDirs_.push_back(std::move(dir));
+}
+
+const std::vector<fs::path>& Config::manifests() const noexcept
+{
+    return manifests_;
+}
+
+void Config::setManifests(std::vector<fs::path> files)
+{
+    normalizePaths(files);
+    manifests_ = std::move(files);
+}
+
+void Config::addManifest(fs::path file)
+{
+    normalizePath(file);
+    manifests_.push_back(std::move(file));
+}
+
+const fs::path& Config::exportManifestPath() const noexcept
+{
+    return exportManifestPath_;
+}
+
+void Config::setExportManifestPath(fs::path path)
+{
+    // Written where asked, not to the data directory
+    if (!path.empty())
+    {
+        normalizePath(path);
+    }
+    exportManifestPath_ = std::move(path);
+}
+
 const std::vector<fs::path>& Config::dirsToKeepFrom() const noexcept
 {
     return dirsToKeepFrom_;
@@ -133,7 +185,7 @@ void Config::addDirToDeleteFrom(fs::path dir)
     dirsToDeleteFrom_.push_back(std::move(dir));
 }
 
-const std::vector<std::regex>& Config::exclusionPatterns() const noexcept
+const std::vector<std::string>& Config::exclusionPatterns() const noexcept
 {
     return exclusionPatterns_;
 }
@@ -149,8 +201,9 @@ void Config::setExclusionPatterns(const std::vector<std::string>& patterns)
 
 void Config::addExclusionPattern(std::string_view pattern)
 {
-    exclusionPatterns_.emplace_back(std::string(pattern),
-                                    std::regex_constants::ECMAScript);
+    // Validated here, compiled by the walker
+    std::regex(pattern.begin(), pattern.end(), std::regex_constants::ECMAScript);
+    exclusionPatterns_.emplace_back(pattern);
 }
 
 const fs::path& Config::dataDir() const noexcept
@@ -185,6 +238,17 @@ void Config::setDupFilesPath(fs::path path)
     adjustPath(dataDir(), dupFilesPath_);
 }
 
+const fs::path& Config::statsFilePath() const noexcept
+{
+    return statsFilePath_;
+}
+
+void Config::setStatsFilePath(fs::path path)
+{
+    statsFilePath_ = std::move(path);
+    adjustPath(dataDir(), statsFilePath_);
+}
+
 const fs::path& Config::ignFilesPath() const noexcept
 {
     return ignFilesPath_;
@@ -259,6 +323,96 @@ void Config::setMaxFileSizeBytes(size_t bytes)
     maxFileSizeBytes_ = bytes;
 }
 
+size_t Config::hashWorkers() const noexcept
+{
+    return hashWorkers_;
+}
+
+void Config::setHashWorkers(size_t workers)
+{
+    hashWorkers_ = workers;
+}
+
+size_t Config::hddWorkers() const noexcept
+{
+    return hddWorkers_;
+}
+
+void Config::setHddWorkers(size_t workers)
+{
+    hddWorkers_ = workers;
+}
+
+size_t Config::ssdWorkers() const noexcept
+{
+    return ssdWorkers_;
+}
+
+void Config::setSsdWorkers(size_t workers)
+{
+    ssdWorkers_ = workers;
+}
+
+bool Config::physicalOrder() const noexcept
+{
+    return physicalOrder_;
+}
+
+void Config::setPhysicalOrder(bool value)
+{
+    physicalOrder_ = value;
+}
+
+bool Config::hashCache() const noexcept
+{
+    return hashCache_;
+}
+
+void Config::setHashCache(bool value)
+{
+    hashCache_ = value;
+}
+
+size_t Config::compareMaxFiles() const noexcept
+{
+    return compareMaxFiles_;
+}
+
+void Config::setCompareMaxFiles(size_t files)
+{
+    compareMaxFiles_ = files;
+}
+
+size_t Config::readBufferBytes() const noexcept
+{
+    return readBufferBytes_;
+}
+
+void Config::setReadBufferBytes(size_t bytes)
+{
+    readBufferBytes_ = bytes;
+}
+
+ReadBackend Config::readBackend() const noexcept
+{
+    return readBackend_;
+}
+
+void Config::setReadBackend(ReadBackend backend)
+{
+    readBackend_ = backend;
+}
+
+uint64_t Config::treeHashMinBytes() const noexcept
+{
+    return treeHashMinBytes_;
+}
+
+void Config::setTreeHashMinBytes(uint64_t bytes)
+{
+    treeHashMinBytes_ = bytes;
+}
+
 std::chrono::milliseconds Config::updateFrequency() const noexcept
 {
     return updateFrequency_;
@@ -269,6 +423,46 @@ void Config::setUpdateFrequency(std::chrono::milliseconds freq)
     updateFrequency_ = freq;
 }
 
+std::chrono::seconds Config::checkpointInterval() const noexcept
+{
+    return checkpointInterval_;
+}
+
+void Config::setCheckpointInterval(std::chrono::seconds interval)
+{
+    checkpointInterval_ = interval;
+}
+
+bool Config::resume() const noexcept
+{
+    return resume_;
+}
+
+void Config::setResume(bool value)
+{
+    resume_ = value;
+}
+
+bool Config::streamGroups() const noexcept
+{
+    return streamGroups_;
+}
+
+void Config::setStreamGroups(bool value)
+{
+    streamGroups_ = value;
+}
+
+bool Config::directoryGroups() const noexcept
+{
+    return directoryGroups_;
+}
+
+void Config::setDirectoryGroups(bool value)
+{
+    directoryGroups_ = value;
+}
+
 bool Config::skipDetection() const noexcept
 {
     return skipDetection_;
@@ -293,16 +487,49 @@ void Config::setDryRun(bool value)
 //                                 HELPER FUNCTIONS
 // --------------------------------------------------------------------------------------
 
+std::string_view backend2str(ReadBackend backend) noexcept
+{
+    return backend == ReadBackend::IoUring ? "io_uring" : "threads";
+}
+
+ReadBackend str2backend(std::string_view name)
+{
+    for (const auto backend : {ReadBackend::Threads, ReadBackend::IoUring})
+    {
+        if (backend2str(backend) == name)
+        {
+            return backend;
+        }
+    }
+
+    throw std::invalid_argument(std::format("Unknown read backend: '{}'", name));
+}
+
 void applyDefaults(Config& cfg)
 {
     cfg.setMinFileSizeBytes(1024);
     cfg.setMaxFileSizeBytes(10UL * 1024 * 1024 * 1024);
+    cfg.setHashWorkers(0);
+    cfg.setHddWorkers(1);
+    cfg.setSsdWorkers(0);
+    cfg.setPhysicalOrder(true);
+    cfg.setHashCache(true);
+    cfg.setCompareMaxFiles(4);
+    cfg.setReadBufferBytes(1024 * 1024);
+    cfg.setReadBackend(ReadBackend::Threads);
+    cfg.setTreeHashMinBytes(1024ULL * 1024 * 1024);
     cfg.setUpdateFrequency(std::chrono::milliseconds(100));
+    cfg.setCheckpointInterval(std::chrono::seconds(60));
+    cfg.setResume(false);
+    cfg.setStreamGroups(false);
+    cfg.setDirectoryGroups(false);
     cfg.setAllFilesPath("all.txt");
     cfg.setIgnFilesPath("ignored.txt");
     cfg.setKeepFilesPath("keep.txt");
     cfg.setDelFilesPath("delete.txt");
     cfg.setDupFilesPath("duplicates.txt");
+    cfg.setStatsFilePath("");
+    cfg.setExportManifestPath("");
 }
 
 void logConfig(const Config& cfg)
@@ -312,10 +539,14 @@ void logConfig(const Config& cfg)
     spdlog::trace(pattern, "Log file", cfg.logDir() / cfg.logFilename());
     spdlog::trace(pattern, "All files path", cfg.allFilesPath());
     spdlog::trace(pattern, "Duplicate files path", cfg.dupFilesPath());
+    spdlog::trace(pattern, "Stats file path", cfg.statsFilePath());
     spdlog::trace(pattern, "Ignored files path", cfg.ignFilesPath());
     spdlog::trace(pattern, "Delete files path", cfg.delFilesPath());
     spdlog::trace(pattern, "Keep files path", cfg.keepFilesPath());
     spdlog::trace(pattern, "Scan directories", concat(cfg.scanDirs(), ", "));
+    spdlog::trace(pattern, "Backup directories", concat(cfg.backupDirs(), ", "));
+    spdlog::trace(pattern, "Manifests", concat(cfg.manifests(), ", "));
+    spdlog::trace(pattern, "Export manifest path", cfg.exportManifestPath());
     spdlog::trace(pattern,
                   "Directories to keep from",
                   concat(cfg.dirsToKeepFrom(), ", "));
@@ -325,9 +556,25 @@ void logConfig(const Config& cfg)
     spdlog::trace(pattern, "Cache directory", cfg.cacheDir());
     spdlog::trace(pattern, "Min file size bytes", cfg.minFileSizeBytes());
     spdlog::trace(pattern, "Max file size bytes", cfg.maxFileSizeBytes());
+    spdlog::trace(pattern, "Hash workers", cfg.hashWorkers());
+    spdlog::trace(pattern, "HDD workers", cfg.hddWorkers());
+    spdlog::trace(pattern, "SSD workers", cfg.ssdWorkers());
+    spdlog::trace(pattern, "Physical order", cfg.physicalOrder());
+    spdlog::trace(pattern, "Hash cache", cfg.hashCache());
+    spdlog::trace(pattern, "Compare max files", cfg.compareMaxFiles());
+    spdlog::trace(pattern, "Read buffer bytes", cfg.readBufferBytes());
+    spdlog::trace(pattern, "Read backend", backend2str(cfg.readBackend()));
+    spdlog::trace(pattern, "Tree hash min bytes", cfg.treeHashMinBytes());
+    spdlog::trace(pattern,
+                  "Checkpoint interval sec",
+                  cfg.checkpointInterval().count());
+    spdlog::trace(pattern, "Resume", cfg.resume());
+    spdlog::trace(pattern, "Stream groups", cfg.streamGroups());
+    spdlog::trace(pattern, "Directory groups", cfg.directoryGroups());
     spdlog::trace(pattern, "Dry run", cfg.dryRun());
-    // spdlog::trace(pattern, "Exclusion patterns", concat(cfg.exclusionPatterns, ",
-    // "));
+    spdlog::trace(pattern,
+                  "Exclusion patterns",
+                  concat(cfg.exclusionPatterns(), ", "));
 }
 
 void applyOverrides(const fs::path& cfgFile, Config& cfg)
@@ -361,6 +608,27 @@ void applyOverrides(const fs::path& cfgFile, Config& cfg)
         }
     });
 
+    // Optional, only the cross-set comparison uses it
+    if (const auto* dirs = config["backup_directories"].as_array())
+    {
+        dirs->for_each([&cfg](const auto& value) {
+            if constexpr (toml::is_string<decltype(value)>)
+            {
+                cfg.addBackupDir(value.value_or(""sv));
+            }
+        });
+    }
+
+    if (const auto* files = config["manifests"].as_array())
+    {
+        files->for_each([&cfg](const auto& value) {
+            if constexpr (toml::is_string<decltype(value)>)
+            {
+                cfg.addManifest(value.value_or(""sv));
+            }
+        });
+    }
+
     config["dirs_to_keep_from"].as_array()->for_each([&cfg](const auto& value) {
         if constexpr (toml::is_string<decltype(value)>)
         {
@@ -379,8 +647,29 @@ void applyOverrides(const fs::path& cfgFile, Config& cfg)
         config["min_file_size_bytes"].value_or(cfg.minFileSizeBytes()));
     cfg.setMaxFileSizeBytes(
         config["max_file_size_bytes"].value_or(cfg.maxFileSizeBytes()));
+    cfg.setHashWorkers(config["hash_workers"].value_or(cfg.hashWorkers()));
+    cfg.setHddWorkers(config["hdd_workers"].value_or(cfg.hddWorkers()));
+    cfg.setSsdWorkers(config["ssd_workers"].value_or(cfg.ssdWorkers()));
+    cfg.setPhysicalOrder(config["physical_order"].value_or(cfg.physicalOrder()));
+    cfg.setHashCache(config["hash_cache"].value_or(cfg.hashCache()));
+    cfg.setCompareMaxFiles(
+        config["compare_max_files"].value_or(cfg.compareMaxFiles()));
+    cfg.setReadBufferBytes(
+        config["read_buffer_bytes"].value_or(cfg.readBufferBytes()));
+
+    if (config.contains("read_backend"))
+    {
+        cfg.setReadBackend(str2backend(config["read_backend"].value_or(""sv)));
+    }
+    cfg.setTreeHashMinBytes(
+        config["tree_hash_min_bytes"].value_or(cfg.treeHashMinBytes()));
     cfg.setUpdateFrequency(milliseconds(
         config["update_freq_ms"].value_or(cfg.updateFrequency().count())));
+    cfg.setCheckpointInterval(seconds(config["checkpoint_interval_sec"].value_or(
+        cfg.checkpointInterval().count())));
+    cfg.setResume(config["resume"].value_or(cfg.resume()));
+    cfg.setStreamGroups(config["stream_groups"].value_or(cfg.streamGroups()));
+    cfg.setDirectoryGroups(config["dir_groups"].value_or(cfg.directoryGroups()));
 
     if (config.contains("all_files"))
     {
@@ -392,6 +681,16 @@ void applyOverrides(const fs::path& cfgFile, Config& cfg)
         cfg.setDupFilesPath(config["dup_files"].value_or(""));
     }
 
+    if (config.contains("stats_file"))
+    {
+        cfg.setStatsFilePath(config["stats_file"].value_or(""));
+    }
+
+    if (config.contains("export_manifest"))
+    {
+        cfg.setExportManifestPath(config["export_manifest"].value_or(""));
+    }
+
     if (config.contains("ign_files"))
     {
         cfg.setIgnFilesPath(config["ign_files"].value_or(""));
@@ -13,7 +13,8 @@ namespace tools::dups {
 
 void PermanentDelete::remove(const fs::path& file) const
 {
-    fs::remove(file);
+    // Equal directories are deleted with all of their content
+    fs::remove_all(file);
     spdlog::info("Deleted: {}", file);
 }
 
@@ -85,8 +86,10 @@ void BackupAndDelete::remove(const fs::path& file) const
     {
         // Move fails, it can be for exapmle because of cross device operation,
         // no need to log error, try copying and deleting
-        fs::copy_file(absFile, backupFilePath, fs::copy_options::overwrite_existing);
-        fs::remove(absFile);
+        fs::copy(absFile,
+                 backupFilePath,
+                 fs::copy_options::overwrite_existing | fs::copy_options::recursive);
+        fs::remove_all(absFile);
     }
 
     spdlog::info("Moved: {} to {}", absFile, backupFilePath);
@@ -8,8 +8,12 @@
 
 #include <algorithm>
 #include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
 #include <cassert>
 #include <stdexcept>
+#include <system_error>
 #include "core/utils/Str.h"
 
 #include <spdlog/spdlog.h>
@@ -59,6 +63,76 @@ void menuOption(Menu& menu, size_t count, Action action)
              std::move(action));
 }
 
+using Listing = std::map<fs::path, uintmax_t>;
+
+/**
+ * @brief Regular files below the directory by their relative paths, with their sizes.
+ * None if it holds anything else than files and directories, or its files don't add
+ * up to the detected size.
+ */
+std::optional<Listing> listFiles(const fs::path& dir, size_t size)
+{
+    Listing files;
+    uintmax_t total = 0;
+    std::error_code ec;
+
+    for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end;
+         it.increment(ec))
+    {
+        const auto status = it->symlink_status(ec);
+
+        if (ec || (!fs::is_directory(status) && !fs::is_regular_file(status)))
+        {
+            return std::nullopt;
+        }
+
+        if (fs::is_regular_file(status))
+        {
+            const auto fileSize = it->file_size(ec);
+            total += fileSize;
+            files.emplace(it->path().lexically_relative(dir), fileSize);
+        }
+    }
+
+    if (ec || total != size)
+    {
+        return std::nullopt;
+    }
+
+    return files;
+}
+
+/**
+ * @brief Check that the local directories of the group still hold the detected
+ * content only, all of them the same files
+ */
+bool unchanged(const DupGroup& group)
+{
+    std::optional<Listing> first;
+
+    for (const auto& e : group.entires)
+    {
+        if (!e.directory || e.remote)
+        {
+            continue;
+        }
+
+        auto files = listFiles(e.file, e.size);
+
+        if (!files || (first && *files != *first))
+        {
+            return false;
+        }
+
+        if (!first)
+        {
+            first = std::move(files);
+        }
+    }
+
+    return true;
+}
+
 void openDirectories(const PathsVec& files)
 {
     std::unordered_set<fs::path> uniqueDirs;
@@ -477,6 +551,16 @@ public:
 
         updateProgress(groupIdx, totalGroups);
 
+        // The directories are deleted with all of their content, it must be the one
+        // the detection compared
+        if (!unchanged(group))
+        {
+            spdlog::warn("Directories differ from their detected content, the group "
+                         "is left intact: {}",
+                         group.entires.front().file);
+            return true;
+        }
+
         while (flow == Flow::Retry)
         {
             categorizeFiles(group.entires);
@@ -505,7 +589,14 @@ private:
     void updateProgress(size_t current, size_t total)
     {
         cfg_.progress().update([&](auto& os) {
-            os << "Processing group " << current << " of " << total << '\n';
+            os << "Processing group " << current;
+
+            // The total is not known while the groups are still detected
+            if (total > 0)
+            {
+                os << " of " << total;
+            }
+            os << '\n';
         });
     }
 
@@ -515,6 +606,12 @@ private:
         selective_.clear();
         for (const auto& e : entries)
         {
+            // The files of other hosts are neither deleted nor kept instead of a local
+            // copy, the local ones are chosen from
+            if (e.remote)
+            {
+                continue;
+            }
             if (sensitiveToExternalEvents_ && !fs::exists(e.file))
             {
                 continue;
@@ -543,7 +640,16 @@ private:
         }
 
         cfg_.out() << "Size: " << group.entires.front().size
-                   << " SHA256: " << group.entires.front().sha256 << '\n';
+                   << " SHA256: " << core::crypto::toHex(group.entires.front().sha256)
+                   << '\n';
+
+        for (const auto& e : group.entires)
+        {
+            if (e.remote)
+            {
+                cfg_.out() << "On another host: " << e.file << '\n';
+            }
+        }
 
         std::ranges::sort(selective_);
         return deleteInteractively(selective_, cfg_);
@@ -561,4 +667,13 @@ void deleteDuplicates(const IDuplicateGroups& duplicates, DeletionConfig& cfg)
     });
 }
 
+DupGroupCallback duplicatesDeleter(DeletionConfig& cfg)
+{
+    auto processor = std::make_shared<GroupProcessor>(cfg);
+
+    return [processor, i = 0ULL](const DupGroup& group) mutable {
+        return processor->process(group, ++i, 0);
+    };
+}
+
 } // namespace tools::dups
@@ -1,35 +1,2143 @@
 #include <duplicates/DuplicateDetector.h>
+#include <duplicates/HashCache.h>
+#include <duplicates/HashEngine.h>
+#include <duplicates/RadixSort.h>
 #include <duplicates/Utils.h>
+#include <core/utils/Crypto.h>
+#include <core/utils/File.h>
+#include <core/utils/FileReader.h>
+#include <core/utils/UringReader.h>
+#include <core/utils/FmtExt.h>
+#include <core/utils/Str.h>
+#include <core/utils/Sys.h>
 #include <spdlog/spdlog.h>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <optional>
+#include <ranges>
+#include <set>
+#include <stdexcept>
+#include <span>
 #include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 namespace tools::dups {
 namespace {
 
-bool tryGetSha256(const Node* node, std::string& sha256)
+using Nodes = std::vector<const Node*>;
+using Groups = std::vector<Nodes>;
+using core::crypto::ByteRange;
+using core::crypto::Digest;
+using core::crypto::DigestType;
+using ByteRanges = std::vector<ByteRange>;
+using Links = std::unordered_map<const Node*, Nodes>;
+using GroupFilter = std::function<bool(const Nodes&)>;
+using Known = std::unordered_map<const Node*, FileDigests>;
+
+struct Device
 {
-    try
+    // Maximum number of concurrent reads, 0 doesn't limit
+    size_t limit {};
+    bool rotational {};
+};
+
+using Devices = std::unordered_map<uint64_t, Device>;
+using Locations = std::unordered_map<const Node*, uint64_t>;
+
+/**
+ * @brief Where the files are, the reads are scheduled according to it
+ */
+struct Placement
+{
+    Devices devices {};
+
+    // Files of the rotational devices are read in the order of their locations
+    Locations locations {};
+};
+
+/**
+ * @brief File of the size bucketing
+ */
+struct SizedNode
+{
+    size_t size {};
+    const Node* node {};
+};
+
+struct FileIdHash
+{
+    size_t operator()(const FileId& id) const noexcept
+    {
+        return std::hash<uint64_t> {}(id.inode * 31 + id.device);
+    }
+};
+
+// Partial rounds, most of the same size files differ in the first few KB
+constexpr uint64_t HEAD_BYTES = 4 * 1024;
+constexpr uint64_t TAIL_BYTES = 4 * 1024;
+constexpr uint64_t SAMPLE_BLOCKS = 16;
+constexpr uint64_t SAMPLE_BLOCK_BYTES = 16 * 1024;
+
+// First block of the lock-step comparison, the following ones grow up to the buffer
+constexpr uint64_t COMPARE_FIRST_BLOCK_BYTES = 4 * 1024;
+
+// Minimum number of files in a batch of the buckets when the groups are streamed
+constexpr size_t STREAM_BATCH_FILES = 1024;
+
+// Chunks of the tree digests, the digests depend on it
+constexpr uint64_t TREE_CHUNK_BYTES = 64 * 1024 * 1024;
+
+constexpr std::array WHOLE_FILE {ByteRange {0, std::numeric_limits<uint64_t>::max()}};
+
+/**
+ * @brief Byte ranges inspected by the given round for a file with the given size.
+ * Empty result means that the round can't bring any new information about the file.
+ */
+ByteRanges stageRanges(Stage stage, uint64_t size)
+{
+    switch (stage)
+    {
+        case Stage::Head:
+            return {{0, std::min(size, HEAD_BYTES)}};
+
+        case Stage::Tail:
+            if (size > HEAD_BYTES)
+            {
+                const auto length = std::min(TAIL_BYTES, size - HEAD_BYTES);
+                return {{size - length, length}};
+            }
+            break;
+
+        case Stage::Sample:
+            if (size > HEAD_BYTES + TAIL_BYTES)
+            {
+                const uint64_t middle = size - HEAD_BYTES - TAIL_BYTES;
+
+                if (middle <= SAMPLE_BLOCKS * SAMPLE_BLOCK_BYTES)
+                {
+                    return {{HEAD_BYTES, middle}};
+                }
+
+                // Blocks evenly spread across the middle of the file
+                ByteRanges ranges;
+                const uint64_t step = middle / SAMPLE_BLOCKS;
+
+                for (uint64_t i = 0; i < SAMPLE_BLOCKS; ++i)
+                {
+                    ranges.push_back({HEAD_BYTES + i * step, SAMPLE_BLOCK_BYTES});
+                }
+                return ranges;
+            }
+            break;
+
+        case Stage::Calculate:
+            // Smaller files are completely covered by the head round
+            if (size > HEAD_BYTES)
+            {
+                return {{0, size}};
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return {};
+}
+
+uint64_t rangesLength(const ByteRanges& ranges)
+{
+    uint64_t length = 0;
+
+    for (const auto& range : ranges)
+    {
+        length += range.length;
+    }
+
+    return length;
+}
+
+/**
+ * @brief How the rounds read the files
+ */
+struct Reading
+{
+    // Size of the chunks, 0 selects the default of the readers
+    size_t bufferBytes {0};
+
+    // When available, the fast rounds read through it instead of the hash workers
+    core::file::UringReader* uring {nullptr};
+
+    // Devices the files are on, the workers read them in per device queues
+    const Placement* placement {nullptr};
+
+    // Full digests of the files of at least that size are tree digests, 0 disables
+    uint64_t treeMinBytes {0};
+
+    // Its workers without a job digest the chunks of the tree digests, if given
+    const HashEngine* engine {nullptr};
+};
+
+/**
+ * @brief Adds the time, the reads and the cache hits from its construction until
+ * its destruction to the statistics of a stage
+ */
+class StageMeter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    StageMeter(StageStats& stats, const std::atomic<size_t>& cacheHits) noexcept
+        : stats_ {stats}
+        , cacheHits_ {cacheHits}
+        , wall_ {Clock::now()}
+        , cpu_ {core::sys::currentProcessCpuTime()}
+        , io_ {core::file::ioCounters()}
+        , hits_ {cacheHits.load()}
+    {
+    }
+
+    StageMeter(const StageMeter&) = delete;
+    StageMeter& operator=(const StageMeter&) = delete;
+
+    ~StageMeter()
+    {
+        const auto io = core::file::ioCounters();
+
+        stats_.wall += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - wall_);
+        stats_.cpu += core::sys::currentProcessCpuTime() - cpu_;
+        stats_.opens += io.opens - io_.opens;
+        stats_.reads += io.reads - io_.reads;
+        stats_.bytes += io.bytes - io_.bytes;
+        stats_.cacheHits += cacheHits_.load() - hits_;
+    }
+
+private:
+    StageStats& stats_;
+    const std::atomic<size_t>& cacheHits_;
+    Clock::time_point wall_;
+    std::chrono::nanoseconds cpu_;
+    core::file::IoCounters io_;
+    size_t hits_;
+};
+
+/**
+ * @brief Kind and concurrency of the reads of every device the files of the groups
+ * are on
+ */
+Devices probeDevices(const Groups& groups, size_t hddWorkers, size_t ssdWorkers)
+{
+    Devices devices;
+
+    for (const auto& nodes : groups)
+    {
+        for (const auto* node : nodes)
+        {
+            const auto device = node->id().device;
+
+            if (devices.contains(device))
+            {
+                continue;
+            }
+
+            const auto rotational = core::file::rotationalDevice(device);
+            const auto hdd = rotational.value_or(false);
+            const auto limit = hdd ? hddWorkers : ssdWorkers;
+            devices.emplace(device, Device {.limit = limit, .rotational = hdd});
+
+            spdlog::debug("Device {}: {}, concurrent reads: {}",
+                          device,
+                          rotational ? (*rotational ? "rotational" : "solid state")
+                                     : "unknown",
+                          limit ? std::to_string(limit) : "all workers");
+        }
+    }
+
+    return devices;
+}
+
+/**
+ * @brief Position of the files of the rotational devices. It is the physical offset
+ * of the first extent when the file system of the device reports it for all the
+ * files, the inode number otherwise. Files created together tend to have close
+ * inodes as well as close data.
+ */
+Locations locateFiles(const Groups& groups, const Devices& devices)
+{
+    std::unordered_map<uint64_t, Nodes> rotational;
+
+    for (const auto& nodes : groups)
+    {
+        for (const auto* node : nodes)
+        {
+            if (devices.at(node->id().device).rotational)
+            {
+                rotational[node->id().device].push_back(node);
+            }
+        }
+    }
+
+    Locations locations;
+
+    for (auto& [device, nodes] : rotational)
+    {
+        // The inodes are read to query the extents, in order they are cheaper
+        std::ranges::sort(nodes, {}, [](const Node* node) {
+            return node->id().inode;
+        });
+
+        bool extents = true;
+
+        for (const auto* node : nodes)
+        {
+            const auto offset = core::file::physicalOffset(node->fullPath());
+
+            if (!offset)
+            {
+                extents = false;
+                break;
+            }
+            locations[node] = *offset;
+        }
+
+        if (!extents)
+        {
+            for (const auto* node : nodes)
+            {
+                locations[node] = node->id().inode;
+            }
+        }
+
+        spdlog::debug("Device {}: {} files read in the order of their {}",
+                      device,
+                      nodes.size(),
+                      extents ? "physical offsets" : "inodes");
+    }
+
+    return locations;
+}
+
+/**
+ * @brief Queue per device, the job at every index reads the file of the node. Jobs
+ * of the located files are ordered by their location.
+ */
+JobQueues deviceQueues(const Nodes& jobs, const Placement& placement)
+{
+    JobQueues queues;
+    std::unordered_map<uint64_t, uint32_t> ids;
+    queues.queueOf.reserve(jobs.size());
+
+    for (const auto* node : jobs)
+    {
+        const auto device = node->id().device;
+        const auto queue = static_cast<uint32_t>(queues.limits.size());
+        const auto [it, inserted] = ids.emplace(device, queue);
+
+        if (inserted)
+        {
+            const auto found = placement.devices.find(device);
+            queues.limits.push_back(
+                found != placement.devices.end() ? found->second.limit : 0);
+        }
+        queues.queueOf.push_back(it->second);
+    }
+
+    if (!placement.locations.empty())
+    {
+        queues.order.reserve(jobs.size());
+
+        // Files of the other devices keep the order of the jobs
+        for (size_t i = 0; i < jobs.size(); ++i)
+        {
+            const auto found = placement.locations.find(jobs[i]);
+            queues.order.push_back(found != placement.locations.end() ? found->second
+                                                                      : i);
+        }
+    }
+
+    return queues;
+}
+
+/**
+ * @brief Whether the file may be read by io_uring, which keeps many reads in flight
+ * in the order of the jobs. The files of the devices with a limit of the concurrent
+ * reads and of the rotational ones are left to the queues of the workers, which
+ * respect the limit and the physical order.
+ */
+bool batched(const Node* node, const Placement* placement)
+{
+    if (placement == nullptr)
     {
-        sha256 = node->sha256();
         return true;
     }
-    catch (const std::system_error& se)
+
+    const auto found = placement->devices.find(node->id().device);
+
+    return found == placement->devices.end() ||
+           (found->second.limit == 0 && !found->second.rotational);
+}
+
+/**
+ * @brief Files of the tree in the order of their enumeration, the checkpoints refer
+ * to them by the index
+ */
+struct FileIndex
+{
+    Nodes files {};
+    std::unordered_map<const Node*, uint32_t> ids {};
+
+    explicit FileIndex(const Node& root)
+    {
+        root.enumLeafs([this](const Node* node) {
+            ids.emplace(node, static_cast<uint32_t>(files.size()));
+            files.push_back(node);
+        });
+    }
+
+    const Node* node(uint32_t id) const
+    {
+        if (id >= files.size())
+        {
+            throw std::invalid_argument(
+                std::format("The checkpoint refers to unknown file: {}", id));
+        }
+
+        return files[id];
+    }
+};
+
+/**
+ * @brief Keeps the state of the detection and reports it through the checkpoint
+ * callback. The digests restored from a resumed state are handed to the round they
+ * were calculated by.
+ */
+class Checkpoints
+{
+public:
+    Checkpoints(const Options& opts, const Node& root)
+        : cb_ {opts.checkpoint}
+        , interval_ {opts.checkpointInterval}
+    {
+        if (cb_ || opts.resume)
+        {
+            index_.emplace(root);
+        }
+    }
+
+    /**
+     * @brief Restore the groups of the given state and memoize its digests
+     */
+    void resume(const DetectionState& state, Groups& groups, Groups& compared)
+    {
+        // Reported again as it is until the next round is finished
+        state_ = state;
+        groups = toGroups(state.groups);
+        compared = toGroups(state.compared);
+
+        for (size_t g = 0; g < compared.size() && g < state.comparedDigests.size();
+             ++g)
+        {
+            const auto& digest = state.comparedDigests[g];
+            for (const auto* node : compared[g])
+            {
+                node->sha256([&digest](const fs::path&) {
+                    return digest;
+                });
+            }
+        }
+
+        for (const auto& [id, digest] : state.digests)
+        {
+            const auto* node = index_->node(id);
+
+            // The confirmation digests are the ones memoized by the nodes
+            if (state.stage == Stage::Calculate)
+            {
+                node->sha256([&digest](const fs::path&) {
+                    return digest;
+                });
+            }
+            restored_.emplace(node, digest);
+        }
+
+        spdlog::info("Resuming the detection after the round: {}, {} digests known",
+                     stage2str(state.stage),
+                     state.digests.size());
+    }
+
+    /**
+     * @brief Check if the round was finished before the detection was resumed
+     */
+    bool finished(Stage stage) const noexcept
+    {
+        return stage <= state_.stage;
+    }
+
+    /**
+     * @brief Take the digest of the file calculated before the detection was resumed
+     */
+    bool restore(const Node* node, Digest& digest) const
+    {
+        const auto it = restored_.find(node);
+
+        if (it == restored_.end())
+        {
+            return false;
+        }
+
+        digest = it->second;
+        return true;
+    }
+
+    /**
+     * @brief Report the state after the given round is finished
+     */
+    void round(Stage stage,
+               const Groups& groups,
+               const Groups& cached,
+               const Groups& compared)
+    {
+        state_.stage = stage;
+        restored_.clear();
+
+        if (!index_)
+        {
+            return;
+        }
+
+        state_.groups = toIds(groups);
+        const auto more = toIds(cached);
+        state_.groups.insert(state_.groups.end(), more.begin(), more.end());
+        state_.compared = toIds(compared);
+        state_.comparedDigests.clear();
+        state_.digests.clear();
+
+        // The digests of the equal files are calculated by the comparison
+        for (const auto& nodes : compared)
+        {
+            state_.comparedDigests.push_back(nodes.front()->sha256());
+        }
+        report();
+    }
+
+    /**
+     * @brief Report the state with all the digests calculated so far
+     */
+    void flush()
+    {
+        if (index_)
+        {
+            report();
+        }
+    }
+
+    /**
+     * @brief Remember the digest calculated by the round in progress, the state is
+     * reported when the interval elapsed
+     */
+    void digest(const Node* node, const Digest& digest)
+    {
+        if (!cb_)
+        {
+            return;
+        }
+
+        state_.digests.emplace_back(index_->ids.at(node), digest);
+
+        if (Clock::now() - reported_ >= interval_)
+        {
+            report();
+        }
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    const CheckpointCallback& cb_;
+    std::chrono::seconds interval_;
+    std::optional<FileIndex> index_;
+    std::unordered_map<const Node*, Digest> restored_;
+    DetectionState state_;
+    Clock::time_point reported_ {Clock::now()};
+
+    void report()
+    {
+        if (cb_)
+        {
+            cb_(state_);
+        }
+        reported_ = Clock::now();
+    }
+
+    Groups toGroups(const std::vector<std::vector<uint32_t>>& ids) const
+    {
+        Groups groups;
+
+        for (const auto& group : ids)
+        {
+            auto& nodes = groups.emplace_back();
+            for (const auto id : group)
+            {
+                nodes.push_back(index_->node(id));
+            }
+        }
+
+        return groups;
+    }
+
+    std::vector<std::vector<uint32_t>> toIds(const Groups& groups) const
+    {
+        std::vector<std::vector<uint32_t>> ids;
+
+        for (const auto& nodes : groups)
+        {
+            auto& group = ids.emplace_back();
+            for (const auto* node : nodes)
+            {
+                group.push_back(index_->ids.at(node));
+            }
+        }
+
+        return ids;
+    }
+};
+
+/**
+ * @brief Reader of the calling thread, the workers of the engine keep their buffers
+ * across the jobs and the rounds
+ */
+core::file::FileReader& threadReader(size_t bufferBytes)
+{
+    thread_local core::file::FileReader reader;
+
+    if (bufferBytes == 0)
+    {
+        bufferBytes = core::file::ReaderOptions {}.bufferSize;
+    }
+
+    // The buffer is allocated on the first read, so the sizes are compared after the
+    // reader rounded them
+    core::file::FileReader wanted({.bufferSize = bufferBytes});
+
+    if (wanted.options().bufferSize != reader.options().bufferSize)
+    {
+        reader = std::move(wanted);
+    }
+
+    return reader;
+}
+
+bool treeDigested(const Reading& reading, uint64_t size) noexcept
+{
+    return reading.treeMinBytes != 0 && size >= reading.treeMinBytes;
+}
+
+/**
+ * @brief Digest of the selected bytes of a file with the given size, read from the
+ * given device. Large files get the tree digest, their chunks are digested in
+ * parallel by the calling thread and the idle workers of the engine, up to the limit
+ * of the concurrent reads of the device.
+ */
+Digest fullDigest(const fs::path& file,
+                  uint64_t size,
+                  uint64_t device,
+                  DigestType type,
+                  std::span<const ByteRange> ranges,
+                  const Reading& reading)
+{
+    if (!treeDigested(reading, size))
+    {
+        return core::crypto::fileDigest(threadReader(reading.bufferBytes),
+                                        file,
+                                        type,
+                                        ranges);
+    }
+
+    core::crypto::TreeOptions opts {
+        .chunkBytes = TREE_CHUNK_BYTES,
+        .workers = 1,
+    };
+    if (reading.bufferBytes != 0)
+    {
+        opts.bufferSize = reading.bufferBytes;
+    }
+
+    if (reading.engine == nullptr)
+    {
+        return core::crypto::fileTreeDigest(file, type, ranges, opts);
+    }
+
+    auto limit = reading.engine->workers();
+
+    if (reading.placement)
+    {
+        const auto found = reading.placement->devices.find(device);
+        if (found != reading.placement->devices.end() && found->second.limit != 0)
+        {
+            limit = std::min(limit, found->second.limit);
+        }
+    }
+
+    // The workers busy with other jobs are not joined, so the threads never outnumber
+    // the workers
+    const auto lease = reading.engine->borrowIdle(limit - 1);
+    opts.workers = 1 + lease.count();
+
+    return core::crypto::fileTreeDigest(file, type, ranges, opts);
+}
+
+/**
+ * @brief Digest identifying the node in the given stage. The rounds before the
+ * confirmation use the fast digest, only the final candidates get the SHA256.
+ */
+Digest stageDigest(Stage stage,
+                   const Node* node,
+                   const Node::DigestFunction& sha256,
+                   const Reading& reading)
+{
+    if (stage == Stage::Confirm)
+    {
+        return node->sha256(sha256);
+    }
+
+    const auto ranges = stageRanges(stage, node->size());
+
+    if (stage == Stage::Calculate)
+    {
+        return fullDigest(node->fullPath(),
+                          node->size(),
+                          node->id().device,
+                          DigestType::Fast128,
+                          ranges,
+                          reading);
+    }
+
+    return core::crypto::fileDigest(threadReader(reading.bufferBytes),
+                                    node->fullPath(),
+                                    DigestType::Fast128,
+                                    ranges);
+}
+
+/**
+ * @brief Number of bytes the given stage reads from the file with the given size
+ */
+uint64_t stageBytes(Stage stage, uint64_t size)
+{
+    if (stage == Stage::Confirm)
+    {
+        return size;
+    }
+
+    return rangesLength(stageRanges(stage, size));
+}
+
+/**
+ * @brief Digest of the given round known without reading the file. The whole content
+ * is known by its SHA256 only, the Calculate round has none.
+ */
+const Digest* knownDigest(const FileDigests& digests, Stage stage) noexcept
+{
+    switch (stage)
+    {
+        case Stage::Head:
+            return &digests.head;
+        case Stage::Tail:
+            return &digests.tail;
+        case Stage::Sample:
+            return &digests.sample;
+        case Stage::Confirm:
+            return &digests.sha256;
+        default:
+            return nullptr;
+    }
+}
+
+/**
+ * @brief Whether the node is a file with known digests or a directory of them. The
+ * directories hold either known or local files only, the first one tells.
+ */
+bool isKnown(const Node* node, const Known& known)
+{
+    while (!node->leaf())
+    {
+        const Node* first = nullptr;
+        node->enumChildren([&first](const Node* child) {
+            if (first == nullptr)
+            {
+                first = child;
+            }
+        });
+        node = first;
+    }
+
+    return known.contains(node);
+}
+
+/**
+ * @brief Whether any of the nodes is on this host, only those can be acted upon
+ */
+bool local(const Nodes& nodes, const Known& known)
+{
+    return known.empty() || !std::ranges::all_of(nodes, [&known](const Node* node) {
+        return isKnown(node, known);
+    });
+}
+
+/**
+ * @brief All the digests of the file, as the rounds calculate them
+ */
+FileDigests fileDigests(const Node* node,
+                        const Node::DigestFunction& sha256,
+                        const Reading& reading)
+{
+    auto partial = [node, &sha256, &reading](Stage stage, Digest& digest) {
+        if (stageBytes(stage, node->size()) > 0)
+        {
+            digest = stageDigest(stage, node, sha256, reading);
+        }
+    };
+
+    FileDigests digests;
+    partial(Stage::Head, digests.head);
+    partial(Stage::Tail, digests.tail);
+    partial(Stage::Sample, digests.sample);
+    digests.sha256 = node->sha256(sha256);
+
+    return digests;
+}
+
+bool tryGetDigest(Stage stage,
+                  const Node* node,
+                  const Node::DigestFunction& sha256,
+                  const Reading& reading,
+                  Digest& digest)
+{
+    try
+    {
+        digest = stageDigest(stage, node, sha256, reading);
+        return true;
+    }
+    catch (const std::system_error& se)
+    {
+        spdlog::error("std::system_error: {}", se.what());
+    }
+    catch (const std::exception& e)
+    {
+        spdlog::error("std::exception: {}", e.what());
+    }
+
+    return false;
+}
+
+/**
+ * @brief Calculate the fast digests of the given stage with the reads of the pending
+ * jobs going through the io_uring. Hashing runs on the calling thread, which keeps
+ * many reads in flight instead of one per worker.
+ */
+void digestBatch(Stage stage,
+                 const Nodes& jobs,
+                 const std::vector<size_t>& pending,
+                 core::file::UringReader& reader,
+                 std::vector<Digest>& digests,
+                 std::vector<uint8_t>& hashed,
+                 const HashEngine::DoneCallback& done)
+{
+    std::vector<std::optional<core::crypto::DigestHasher>> hashers(pending.size());
+
+    reader.read(
+        pending.size(),
+        [stage, &jobs, &pending, &hashers](size_t k) {
+            const auto* node = jobs[pending[k]];
+            hashers[k].emplace(DigestType::Fast128);
+
+            return core::file::ReadRequest {
+                .path = node->fullPath(),
+                .ranges = stageRanges(stage, node->size()),
+            };
+        },
+        [&hashers](size_t k, std::string_view chunk) {
+            hashers[k]->update(chunk);
+        },
+        [&](size_t k, const auto& ec) {
+            const auto i = pending[k];
+
+            if (ec)
+            {
+                spdlog::error("Error: '{}' while reading file: '{}'",
+                              ec.message(),
+                              jobs[i]->fullPath());
+            }
+            else
+            {
+                hashers[k]->final(digests[i]);
+                hashed[i] = 1;
+            }
+
+            hashers[k].reset();
+            done(k);
+        });
+}
+
+/**
+ * @brief Digested file of a round, identified by its position in the jobs
+ */
+struct DigestRecord
+{
+    size_t group {};
+    size_t job {};
+
+    // Leading bytes of the digest
+    uint64_t prefix {};
+};
+
+/**
+ * @brief The digested files sorted by their group and digest. The files of a group
+ * with equal digests end up next to each other, in the order of the jobs.
+ */
+std::vector<DigestRecord> sortByDigest(const Groups& groups,
+                                       const std::vector<uint8_t>& active,
+                                       const std::vector<Digest>& digests,
+                                       const std::vector<uint8_t>& hashed)
+{
+    std::vector<DigestRecord> records;
+    size_t job = 0;
+
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        if (active[g] == 0)
+        {
+            continue;
+        }
+
+        for (size_t k = 0; k < groups[g].size(); ++k, ++job)
+        {
+            if (hashed[job] != 0)
+            {
+                auto& record = records.emplace_back();
+                record.group = g;
+                record.job = job;
+                std::memcpy(&record.prefix, digests[job].data(), sizeof(uint64_t));
+            }
+        }
+    }
+
+    // By the digest first, the stable sort by the group keeps that order within it
+    std::vector<DigestRecord> buffer;
+    radixSort(records, buffer, [](const DigestRecord& r) {
+        return r.prefix;
+    });
+    radixSort(records, buffer, [](const DigestRecord& r) {
+        return static_cast<uint64_t>(r.group);
+    });
+
+    // Different digests with the same leading bytes are told apart by the rest
+    auto byDigest = [&digests](const DigestRecord& a, const DigestRecord& b) {
+        return digests[a.job] < digests[b.job];
+    };
+
+    for (size_t begin = 0; begin < records.size();)
+    {
+        size_t end = begin + 1;
+        bool mixed = false;
+
+        while (end < records.size() && records[end].group == records[begin].group &&
+               records[end].prefix == records[begin].prefix)
+        {
+            mixed = mixed || digests[records[end].job] != digests[records[begin].job];
+            ++end;
+        }
+
+        if (mixed)
+        {
+            std::stable_sort(records.begin() + static_cast<std::ptrdiff_t>(begin),
+                             records.begin() + static_cast<std::ptrdiff_t>(end),
+                             byDigest);
+        }
+        begin = end;
+    }
+
+    return records;
+}
+
+/**
+ * @brief Split groups of the same size files by the digest of the given stage and
+ * drop the files which have no pair anymore. The order of the groups is preserved.
+ * Groups for which the stage is not applicable are kept as they are. The digested
+ * files and the restored or known digests are counted by `stats`.
+ */
+Groups refine(Groups groups,
+              Stage stage,
+              const HashEngine& engine,
+              const Node::DigestFunction& sha256,
+              const Reading& reading,
+              const Known& known,
+              Checkpoints& checkpoints,
+              StageStats& stats,
+              const ProgressCallback& cb)
+{
+    Nodes jobs;
+    uint64_t totalBytes = 0;
+    std::vector<uint8_t> active(groups.size(), 0);
+
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        const Nodes& nodes = groups[g];
+
+        // The files with known digests have no fast digest of the whole content,
+        // their groups are confirmed by the SHA256 right away
+        if (stage == Stage::Calculate && !known.empty() &&
+            std::ranges::any_of(nodes, [&known](const Node* node) {
+                return known.contains(node);
+            }))
+        {
+            continue;
+        }
+
+        if (const auto bytes = stageBytes(stage, nodes.front()->size());
+            bytes > 0 || stage == Stage::Confirm)
+        {
+            active[g] = 1;
+            totalBytes += bytes * nodes.size();
+            jobs.insert(jobs.end(), nodes.begin(), nodes.end());
+        }
+    }
+
+    std::vector<Digest> digests(jobs.size());
+    std::vector<uint8_t> hashed(jobs.size(), 0);
+    uint64_t bytesRead = 0;
+
+    // Digests calculated before the detection was resumed are not calculated again
+    std::vector<size_t> pending;
+    Nodes pendingJobs;
+
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        const auto it = known.find(jobs[i]);
+        const auto* digest =
+            it != known.end() ? knownDigest(it->second, stage) : nullptr;
+
+        if (digest != nullptr)
+        {
+            digests[i] = *digest;
+        }
+
+        if (digest != nullptr || checkpoints.restore(jobs[i], digests[i]))
+        {
+            hashed[i] = 1;
+            bytesRead += stageBytes(stage, jobs[i]->size());
+            ++stats.cacheHits;
+            continue;
+        }
+
+        pending.push_back(i);
+        pendingJobs.push_back(jobs[i]);
+    }
+
+    stats.files += jobs.size();
+
+    auto workJob = [stage, &jobs, &sha256, &reading, &digests, &hashed](size_t i) {
+        hashed[i] = tryGetDigest(stage, jobs[i], sha256, reading, digests[i]) ? 1 : 0;
+    };
+
+    auto doneJob = [&, stage, totalBytes](size_t i) {
+        if (hashed[i] == 0)
+        {
+            return;
+        }
+
+        const Node* node = jobs[i];
+        checkpoints.digest(node, digests[i]);
+        bytesRead += stageBytes(stage, node->size());
+        cb(stage, node, totalBytes ? bytesRead * 100 / totalBytes : 100);
+    };
+
+    // The jobs with the given indices, reading the given nodes, run on the workers
+    auto runJobs = [&](const std::vector<size_t>& indices, const Nodes& nodes) {
+        auto work = [&workJob, &indices](size_t k) {
+            workJob(indices[k]);
+        };
+
+        auto done = [&doneJob, &indices](size_t k) {
+            doneJob(indices[k]);
+        };
+
+        if (reading.placement)
+        {
+            engine.run(indices.size(),
+                       deviceQueues(nodes, *reading.placement),
+                       work,
+                       done);
+        }
+        else
+        {
+            engine.run(indices.size(), work, done);
+        }
+    };
+
+    // The confirmation digests are memoized by the nodes and shared with the cache,
+    // they stay with the workers. So do the tree digests, which read in parallel,
+    // and the files of the devices which the workers read in their queues.
+    if (reading.uring && stage != Stage::Confirm)
+    {
+        std::vector<size_t> batch;
+        std::vector<size_t> queued;
+        Nodes queuedJobs;
+
+        for (const auto i : pending)
+        {
+            const bool tree =
+                stage == Stage::Calculate && treeDigested(reading, jobs[i]->size());
+
+            if (!tree && batched(jobs[i], reading.placement))
+            {
+                batch.push_back(i);
+            }
+            else
+            {
+                queued.push_back(i);
+                queuedJobs.push_back(jobs[i]);
+            }
+        }
+
+        digestBatch(stage,
+                    jobs,
+                    batch,
+                    *reading.uring,
+                    digests,
+                    hashed,
+                    [&doneJob, &batch](size_t k) {
+                        doneJob(batch[k]);
+                    });
+
+        runJobs(queued, queuedJobs);
+    }
+    else
+    {
+        runJobs(pending, pendingJobs);
+    }
+
+    const auto records = sortByDigest(groups, active, digests, hashed);
+    Groups refined;
+
+    // Files of the group with equal digests, as ranges of the records
+    std::vector<std::pair<size_t, size_t>> runs;
+    size_t r = 0;
+    size_t numFiles = 0;
+
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        Nodes& nodes = groups[g];
+
+        if (active[g] == 0)
+        {
+            numFiles += nodes.size();
+            refined.push_back(std::move(nodes));
+            continue;
+        }
+
+        // Here we have files with the same size, split them by digests. Files with
+        // unique digests are dropped.
+        runs.clear();
+
+        while (r < records.size() && records[r].group == g)
+        {
+            const auto& digest = digests[records[r].job];
+            size_t end = r + 1;
+
+            while (end < records.size() && records[end].group == g &&
+                   digests[records[end].job] == digest)
+            {
+                ++end;
+            }
+
+            if (end - r > 1)
+            {
+                runs.emplace_back(r, end);
+            }
+            r = end;
+        }
+
+        // The subgroups keep the order of their first files
+        std::ranges::sort(runs, {}, [&records](const auto& run) {
+            return records[run.first].job;
+        });
+
+        for (const auto& [begin, end] : runs)
+        {
+            auto& sub = refined.emplace_back();
+            sub.reserve(end - begin);
+
+            for (size_t k = begin; k < end; ++k)
+            {
+                sub.push_back(jobs[records[k].job]);
+            }
+            numFiles += sub.size();
+        }
+    }
+
+    spdlog::trace("Stage {}: {} files digested, {} read, {} files in {} groups left",
+                  stage2str(stage),
+                  jobs.size(),
+                  core::str::humanizeBytes(bytesRead),
+                  numFiles,
+                  refined.size());
+
+    return refined;
+}
+
+/**
+ * @brief SHA256 calculation, which consults the cache first when it is given. The
+ * digests found in the cache are counted by `hits`, large files get the tree digest.
+ *
+ * @throw std::invalid_argument if the cache has the tree digests from another size
+ */
+Node::DigestFunction sha256Function(HashCache* cache,
+                                    const Reading& reading,
+                                    std::atomic<size_t>& hits)
+{
+    if (cache != nullptr && cache->treeMinBytes() != reading.treeMinBytes)
+    {
+        throw std::invalid_argument(
+            std::format("The hash cache has tree digests of the files of {} bytes and "
+                        "more, the detection of the ones of {} bytes",
+                        cache->treeMinBytes(),
+                        reading.treeMinBytes));
+    }
+
+    return [cache, &reading, &hits](const fs::path& file) {
+        core::file::FileInfo info;
+        std::error_code ec;
+
+        // The size selects the kind of the digest. The metadata is taken before
+        // reading the file, a file modified in the meantime gets a cache entry which
+        // never matches.
+        const bool known = core::file::fileInfo(file, info, ec);
+        auto fileSha256 = [&reading, &info, &file]() {
+            return fullDigest(file,
+                              info.size,
+                              info.device,
+                              DigestType::Sha256,
+                              WHOLE_FILE,
+                              reading);
+        };
+
+        if (cache == nullptr || !known)
+        {
+            return fileSha256();
+        }
+
+        Digest digest {};
+        if (cache->lookup(info, digest))
+        {
+            ++hits;
+        }
+        else
+        {
+            digest = fileSha256();
+            cache->store(info, digest);
+        }
+
+        return digest;
+    };
+}
+
+/**
+ * @brief Create the io_uring reader, or nothing if it is not available
+ */
+std::unique_ptr<core::file::UringReader> uringReader(size_t bufferBytes)
+{
+    core::file::UringOptions opts;
+
+    if (bufferBytes != 0)
+    {
+        opts.bufferSize = bufferBytes;
+    }
+
+    try
+    {
+        return std::make_unique<core::file::UringReader>(opts);
+    }
+    catch (const std::system_error& se)
+    {
+        spdlog::warn("Continue with the threaded reads: {}", se.what());
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Take the groups with all files found in the cache out of `groups`. Their
+ * digests are already known, so the fast rounds can't save any reads for them. The
+ * files found in the cache are counted by `hits`.
+ */
+Groups takeCached(Groups& groups,
+                  const HashCache& cache,
+                  const HashEngine& engine,
+                  std::atomic<size_t>& hits)
+{
+    Nodes jobs;
+
+    for (const auto& nodes : groups)
+    {
+        jobs.insert(jobs.end(), nodes.begin(), nodes.end());
+    }
+
+    std::vector<uint8_t> cached(jobs.size(), 0);
+
+    engine.run(
+        jobs.size(),
+        [&cache, &jobs, &cached](size_t i) {
+            core::file::FileInfo info;
+            std::error_code ec;
+            Digest digest {};
+
+            if (core::file::fileInfo(jobs[i]->fullPath(), info, ec) &&
+                cache.lookup(info, digest))
+            {
+                jobs[i]->sha256([&digest](const fs::path&) {
+                    return digest;
+                });
+                cached[i] = 1;
+            }
+        },
+        [](size_t) {});
+
+    Groups resolved;
+    Groups pending;
+    size_t first = 0;
+    size_t found = 0;
+
+    for (auto& nodes : groups)
+    {
+        const auto begin = cached.begin() + static_cast<std::ptrdiff_t>(first);
+        const auto end = begin + static_cast<std::ptrdiff_t>(nodes.size());
+        const bool all = std::all_of(begin, end, [](uint8_t c) {
+            return c != 0;
+        });
+
+        found += static_cast<size_t>(std::count(begin, end, uint8_t {1}));
+        first += nodes.size();
+        (all ? resolved : pending).push_back(std::move(nodes));
+    }
+
+    spdlog::trace("Hash cache: {} of {} files found, {} groups resolved",
+                  found,
+                  jobs.size(),
+                  resolved.size());
+
+    hits += found;
+    groups = std::move(pending);
+    return resolved;
+}
+
+/**
+ * @brief Keep a single file of the hard links to the same data in `groups`, the
+ * other links are collected in `links` under the file that represents them. Groups
+ * left with less than two distinct files are dropped, no space can be freed there.
+ */
+Groups takeLinks(Groups groups, Links& links)
+{
+    std::unordered_map<FileId, const Node*, FileIdHash> seen;
+    Groups result;
+    size_t numLinks = 0;
+
+    for (auto& nodes : groups)
+    {
+        Nodes units;
+        seen.clear();
+
+        for (const auto* node : nodes)
+        {
+            const auto& id = node->id();
+
+            if (id.inode != 0)
+            {
+                const auto [it, inserted] = seen.emplace(id, node);
+                if (!inserted)
+                {
+                    links[it->second].push_back(node);
+                    ++numLinks;
+                    continue;
+                }
+            }
+
+            units.push_back(node);
+        }
+
+        if (units.size() > 1)
+        {
+            result.push_back(std::move(units));
+            continue;
+        }
+
+        for (const auto* node : units)
+        {
+            links.erase(node);
+        }
+    }
+
+    spdlog::trace("Hard links: {} files share the data of another file, {} of {} "
+                  "groups left",
+                  numLinks,
+                  result.size(),
+                  groups.size());
+
+    return result;
+}
+
+/**
+ * @brief Whether the node is one of the roots or is inside of them
+ */
+bool inside(const Node* node, const Nodes& roots)
+{
+    for (; node != nullptr; node = node->parent())
+    {
+        if (std::ranges::find(roots, node) != roots.end())
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Whether the files of the group, together with their hard links, belong to
+ * both the backup set under `backupRoots` and the source set
+ */
+bool crossing(const Nodes& nodes, const Links& links, const Nodes& backupRoots)
+{
+    bool source = false;
+    bool backup = false;
+
+    auto visit = [&](const Node* node) {
+        (inside(node, backupRoots) ? backup : source) = true;
+    };
+
+    for (const auto* node : nodes)
+    {
+        visit(node);
+
+        if (const auto it = links.find(node); it != links.end())
+        {
+            std::ranges::for_each(it->second, visit);
+        }
+    }
+
+    return source && backup;
+}
+
+/**
+ * @brief Drop the groups the filter doesn't accept, an empty filter accepts all
+ */
+void keepGroups(Groups& groups, const GroupFilter& keep)
+{
+    if (keep)
+    {
+        std::erase_if(groups, [&keep](const Nodes& nodes) {
+            return !keep(nodes);
+        });
+    }
+}
+
+/**
+ * @brief Node of the given path, nullptr if the tree has none
+ */
+const Node* findNode(const Node* root, const fs::path& path)
+{
+    const Node* node = root;
+
+    for (const auto& name : path)
+    {
+        // A trailing separator
+        if (name.empty())
+        {
+            continue;
+        }
+
+        const Node* found = nullptr;
+        node->enumChildren([&found, &name](const Node* child) {
+            if (found == nullptr && child->name() == name)
+            {
+                found = child;
+            }
+        });
+
+        if (found == nullptr)
+        {
+            return nullptr;
+        }
+        node = found;
+    }
+
+    return node;
+}
+
+/**
+ * @brief Append the files of the group to `entries`, marking the ones sharing the
+ * data with another file of the group, the ones of the backup set and the ones of
+ * the other hosts
+ */
+void appendEntries(const Nodes& nodes,
+                   const Nodes& backupRoots,
+                   const Known& known,
+                   std::vector<DupEntryView>& entries)
+{
+    std::unordered_map<FileId, size_t, FileIdHash> count;
+
+    for (const auto* node : nodes)
+    {
+        if (node->id().inode != 0)
+        {
+            ++count[node->id()];
+        }
+    }
+
+    for (const auto* node : nodes)
+    {
+        const auto& id = node->id();
+        entries.emplace_back(node,
+                             id.inode != 0 && count[id] > 1,
+                             nullptr,
+                             inside(node, backupRoots),
+                             known.contains(node));
+    }
+}
+
+bool lighter(const Nodes& a, const Nodes& b)
+{
+    return (a.front()->size() * a.size()) < (b.front()->size() * b.size());
+}
+
+/**
+ * @brief Files of a group being compared, which had equal content so far
+ */
+struct Subgroup
+{
+    std::vector<size_t> members;
+    core::crypto::Sha256Hasher hasher;
+};
+
+/**
+ * @brief Read the files of the group in lock-step and split the group as soon as
+ * the blocks differ. The first block is small, the following ones double up to the
+ * buffer size, so the files which differ early are barely read. A file stops being
+ * read once it has no pair anymore. The SHA256 of the equal files is calculated on
+ * the way, so they don't have to be read again.
+ */
+Groups compareGroup(const Nodes& nodes, size_t bufferBytes, HashCache* cache)
+{
+    const uint64_t size = nodes.front()->size();
+    const core::file::ReaderOptions readerOpts {
+        .bufferSize = bufferBytes != 0 ? bufferBytes
+                                       : core::file::ReaderOptions {}.bufferSize,
+    };
+
+    std::vector<std::optional<core::file::BlockReader>> files(nodes.size());
+    std::vector<core::file::FileInfo> infos(nodes.size());
+    std::vector<uint8_t> known(nodes.size(), 0);
+    std::vector<std::string_view> blocks(nodes.size());
+    std::vector<Subgroup> active(1);
+
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        const auto path = nodes[i]->fullPath();
+        std::error_code ec;
+
+        // Metadata is taken before reading, same as for the hashed files
+        known[i] = cache && core::file::fileInfo(path, infos[i], ec) ? 1 : 0;
+
+        try
+        {
+            files[i].emplace(path, readerOpts);
+        }
+        catch (const std::system_error& ex)
+        {
+            spdlog::error("{}", ex.what());
+            continue;
+        }
+
+        active.front().members.push_back(i);
+    }
+
+    const uint64_t maxBlock = readerOpts.bufferSize;
+    uint64_t blockSize = std::min(COMPARE_FIRST_BLOCK_BYTES, maxBlock);
+    uint64_t offset = 0;
+
+    while (offset < size && !active.empty())
+    {
+        const auto length = static_cast<size_t>(std::min(blockSize, size - offset));
+        std::vector<Subgroup> next;
+
+        for (auto& sub : active)
+        {
+            std::vector<std::vector<size_t>> parts;
+
+            for (const auto i : sub.members)
+            {
+                try
+                {
+                    blocks[i] = files[i]->read(offset, length);
+                }
+                catch (const std::system_error& ex)
+                {
+                    spdlog::error("{}", ex.what());
+                    continue;
+                }
+
+                if (blocks[i].size() != length)
+                {
+                    spdlog::error("Unable to read file: {}", nodes[i]->fullPath());
+                    continue;
+                }
+
+                auto it = std::ranges::find_if(parts, [&](const auto& part) {
+                    return std::memcmp(blocks[part.front()].data(),
+                                       blocks[i].data(),
+                                       length) == 0;
+                });
+
+                if (it == parts.end())
+                {
+                    parts.emplace_back();
+                    it = std::prev(parts.end());
+                }
+                it->push_back(i);
+            }
+
+            std::erase_if(parts, [](const auto& part) {
+                return part.size() < 2;
+            });
+
+            for (size_t p = 0; p < parts.size(); ++p)
+            {
+                const bool last = p + 1 == parts.size();
+                auto& split = next.emplace_back(
+                    std::move(parts[p]),
+                    last ? std::move(sub.hasher) : sub.hasher);
+                split.hasher.update({blocks[split.members.front()].data(), length});
+            }
+        }
+
+        active = std::move(next);
+        offset += length;
+        blockSize = std::min(blockSize * 2, maxBlock);
+    }
+
+    Groups equal;
+
+    for (auto& sub : active)
+    {
+        if (sub.members.size() < 2)
+        {
+            continue;
+        }
+
+        Digest digest {};
+        sub.hasher.final(digest);
+
+        auto& group = equal.emplace_back();
+        for (const auto i : sub.members)
+        {
+            nodes[i]->sha256([&digest](const fs::path&) {
+                return digest;
+            });
+
+            if (known[i])
+            {
+                cache->store(infos[i], digest);
+            }
+            group.push_back(nodes[i]);
+        }
+    }
+
+    return equal;
+}
+
+/**
+ * @brief Take the groups with at most `maxFiles` files without the tree digest out
+ * of `groups` and compare them in lock-step, the groups with files which can't be
+ * read are left. Returns the groups of files with equal content, the compared
+ * files are counted by `stats`.
+ */
+Groups compare(Groups& groups,
+               size_t maxFiles,
+               const Reading& reading,
+               const Known& known,
+               HashCache* cache,
+               const HashEngine& engine,
+               const Placement& placement,
+               StageStats& stats,
+               const ProgressCallback& cb)
+{
+    Groups small;
+    Groups large;
+    uint64_t totalBytes = 0;
+
+    for (auto& nodes : groups)
+    {
+        // The comparison gives the plain digest, the files with a tree one are hashed
+        const auto size = nodes.front()->size();
+        const bool tree = treeDigested(reading, size);
+        const bool readable = std::ranges::none_of(nodes, [&known](const Node* node) {
+            return known.contains(node);
+        });
+
+        if (nodes.size() <= maxFiles && !tree && readable)
+        {
+            totalBytes += size * nodes.size();
+            stats.files += nodes.size();
+            small.push_back(std::move(nodes));
+        }
+        else
+        {
+            large.push_back(std::move(nodes));
+        }
+    }
+
+    groups = std::move(large);
+
+    std::vector<Groups> results(small.size());
+    uint64_t bytesCompared = 0;
+
+    // The files of a group are usually on the same device
+    Nodes firstNodes;
+    for (const auto& nodes : small)
+    {
+        firstNodes.push_back(nodes.front());
+    }
+
+    engine.run(
+        small.size(),
+        deviceQueues(firstNodes, placement),
+        [cache, &reading, &small, &results](size_t i) {
+            try
+            {
+                results[i] = compareGroup(small[i], reading.bufferBytes, cache);
+            }
+            catch (const std::exception& e)
+            {
+                spdlog::error("std::exception: {}", e.what());
+            }
+        },
+        [&cb, &small, &bytesCompared, totalBytes](size_t i) {
+            const Nodes& nodes = small[i];
+            bytesCompared += nodes.front()->size() * nodes.size();
+
+            for (const auto* node : nodes)
+            {
+                cb(Stage::Compare,
+                   node,
+                   totalBytes ? bytesCompared * 100 / totalBytes : 100);
+            }
+        });
+
+    Groups equal;
+    for (auto& result : results)
+    {
+        equal.insert(equal.end(),
+                     std::make_move_iterator(result.begin()),
+                     std::make_move_iterator(result.end()));
+    }
+
+    spdlog::trace("Stage {}: {} groups compared, {} groups of equal files",
+                  stage2str(Stage::Compare),
+                  small.size(),
+                  equal.size());
+
+    return equal;
+}
+
+/**
+ * @brief What the rounds of a detection share
+ */
+struct Detection
+{
+    const Options& opts;
+    const HashEngine& engine;
+    const Node::DigestFunction& sha256;
+    const Reading& reading;
+
+    // Digests of the files which are not read
+    const Known& known;
+    Placement& placement;
+    Checkpoints& checkpoints;
+    DetectionStats& stats;
+
+    // Digests found in the hash cache so far
+    std::atomic<size_t>& cacheHits;
+
+    // Candidates it doesn't accept are dropped after every round
+    const GroupFilter& keep;
+    const ProgressCallback& cb;
+};
+
+/**
+ * @brief Run the rounds on the candidate groups of same size files. Returns the
+ * groups of files with equal content, their SHA256 is memoized by the nodes.
+ */
+Groups confirm(Groups groups, const Detection& d)
+{
+    Groups cached;
+    Groups compared;
+
+    {
+        const StageMeter meter(d.stats[Stage::Prepare], d.cacheHits);
+
+        if (d.opts.resume)
+        {
+            d.checkpoints.resume(*d.opts.resume, groups, compared);
+        }
+
+        // The groups of a later round already contain the cached files
+        if (d.opts.hashCache && !d.checkpoints.finished(Stage::Calculate))
+        {
+            cached = takeCached(groups, *d.opts.hashCache, d.engine, d.cacheHits);
+            keepGroups(cached, d.keep);
+        }
+
+        if (d.opts.physicalOrder)
+        {
+            d.placement.locations = locateFiles(groups, d.placement.devices);
+        }
+    }
+
+    // The candidates grouped by size are the starting point
+    if (!d.opts.resume)
+    {
+        d.checkpoints.round(Stage::Prepare, groups, cached, compared);
+    }
+
+    auto refineGroups = [&d, &groups](Stage stage) {
+        const StageMeter meter(d.stats[stage], d.cacheHits);
+        groups = refine(std::move(groups),
+                        stage,
+                        d.engine,
+                        d.sha256,
+                        d.reading,
+                        d.known,
+                        d.checkpoints,
+                        d.stats[stage],
+                        d.cb);
+        keepGroups(groups, d.keep);
+    };
+
+    for (const auto stage : {Stage::Head, Stage::Tail, Stage::Sample})
+    {
+        if (!d.checkpoints.finished(stage))
+        {
+            refineGroups(stage);
+            d.checkpoints.round(stage, groups, cached, compared);
+        }
+    }
+
+    // Small groups are cheaper to compare than to hash, most of them are pairs
+    if (!d.checkpoints.finished(Stage::Compare))
+    {
+        {
+            const StageMeter meter(d.stats[Stage::Compare], d.cacheHits);
+            compared = compare(groups,
+                               d.opts.compareMaxFiles,
+                               d.reading,
+                               d.known,
+                               d.opts.hashCache,
+                               d.engine,
+                               d.placement,
+                               d.stats[Stage::Compare],
+                               d.cb);
+            keepGroups(compared, d.keep);
+        }
+        d.checkpoints.round(Stage::Compare, groups, cached, compared);
+    }
+
+    if (!d.checkpoints.finished(Stage::Calculate))
+    {
+        refineGroups(Stage::Calculate);
+
+        if (!cached.empty())
+        {
+            groups.insert(groups.end(),
+                          std::make_move_iterator(cached.begin()),
+                          std::make_move_iterator(cached.end()));
+            std::ranges::stable_sort(groups, lighter);
+            cached.clear();
+        }
+        d.checkpoints.round(Stage::Calculate, groups, cached, compared);
+    }
+
+    // The fast digest can collide, the reported groups are confirmed by SHA256. The
+    // last state has all of them, resuming a finished detection reads nothing.
+    refineGroups(Stage::Confirm);
+    d.checkpoints.flush();
+    groups.insert(groups.end(),
+                  std::make_move_iterator(compared.begin()),
+                  std::make_move_iterator(compared.end()));
+
+    return groups;
+}
+
+/**
+ * @brief The files of the group followed by the hard links to their data, the links
+ * share the digest of the file they represent
+ */
+Nodes withLinks(const Nodes& nodes, const Links& links)
+{
+    Nodes all;
+
+    for (const auto* node : nodes)
+    {
+        all.push_back(node);
+
+        const auto it = links.find(node);
+        if (it == links.end())
+        {
+            continue;
+        }
+
+        const auto& digest = node->sha256();
+        for (const auto* link : it->second)
+        {
+            link->sha256([&digest](const fs::path&) {
+                return digest;
+            });
+            all.push_back(link);
+        }
+    }
+
+    return all;
+}
+
+/**
+ * @brief Copy the group, the entries of `group` are reused
+ */
+void fillGroup(const DupGroupView& view, DupGroup& group)
+{
+    group.groupId = view.groupId;
+    group.entires.resize(view.entries.size());
+
+    for (size_t i = 0; i < view.entries.size(); ++i)
+    {
+        const auto& src = view.entries[i];
+        auto& dst = group.entires[i];
+
+        src.file(dst.file);
+        dst.size = src.size();
+        dst.sha256 = src.sha256();
+        dst.link = src.link();
+        dst.directory = src.directory();
+        dst.backup = src.backup();
+        dst.remote = src.remote();
+    }
+}
+
+/**
+ * @brief Directory with a known digest of its content
+ */
+struct DirDigest
+{
+    Digest digest {};
+    const Node* node {nullptr};
+
+    // Nodes of the subtree, an ancestor always has more of them
+    size_t nodes {};
+};
+
+/**
+ * @brief Directory nodes holding the given directories, each one is the deepest node
+ * on the path of the directory. The ones whose files were all left out have no node.
+ */
+std::unordered_set<const Node*> dirNodes(const Node* root,
+                                         const std::set<fs::path>& dirs)
+{
+    std::unordered_set<const Node*> found;
+
+    if (dirs.empty())
+    {
+        return found;
+    }
+
+    std::unordered_map<fs::path::string_type, const Node*> byPath;
+    fs::path path;
+
+    root->enumNodes([&byPath, &path](const Node* node) {
+        if (!node->leaf())
+        {
+            node->fullPath(path);
+            byPath.emplace(path.native(), node);
+        }
+    });
+
+    for (const auto& dir : dirs)
+    {
+        for (auto p = dir; !p.empty(); p = p.parent_path())
+        {
+            if (const auto it = byPath.find(p.native()); it != byPath.end())
+            {
+                found.insert(it->second);
+                break;
+            }
+
+            if (p == p.parent_path())
+            {
+                break;
+            }
+        }
+    }
+
+    return found;
+}
+
+/**
+ * @brief Digest of the node, computed bottom up like a Merkle tree. A file has one if
+ * it belongs to a group, a directory if all of its children have one and the scan
+ * left nothing of it out. The digest of a directory covers the names, kinds, sizes
+ * and digests of its children in the order of their names. The directories with a
+ * digest are appended to `dirs`.
+ */
+std::optional<Digest> merkleDigest(const Node* node,
+                                   const std::unordered_set<const Node*>& grouped,
+                                   const std::unordered_set<const Node*>& incomplete,
+                                   std::vector<DirDigest>& dirs,
+                                   size_t& nodes)
+{
+    nodes = 1;
+
+    if (node->leaf())
+    {
+        return grouped.contains(node) ? std::optional(node->sha256()) : std::nullopt;
+    }
+
+    struct Child
+    {
+        fs::path name;
+        const Node* node {nullptr};
+        Digest digest {};
+    };
+
+    // All the children are visited, their subdirectories may be equal to others
+    std::vector<Child> children;
+    bool complete = !incomplete.contains(node);
+
+    node->enumChildren([&](const Node* child) {
+        size_t childNodes = 0;
+        const auto digest = merkleDigest(child, grouped, incomplete, dirs, childNodes);
+        nodes += childNodes;
+
+        if (!digest)
+        {
+            complete = false;
+            return;
+        }
+
+        children.push_back({child->name(), child, *digest});
+    });
+
+    if (!complete)
     {
-        spdlog::error("std::system_error: {}", se.what());
+        return std::nullopt;
     }
-    catch (const std::exception& e)
+
+    std::ranges::sort(children, {}, [](const Child& child) -> const auto& {
+        return child.name.native();
+    });
+
+    using Char = fs::path::value_type;
+    core::crypto::DigestHasher hasher(DigestType::Sha256);
+
+    for (const auto& child : children)
     {
-        spdlog::error("std::exception: {}", e.what());
+        // The name along with its terminator
+        const auto& name = child.name.native();
+        const char kind = child.node->leaf() ? 'f' : 'd';
+        const auto size = static_cast<uint64_t>(child.node->size());
+
+        hasher.update({reinterpret_cast<const char*>(name.c_str()),
+                       (name.size() + 1) * sizeof(Char)});
+        hasher.update({&kind, 1});
+        hasher.update({reinterpret_cast<const char*>(&size), sizeof(size)});
+        hasher.update({reinterpret_cast<const char*>(child.digest.data()),
+                       child.digest.size()});
     }
 
-    return false;
+    auto& dir = dirs.emplace_back();
+    hasher.final(dir.digest);
+    dir.node = node;
+    dir.nodes = nodes;
+
+    return dir.digest;
 }
+
 } // namespace
 
 const ProgressCallback& defaultProgressCallback =
     [](const Stage, const Node*, size_t) {};
 
+DupEntryView::DupEntryView(const Node* node,
+                           bool link,
+                           const core::crypto::Digest* digest,
+                           bool backup,
+                           bool remote) noexcept
+    : node_ {node}
+    , digest_ {digest}
+    , link_ {link}
+    , backup_ {backup}
+    , remote_ {remote}
+{
+}
+
+const Node* DupEntryView::node() const noexcept
+{
+    return node_;
+}
+
+size_t DupEntryView::size() const noexcept
+{
+    return node_->size();
+}
+
+const core::crypto::Digest& DupEntryView::sha256() const
+{
+    return digest_ != nullptr ? *digest_ : node_->sha256();
+}
+
+bool DupEntryView::link() const noexcept
+{
+    return link_;
+}
+
+bool DupEntryView::directory() const noexcept
+{
+    return digest_ != nullptr;
+}
+
+bool DupEntryView::backup() const noexcept
+{
+    return backup_;
+}
+
+bool DupEntryView::remote() const noexcept
+{
+    return remote_;
+}
+
+fs::path DupEntryView::file() const
+{
+    return node_->fullPath();
+}
+
+void DupEntryView::file(fs::path& path) const
+{
+    node_->fullPath(path);
+}
+
 DuplicateDetector::DuplicateDetector()
 {
     reset();
@@ -37,30 +2145,93 @@ DuplicateDetector::DuplicateDetector()
 
 void DuplicateDetector::addFile(const fs::path& path)
 {
-    Node* node = root_.get();
+    addFile(path, {});
+}
+
+void DuplicateDetector::addFile(const fs::path& path, const FileMeta& meta)
+{
+    Node* node = &tree_->root();
 
     for (const auto& p : path)
     {
-        auto [it, _] = names_.insert(p);
-        node = node->addChild(*it);
+        node = node->addChild(p);
+    }
+
+    node->setId(meta.id);
+    node->setMtime(meta.mtime);
+
+    if (meta.digests)
+    {
+        known_.insert_or_assign(node, *meta.digests);
+        node->sha256([&meta](const fs::path&) {
+            return meta.digests->sha256;
+        });
+    }
+
+    if (meta.size)
+    {
+        node->setSize(*meta.size);
+    }
+    else
+    {
+        ++unsizedFiles_;
     }
 }
 
+void DuplicateDetector::addIncompleteDir(const fs::path& dir)
+{
+    incompleteDirs_.insert(dir);
+}
+
+const std::set<fs::path>& DuplicateDetector::incompleteDirs() const noexcept
+{
+    return incompleteDirs_;
+}
+
 size_t DuplicateDetector::numFiles() const noexcept
 {
-    return !root_->leaf() ? root_->leafsCount() : 0;
+    return !tree_->root().leaf() ? tree_->root().leafsCount() : 0;
 }
 
 size_t DuplicateDetector::numGroups() const noexcept
 {
-    return grps_.size();
+    return groups_.size();
 }
 
 void DuplicateDetector::detect(const Options& opts, const ProgressCallback& cb)
 {
-    dups_.clear();
-    grps_.clear();
+    entries_.clear();
+    ranges_.clear();
+    groups_.clear();
+    stats_ = {};
+    dirDigests_.clear();
+    backupRoots_.clear();
+
+    for (const auto& dir : opts.backupDirs)
+    {
+        if (const auto* node = findNode(&tree_->root(), dir))
+        {
+            backupRoots_.push_back(node);
+        }
+        else
+        {
+            spdlog::warn("No files of the backup directory: '{}'", dir);
+        }
+    }
+
+    detectGroups(opts, cb);
+
+    // The streamed groups can't be taken back
+    if (opts.directoryGroups && !opts.onGroup)
+    {
+        groupDirectories(!opts.backupDirs.empty());
+    }
+
+    sortGroups();
+}
 
+void DuplicateDetector::detectGroups(const Options& opts, const ProgressCallback& cb)
+{
     size_t totalFiles = numFiles();
 
     if (totalFiles == 0)
@@ -68,152 +2239,466 @@ void DuplicateDetector::detect(const Options& opts, const ProgressCallback& cb)
         return;
     }
 
-    root_->update([i = 0UL, totalFiles, &cb](const Node* node) mutable {
-        cb(Stage::Prepare, node, ++i * 100 / totalFiles);
-    });
+    std::atomic<size_t> cacheHits {0};
+    std::optional<StageMeter> prepare;
+    prepare.emplace(stats_[Stage::Prepare], cacheHits);
+    stats_[Stage::Prepare].files = totalFiles;
+
+    // The sizes are queried only if the scan didn't provide all of them
+    if (unsizedFiles_ > 0)
+    {
+        tree_->root().update([i = 0UL, totalFiles, &cb](const Node* node) mutable {
+            cb(Stage::Prepare, node, ++i * 100 / totalFiles);
+        });
+    }
+
+    // The largest files first, the files of the same size in the order of the tree
+    std::vector<SizedNode> sized;
+    sized.reserve(totalFiles);
 
-    root_->enumLeafs([&opts, this](Node* node) {
+    tree_->root().enumLeafs([&opts, &sized](Node* node) {
         if (node->size() < opts.minSizeBytes || node->size() > opts.maxSizeBytes)
         {
             return;
         }
 
-        auto it = dups_.find(node->size());
+        sized.push_back({node->size(), node});
+    });
+
+    {
+        std::vector<SizedNode> buffer;
+        radixSort(sized, buffer, [](const SizedNode& sn) {
+            return ~static_cast<uint64_t>(sn.size);
+        });
+    }
+
+    // Files with unique size can be quickly excluded
+    Groups groups;
 
-        if (it == dups_.end())
+    for (size_t begin = 0; begin < sized.size();)
+    {
+        size_t end = begin + 1;
+        while (end < sized.size() && sized[end].size == sized[begin].size)
         {
-            dups_.emplace(node->size(), Nodes {node});
+            ++end;
         }
-        else
+
+        if (end - begin > 1)
         {
-            it->second.push_back(node);
+            auto& nodes = groups.emplace_back();
+            nodes.reserve(end - begin);
+
+            for (size_t i = begin; i < end; ++i)
+            {
+                nodes.push_back(sized[i].node);
+            }
         }
-    });
+        begin = end;
+    }
 
-    // Files with unique size can be quickly excluded
-    size_t numUniqueFiles = 0;
-    size_t outstandingSize = 0;
+    sized = {};
+
+    // Hard links to the same data are read only once
+    Links links;
+    groups = takeLinks(std::move(groups), links);
+
+    // Only the copies across the sets matter, none of the other files is read. The
+    // groups of the files of other hosts alone can't be acted upon.
+    GroupFilter keep;
+    const bool crossSets = !opts.backupDirs.empty();
+
+    if (crossSets || !known_.empty())
+    {
+        keep = [this, &links, crossSets](const Nodes& nodes) {
+            return local(nodes, known_) &&
+                   (!crossSets || crossing(nodes, links, backupRoots_));
+        };
+
+        const auto buckets = groups.size();
+        keepGroups(groups, keep);
+        spdlog::trace("Candidates: {} of {} groups have the wanted files",
+                      groups.size(),
+                      buckets);
+    }
+
+    // Weight based soring to have a smooter progress during detection
+    std::ranges::stable_sort(groups, lighter);
 
-    std::erase_if(dups_, [&numUniqueFiles, &outstandingSize](const auto& vt) {
-        const Nodes& nodes = vt.second;
-        if (nodes.size() < 2)
+    const HashEngine engine(opts.hashWorkers);
+    std::unique_ptr<core::file::UringReader> uring;
+
+    if (opts.readBackend == ReadBackend::IoUring)
+    {
+        uring = uringReader(opts.readBufferBytes);
+    }
+
+    Placement placement {
+        .devices = probeDevices(groups, opts.hddWorkers, opts.ssdWorkers),
+    };
+    const Reading reading {
+        .bufferBytes = opts.readBufferBytes,
+        .uring = uring.get(),
+        .placement = &placement,
+        .treeMinBytes = opts.treeHashMinBytes,
+        .engine = &engine,
+    };
+    const auto sha256 = sha256Function(opts.hashCache, reading, cacheHits);
+    prepare.reset();
+
+    if (!opts.onGroup)
+    {
+        Checkpoints checkpoints(opts, tree_->root());
+        const Detection detection {opts,
+                                   engine,
+                                   sha256,
+                                   reading,
+                                   known_,
+                                   placement,
+                                   checkpoints,
+                                   stats_,
+                                   cacheHits,
+                                   keep,
+                                   cb};
+
+        for (const auto& nodes : confirm(std::move(groups), detection))
         {
-            ++numUniqueFiles;
-            return true;
+            addGroup(withLinks(nodes, links));
         }
-        outstandingSize += nodes.size() * nodes[0]->size();
-        return false;
-    });
+        return;
+    }
 
-    totalFiles -= numUniqueFiles;
-    size_t processedSize = 0;
+    // The buckets are detected in batches, the groups of a batch are handed over as
+    // soon as it is finished. The state of a batch is of no use to the next one.
+    Options batchOpts = opts;
+    batchOpts.checkpoint = {};
+    batchOpts.resume = nullptr;
 
-    std::vector<std::pair<size_t, Nodes>> ordered;
+    DupGroup copy;
+    size_t first = 0;
 
-    for (auto& [sz, nodes] : dups_)
+    while (first < groups.size())
     {
-        ordered.emplace_back(sz, nodes);
-    }
+        // Whole size buckets with enough files to keep the workers busy
+        size_t last = first;
+        size_t batchFiles = 0;
 
-    // Weight based soring to have a smooter progress during detection
-    std::ranges::sort(ordered, [](const auto& a, const auto& b) {
-        return (a.first * a.second.size()) < (b.first * b.second.size());
-    });
+        while (last < groups.size() && batchFiles < STREAM_BATCH_FILES)
+        {
+            batchFiles += groups[last++].size();
+        }
 
-    std::unordered_map<std::string, Nodes> hashes;
-    std::string sha256;
+        const auto begin = groups.begin() + static_cast<std::ptrdiff_t>(first);
+        const auto end = groups.begin() + static_cast<std::ptrdiff_t>(last);
+        Groups batch(std::make_move_iterator(begin), std::make_move_iterator(end));
+        first = last;
 
-    std::erase_if(
-        ordered,
-        [&cb, &processedSize, &hashes, &sha256, outstandingSize](auto& vt) mutable {
-            hashes.clear();
-            sha256.clear();
+        Checkpoints checkpoints(batchOpts, tree_->root());
+        const Detection detection {batchOpts,
+                                   engine,
+                                   sha256,
+                                   reading,
+                                   known_,
+                                   placement,
+                                   checkpoints,
+                                   stats_,
+                                   cacheHits,
+                                   keep,
+                                   cb};
 
-            // Here we have files with the same size
-            Nodes& nodes = vt.second;
-            for (const auto* node : nodes)
+        for (const auto& nodes : confirm(std::move(batch), detection))
+        {
+            fillGroup(addGroup(withLinks(nodes, links)), copy);
+
+            if (!opts.onGroup(copy))
             {
-                if (!tryGetSha256(node, sha256))
-                {
-                    continue;
-                }
+                spdlog::info("Detection stopped after {} groups", ranges_.size());
+                return;
+            }
+        }
+    }
+}
 
-                auto it = hashes.find(sha256);
-                processedSize += node->size();
-                const auto percent = processedSize * 100 / outstandingSize;
-                cb(Stage::Calculate, node, percent);
+DupGroupView DuplicateDetector::addGroup(const Nodes& nodes)
+{
+    const auto first = entries_.size();
+    appendEntries(nodes, backupRoots_, known_, entries_);
+    ranges_.emplace_back(first, nodes.size());
 
-                if (it == hashes.end())
-                {
-                    hashes.emplace(sha256, Nodes {node});
-                }
-                else
-                {
-                    it->second.push_back(node);
-                }
-            }
+    // Valid until the next group is added
+    return {
+        .groupId = ranges_.size(),
+        .entries = std::span(entries_).subspan(first, nodes.size()),
+    };
+}
 
-            // Remove all unique items
-            std::erase_if(hashes, [](const auto& vt) {
-                return vt.second.size() < 2;
-            });
+void DuplicateDetector::groupDirectories(bool crossSets)
+{
+    std::unordered_set<const Node*> grouped;
+    grouped.reserve(entries_.size());
+
+    for (const auto& e : entries_)
+    {
+        grouped.insert(e.node());
+    }
+
+    const auto incomplete = dirNodes(&tree_->root(), incompleteDirs_);
+    std::vector<DirDigest> dirs;
+    size_t nodes = 0;
+    merkleDigest(&tree_->root(), grouped, incomplete, dirs, nodes);
+
+    // Runs of equal directories, the ones of the largest subtrees first so that a
+    // directory is decided before its subdirectories
+    std::ranges::stable_sort(dirs, {}, &DirDigest::digest);
+    std::vector<std::pair<size_t, size_t>> runs;
+
+    for (size_t begin = 0; begin < dirs.size();)
+    {
+        size_t end = begin + 1;
+        while (end < dirs.size() && dirs[end].digest == dirs[begin].digest)
+        {
+            ++end;
+        }
+
+        if (end - begin > 1)
+        {
+            runs.emplace_back(begin, end);
+        }
+        begin = end;
+    }
+
+    std::ranges::stable_sort(runs, std::greater<> {}, [&dirs](const auto& run) {
+        return dirs[run.first].nodes;
+    });
 
-            if (hashes.empty())
+    // The copies inside a reported directory are represented by it
+    std::unordered_set<const Node*> reported;
+    const auto hidden = [&reported](const Node* node) {
+        for (const auto* p = node->parent(); p != nullptr; p = p->parent())
+        {
+            if (reported.contains(p))
             {
-                // Instruct to remove the current Node object
                 return true;
             }
+        }
+        return false;
+    };
 
-            // Remove files with unique hashes
-            auto it = std::remove_if(std::begin(nodes),
-                                     std::end(nodes),
-                                     [&hashes](const Node* const node) {
-                                         return !hashes.contains(node->sha256());
-                                     });
+    // Members of the group outside the reported directories. A single one is
+    // paired with a copy inside them, it would go unreported otherwise.
+    const auto select = [&hidden](auto&& nodes) {
+        Nodes members;
+        const Node* copy = nullptr;
 
-            nodes.erase(it, nodes.end());
+        for (const Node* node : nodes)
+        {
+            if (!hidden(node))
+            {
+                members.push_back(node);
+            }
+            else if (copy == nullptr)
+            {
+                copy = node;
+            }
+        }
 
-            return false;
-        });
+        if (members.size() == 1 && copy != nullptr)
+        {
+            members.push_back(copy);
+        }
+
+        return members;
+    };
+
+    // Across the sets only the groups of both sets are reported
+    const auto wanted = [crossSets, this](const Nodes& members) {
+        return members.size() > 1 && local(members, known_) &&
+               (!crossSets || crossing(members, Links {}, backupRoots_));
+    };
+
+    std::vector<std::pair<size_t, Nodes>> dirGroups;
+
+    for (const auto& [begin, end] : runs)
+    {
+        auto members = select(std::span(dirs).subspan(begin, end - begin) |
+                              std::views::transform(&DirDigest::node));
+
+        if (wanted(members))
+        {
+            reported.insert(members.begin(), members.end());
+            dirGroups.emplace_back(begin, std::move(members));
+        }
+    }
+
+    if (dirGroups.empty())
+    {
+        return;
+    }
+
+    // The files inside the reported directories leave their groups, the links are
+    // marked anew among the remaining files
+    std::vector<DupEntryView> entries;
+    std::vector<std::pair<size_t, size_t>> ranges;
+
+    for (const auto& [first, count] : ranges_)
+    {
+        const auto members = select(std::span(entries_).subspan(first, count) |
+                                    std::views::transform(&DupEntryView::node));
+
+        if (wanted(members))
+        {
+            ranges.emplace_back(entries.size(), members.size());
+            appendEntries(members, backupRoots_, known_, entries);
+        }
+    }
+
+    // The entries point to the digests, they must not move
+    dirDigests_.reserve(dirGroups.size());
 
-    if (ordered.size() != dups_.size())
+    for (const auto& [dir, members] : dirGroups)
     {
-        // Build a set of sizes that survived in ordered
-        std::unordered_set<size_t> surviving;
-        for (const auto& [sz, nodes] : ordered)
+        const auto& digest = dirDigests_.emplace_back(dirs[dir].digest);
+        ranges.emplace_back(entries.size(), members.size());
+
+        for (const auto* member : members)
         {
-            surviving.insert(sz);
+            const auto backup = inside(member, backupRoots_);
+            entries.emplace_back(member,
+                                 false,
+                                 &digest,
+                                 backup,
+                                 isKnown(member, known_));
         }
+    }
+
+    spdlog::debug("Directories: {} groups, {} groups of files left",
+                  dirGroups.size(),
+                  ranges.size() - dirGroups.size());
+
+    entries_ = std::move(entries);
+    ranges_ = std::move(ranges);
+}
+
+void DuplicateDetector::sortGroups()
+{
+    // The groups of the largest files first, the same size ones in the order of their
+    // detection
+    std::ranges::stable_sort(ranges_, std::greater<> {}, [this](const auto& range) {
+        return entries_[range.first].size();
+    });
+
+    groups_.clear();
+    groups_.reserve(ranges_.size());
+
+    for (const auto& [first, count] : ranges_)
+    {
+        ++stats_.groupSizes[count];
+        groups_.push_back({
+            .groupId = groups_.size() + 1,
+            .entries = std::span(entries_).subspan(first, count),
+        });
+    }
+}
+
+const DetectionStats& DuplicateDetector::stats() const noexcept
+{
+    return stats_;
+}
+
+void DuplicateDetector::digestFiles(const Options& opts,
+                                    const FileDigestsCallback& cb,
+                                    const ProgressCallback& progress) const
+{
+    Nodes files;
 
-        // Remove from dups_ any size group not in ordered
-        std::erase_if(dups_, [&surviving](const auto& pair) {
-            return !surviving.contains(pair.first);
+    if (numFiles() > 0)
+    {
+        tree_->root().enumLeafs([this, &files](const Node* node) {
+            if (!known_.contains(node))
+            {
+                files.push_back(node);
+            }
         });
     }
 
-    for (const auto& [sz, nodes] : dups_)
+    const HashEngine engine(opts.hashWorkers);
+    const Groups groups {files};
+    Placement placement {
+        .devices = probeDevices(groups, opts.hddWorkers, opts.ssdWorkers),
+    };
+
+    if (opts.physicalOrder)
     {
-        for (const auto* node : nodes)
+        placement.locations = locateFiles(groups, placement.devices);
+    }
+
+    const Reading reading {
+        .bufferBytes = opts.readBufferBytes,
+        .placement = &placement,
+        .treeMinBytes = opts.treeHashMinBytes,
+        .engine = &engine,
+    };
+    std::atomic<size_t> cacheHits {0};
+    const auto sha256 = sha256Function(opts.hashCache, reading, cacheHits);
+
+    std::vector<std::optional<FileDigests>> digests(files.size());
+    size_t numDigested = 0;
+
+    engine.run(
+        files.size(),
+        deviceQueues(files, placement),
+        [&files, &sha256, &reading, &digests](size_t i) {
+            try
+            {
+                digests[i] = fileDigests(files[i], sha256, reading);
+            }
+            catch (const std::exception& e)
+            {
+                spdlog::error("std::exception: {}", e.what());
+            }
+        },
+        [&files, &progress, &numDigested](size_t i) {
+            progress(Stage::Confirm, files[i], ++numDigested * 100 / files.size());
+        });
+
+    size_t numFailed = 0;
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (digests[i])
+        {
+            cb(files[i], *digests[i]);
+        }
+        else
         {
-            grps_[node->sha256()].push_back(node);
+            ++numFailed;
         }
     }
+
+    spdlog::trace("Digested {} files, {} unreadable, {} SHA256 from the hash cache",
+                  files.size() - numFailed,
+                  numFailed,
+                  cacheHits.load());
 }
 
 void DuplicateDetector::reset()
 {
-    grps_.clear();
-    dups_.clear();
-    names_.clear();
-    names_.emplace();
-    root_ = std::make_unique<Node>(&(*names_.begin()));
+    entries_.clear();
+    ranges_.clear();
+    groups_.clear();
+    stats_ = {};
+    dirDigests_.clear();
+    backupRoots_.clear();
+    known_.clear();
+    incompleteDirs_.clear();
+    tree_ = std::make_unique<NodeTree>();
+    unsizedFiles_ = 0;
 }
 
 void DuplicateDetector::enumFiles(const FileCallback& cb) const
 {
     fs::path p;
 
-    root_->enumLeafs([&p, cb](const Node* const node) {
+    tree_->root().enumLeafs([&p, cb](const Node* const node) {
         node->fullPath(p);
         cb(p);
     });
@@ -222,51 +2707,27 @@ void DuplicateDetector::enumFiles(const FileCallback& cb) const
 void DuplicateDetector::enumGroups(const DupGroupCallback& cb) const
 {
     DupGroup group;
-    size_t duplicates = 0;
-    std::unordered_set<std::string_view> visit;
 
-    for (const auto& [sz, nodes] : dups_)
+    for (const auto& view : groups_)
     {
-        visit.clear();
-        for (const auto* i : nodes)
-        {
-            visit.insert(i->sha256());
-        }
+        fillGroup(view, group);
 
-        for (const auto& sha : visit)
+        // Stop enumeration if the callback returns false
+        if (!cb(group))
         {
-            group.groupId = ++duplicates;
-            group.entires.clear();
-
-            const auto it = grps_.find(sha);
-            if (it == grps_.end())
-            {
-                continue;
-            }
-
-            const Nodes& nodesInGroup = it->second;
-            for (const auto* i : nodesInGroup)
-            {
-                group.entires.emplace_back();
-                DupEntry& e = group.entires.back();
-
-                i->fullPath(e.file);
-                e.size = i->size();
-                e.sha256 = i->sha256();
-            }
-
-            // Stop enumeration if the callback returns false
-            if (!cb(group))
-            {
-                return;
-            }
+            return;
         }
     }
 }
 
+std::span<const DupGroupView> DuplicateDetector::groups() const noexcept
+{
+    return groups_;
+}
+
 const Node* DuplicateDetector::root() const
 {
-    return root_.get();
+    return &tree_->root();
 }
 
 } // namespace tools::dups
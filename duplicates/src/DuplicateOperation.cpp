@@ -1,13 +1,312 @@
 
 #include <duplicates/DuplicateOperation.h>
 #include <duplicates/DuplicateDetector.h>
+#include <duplicates/Checkpoint.h>
+#include <duplicates/GroupStream.h>
+#include <duplicates/HashCache.h>
+#include <duplicates/Manifest.h>
 #include <duplicates/Utils.h>
+#include <core/utils/DirWalker.h>
 #include <core/utils/FmtExt.h>
+#include <core/utils/Str.h>
+#include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
+#include <chrono>
+#include <format>
 #include <fstream>
+#include <memory>
+#include <optional>
+#include <span>
 #include <algorithm>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace tools::dups {
+namespace {
+
+// Groups detected ahead of the review
+constexpr size_t STREAM_CAPACITY = 64;
+
+/**
+ * @brief Checkpoint of the detection in the cache directory. The fingerprint covers
+ * all the settings the list of the scanned files and their digests depend on.
+ */
+std::optional<Checkpoint> openCheckpoint(const Config& cfg)
+{
+    core::crypto::DigestHasher hasher(core::crypto::DigestType::Fast128);
+    auto add = [&hasher](const std::string& value) {
+        // Terminated, so that the values can't be confused with their concatenation
+        hasher.update({value.c_str(), value.size() + 1});
+    };
+
+    for (const auto& scanDir : cfg.scanDirs())
+    {
+        add(core::file::path2s(scanDir.lexically_normal()));
+    }
+
+    add("|");
+    for (const auto& backupDir : cfg.backupDirs())
+    {
+        add(core::file::path2s(backupDir));
+    }
+
+    // The files of the manifests are detected after the scanned ones
+    add("|");
+    for (const auto& manifest : cfg.manifests())
+    {
+        add(core::file::path2s(manifest));
+    }
+
+    add("|");
+    for (const auto& pattern : cfg.exclusionPatterns())
+    {
+        add(pattern);
+    }
+
+    add(std::to_string(cfg.minFileSizeBytes()));
+    add(std::to_string(cfg.maxFileSizeBytes()));
+
+    // The restored digests of the large files are tree digests from that size
+    add(std::to_string(cfg.treeHashMinBytes()));
+
+    Checkpoint::Fingerprint fingerprint {};
+    hasher.final(fingerprint);
+
+    try
+    {
+        return std::make_optional<Checkpoint>(cfg.cacheDir() / "checkpoint",
+                                              fingerprint);
+    }
+    catch (const std::exception& ex)
+    {
+        spdlog::warn("Continue without the checkpoint: {}", ex.what());
+    }
+
+    return std::nullopt;
+}
+
+double toSeconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+/**
+ * @brief Log the cost of every stage which ran, followed by the sizes of the groups
+ */
+void logStats(const DetectionStats& stats)
+{
+    for (size_t i = 0; i < NUM_STAGES; ++i)
+    {
+        const auto stage = static_cast<Stage>(i);
+        const auto& st = stats[stage];
+
+        if (st.files == 0 && st.bytes == 0)
+        {
+            continue;
+        }
+
+        spdlog::info("Stage {:<9}: {:.3f} s wall, {:.3f} s cpu, {} files, {} read, "
+                     "{} opens, {} reads, {} cache hits",
+                     stage2str(stage),
+                     toSeconds(st.wall),
+                     toSeconds(st.cpu),
+                     st.files,
+                     core::str::humanizeBytes(st.bytes),
+                     st.opens,
+                     st.reads,
+                     st.cacheHits);
+    }
+
+    for (const auto& [files, groups] : stats.groupSizes)
+    {
+        spdlog::info("Groups of {} files: {}", files, groups);
+    }
+}
+
+/**
+ * @brief Hash cache in the cache directory, null if it is disabled or can't be opened
+ */
+std::unique_ptr<HashCache> openHashCache(const Config& cfg)
+{
+    if (cfg.hashCache())
+    {
+        try
+        {
+            return std::make_unique<HashCache>(cfg.cacheDir() / "digests",
+                                               cfg.treeHashMinBytes());
+        }
+        catch (const std::exception& ex)
+        {
+            spdlog::warn("Continue without the hash cache: {}", ex.what());
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief Run the detection configured by `cfg`, the groups are handed to `onGroup`
+ * as they are confirmed if it is given
+ */
+void detect(const Config& cfg,
+            DuplicateDetector& detector,
+            Progress& progress,
+            const DupGroupCallback& onGroup)
+{
+    StopWatch sw;
+    const auto cache = openHashCache(cfg);
+
+    // The streamed detection can't be resumed
+    auto checkpoint = onGroup ? std::nullopt : openCheckpoint(cfg);
+    const auto numFiles = detector.numFiles();
+    DetectionState state;
+    CheckpointCallback saveState;
+
+    const bool resume =
+        cfg.resume() && checkpoint && checkpoint->loadState(detector, state);
+
+    if (checkpoint && cfg.checkpointInterval().count() > 0)
+    {
+        saveState = [&checkpoint, numFiles](const DetectionState& current) {
+            try
+            {
+                checkpoint->saveState(numFiles, current);
+            }
+            catch (const std::exception& ex)
+            {
+                spdlog::warn("Unable to save the checkpoint: {}", ex.what());
+            }
+        };
+    }
+
+    const Options opts {.minSizeBytes = cfg.minFileSizeBytes(),
+                        .maxSizeBytes = cfg.maxFileSizeBytes(),
+                        .hashWorkers = cfg.hashWorkers(),
+                        .hddWorkers = cfg.hddWorkers(),
+                        .ssdWorkers = cfg.ssdWorkers(),
+                        .physicalOrder = cfg.physicalOrder(),
+                        .compareMaxFiles = cfg.compareMaxFiles(),
+                        .readBufferBytes = cfg.readBufferBytes(),
+                        .readBackend = cfg.readBackend(),
+                        .treeHashMinBytes = cfg.treeHashMinBytes(),
+                        .hashCache = cache.get(),
+                        .checkpoint = saveState,
+                        .checkpointInterval = cfg.checkpointInterval(),
+                        .resume = resume ? &state : nullptr,
+                        .onGroup = onGroup,
+                        .directoryGroups = cfg.directoryGroups(),
+                        .backupDirs = cfg.backupDirs()};
+
+    spdlog::trace("Detecting duplicates...");
+    detector.detect(
+        opts,
+        [&progress](const Stage stage, const Node*, size_t percent) mutable {
+            progress.update([&](std::ostream& os) {
+                os << "Stage: " << stage2str(stage) << " - " << percent << "%";
+            });
+        });
+
+    spdlog::trace("Detection took: {} ms", sw.elapsedMs());
+    logStats(detector.stats());
+
+    if (!cfg.statsFilePath().empty())
+    {
+        writeStats(cfg.statsFilePath(), detector.stats());
+    }
+}
+
+/**
+ * @brief Kind column of the entry, the remote and the backup ones are marked as such
+ * whatever they are
+ */
+std::string_view entryKind(bool link, bool directory, bool backup, bool remote)
+{
+    if (remote)
+    {
+        return "remote";
+    }
+
+    if (backup)
+    {
+        return "backup";
+    }
+
+    return directory ? "dir" : (link ? "link" : "copy");
+}
+
+std::string groupLine(size_t groupId,
+                      const core::crypto::Digest& sha256,
+                      size_t size,
+                      std::string_view kind,
+                      const fs::path& file)
+{
+    return std::format("{}|{}|{}|{}|{}",
+                       groupId,
+                       core::crypto::toHex(std::span(sha256).first(8)),
+                       size,
+                       kind,
+                       core::file::path2s(file));
+}
+
+void writeLines(std::ostream& out, std::vector<std::string>& lines)
+{
+    std::ranges::sort(lines);
+    for (const auto& line : lines)
+    {
+        out << line << '\n';
+    }
+
+    out << '\n';
+}
+
+/**
+ * @brief Write the files of the group in the sorted order, followed by an empty line
+ */
+void writeGroup(std::ostream& out, const DupGroup& group)
+{
+    std::vector<std::string> lines;
+
+    for (const auto& e : group.entires)
+    {
+        const auto kind = entryKind(e.link, e.directory, e.backup, e.remote);
+        lines.push_back(groupLine(group.groupId, e.sha256, e.size, kind, e.file));
+    }
+
+    writeLines(out, lines);
+}
+
+/**
+ * @brief Same as above, the paths are built into `path`, the memory of `path` and
+ * `lines` is reused
+ */
+void writeGroup(std::ostream& out,
+                const DupGroupView& group,
+                fs::path& path,
+                std::vector<std::string>& lines)
+{
+    lines.clear();
+
+    for (const auto& e : group.entries)
+    {
+        e.file(path);
+        const auto kind =
+            entryKind(e.link(), e.directory(), e.backup(), e.remote());
+        lines.push_back(groupLine(group.groupId, e.sha256(), e.size(), kind, path));
+    }
+
+    writeLines(out, lines);
+}
+
+void logTotals(size_t numGroups, size_t totalFiles)
+{
+    spdlog::info("Detected {} duplicates groups", numGroups);
+    spdlog::info("All groups combined have: {} files", totalFiles);
+    spdlog::info("In other words: {} duplicate files", totalFiles - numGroups);
+}
+
+} // namespace
 
 // @todo: make scandirs in the config as vector of paths
 void scanDirectories(const Config& cfg,
@@ -15,39 +314,153 @@ void scanDirectories(const Config& cfg,
                      Progress& progress)
 {
     StopWatch sw;
+    size_t numFiles = 0;
+    size_t skippedFiles = 0;
+    auto checkpoint = openCheckpoint(cfg);
+
+    // The interrupted run continues with the files it has found
+    if (cfg.resume() && checkpoint && checkpoint->loadFiles(detector))
+    {
+        spdlog::info("Scan skipped, {} files taken from the checkpoint",
+                     detector.numFiles());
+        return;
+    }
+
+    // Directories are listed in parallel, the deterministic order keeps the file
+    // tree and its dumps reproducible. The entries left out are reported as well,
+    // the directories holding them are never copies of others.
+    const core::file::DirWalker walker({
+        .stat = true,
+        .deterministic = true,
+        .symlinks = core::file::SymlinkPolicy::Report,
+        .exclusions = core::file::PathMatcher(cfg.exclusionPatterns()),
+        .reportExcluded = true,
+    });
+
+    auto addFile = [&](const auto& entry, const std::error_code& ec) {
+        using core::file::EntryType;
+
+        if (ec)
+        {
+            spdlog::error("Error: '{}' while processing path: '{}'",
+                          ec.message(),
+                          entry.path);
+            detector.addIncompleteDir(entry.path.parent_path());
+            return;
+        }
+
+        if (entry.type == EntryType::Directory && !entry.pruned && !entry.excluded)
+        {
+            return;
+        }
+
+        // The manifests describe the files of other hosts, they aren't scanned
+        if (entry.type != EntryType::Regular || entry.excluded ||
+            std::ranges::find(cfg.manifests(), entry.path) != cfg.manifests().end())
+        {
+            detector.addIncompleteDir(entry.path.parent_path());
+            return;
+        }
+
+        FileMeta meta;
+
+        if (entry.info)
+        {
+            // Files out of the size range never enter the tree
+            const auto size = entry.info->size;
+            if (size < cfg.minFileSizeBytes() || size > cfg.maxFileSizeBytes())
+            {
+                detector.addIncompleteDir(entry.path.parent_path());
+                ++skippedFiles;
+                return;
+            }
+
+            // Hard links are recognized by the identity of the file
+            meta.id = {entry.info->device, entry.info->inode};
+            meta.size = size;
+            meta.mtime = entry.info->mtime;
+        }
+
+        detector.addFile(entry.path, meta);
+        ++numFiles;
+        progress.update([&numFiles](std::ostream& os) {
+            os << "Scanned files: " << numFiles;
+        });
+    };
 
     for (const auto& scanDir : cfg.scanDirs())
     {
         const auto srcDir = fs::path(scanDir).lexically_normal();
         spdlog::info("Scanning directory: '{}'", srcDir);
+        walker.walk(srcDir, addFile);
+    }
 
-        core::file::enumFilesRecursive(
-            srcDir,
-            cfg.exclusionPatterns(),
-            [numFiles = 0, &detector, &progress](const auto& p,
-                                                 const std::error_code& ec) mutable {
-                if (ec)
-                {
-                    spdlog::error("Error: '{}' while processing path: '{}'",
-                                  ec.message(),
-                                  p);
-                    return;
-                }
-
-                if (fs::is_regular_file(p))
-                {
-                    detector.addFile(p);
-                    ++numFiles;
-                    progress.update([&numFiles](std::ostream& os) {
-                        os << "Scanned files: " << numFiles;
-                    });
-                }
-            });
+    for (const auto& backupDir : cfg.backupDirs())
+    {
+        // The backup of another host is the manifest of its files
+        if (std::ranges::find(cfg.manifests(), backupDir) != cfg.manifests().end())
+        {
+            continue;
+        }
+
+        spdlog::info("Scanning backup directory: '{}'", backupDir);
+        walker.walk(backupDir, addFile);
     }
 
     spdlog::info("Discovered files: {}", detector.numFiles());
+    spdlog::info("Files out of the size range: {}", skippedFiles);
     spdlog::trace("Scanning took: {} ms", sw.elapsedMs());
     spdlog::trace("Nodes: {}", detector.root()->nodesCount());
+
+    if (checkpoint && cfg.checkpointInterval().count() > 0)
+    {
+        try
+        {
+            checkpoint->saveFiles(detector);
+        }
+        catch (const std::exception& ex)
+        {
+            spdlog::warn("Unable to save the checkpoint: {}", ex.what());
+        }
+    }
+}
+
+void exportManifest(const Config& cfg,
+                    const DuplicateDetector& detector,
+                    Progress& progress)
+{
+    if (cfg.exportManifestPath().empty())
+    {
+        return;
+    }
+
+    StopWatch sw;
+    const auto cache = openHashCache(cfg);
+    const Options opts {.hashWorkers = cfg.hashWorkers(),
+                        .hddWorkers = cfg.hddWorkers(),
+                        .ssdWorkers = cfg.ssdWorkers(),
+                        .physicalOrder = cfg.physicalOrder(),
+                        .readBufferBytes = cfg.readBufferBytes(),
+                        .treeHashMinBytes = cfg.treeHashMinBytes(),
+                        .hashCache = cache.get()};
+
+    spdlog::info("Exporting the manifest to: '{}'", cfg.exportManifestPath());
+    Manifest(cfg.exportManifestPath())
+        .save(detector, opts, [&progress](const Stage, const Node*, size_t percent) {
+            progress.update([percent](std::ostream& os) {
+                os << "Digested files: " << percent << "%";
+            });
+        });
+    spdlog::trace("Export took: {} ms", sw.elapsedMs());
+}
+
+void importManifests(const Config& cfg, DuplicateDetector& detector)
+{
+    for (const auto& manifest : cfg.manifests())
+    {
+        Manifest(manifest).load(detector,
+                                {.treeHashMinBytes = cfg.treeHashMinBytes()});
+    }
 }
 
 
@@ -61,20 +474,7 @@ void detectDuplicates(const Config& cfg,
         return;
     }
 
-    StopWatch sw;
-    const Options opts {.minSizeBytes = cfg.minFileSizeBytes(),
-                        .maxSizeBytes = cfg.maxFileSizeBytes()};
-
-    spdlog::trace("Detecting duplicates...");
-    detector.detect(
-        opts,
-        [&progress](const Stage stage, const Node*, size_t percent) mutable {
-            progress.update([&](std::ostream& os) {
-                os << "Stage: " << stage2str(stage) << " - " << percent << "%";
-            });
-        });
-
-    spdlog::trace("Detection took: {} ms", sw.elapsedMs());
+    detect(cfg, detector, progress, {});
 }
 
 void outputFiles(const fs::path& allFiles, const DuplicateDetector& detector)
@@ -105,45 +505,130 @@ void reportDuplicates(const fs::path& reportPath, const DuplicateDetector& detec
 {
     std::ofstream out(reportPath, std::ios::out | std::ios::binary);
     size_t totalFiles = 0;
-    size_t largestFileSize = 0;
+    fs::path path;
+    std::vector<std::string> lines;
 
-    // Precalculations to produce nice output
-    detector.enumGroups([&largestFileSize, &totalFiles](const DupGroup& group) {
-        totalFiles += group.entires.size();
-        largestFileSize = std::max(largestFileSize, group.entires.front().size);
-        return true;
-    });
+    for (const auto& group : detector.groups())
+    {
+        writeGroup(out, group, path, lines);
+        totalFiles += group.entries.size();
+    }
+
+    logTotals(detector.numGroups(), totalFiles);
+}
+
+void writeStats(const fs::path& statsPath, const DetectionStats& stats)
+{
+    auto stages = nlohmann::json::array();
+
+    for (size_t i = 0; i < NUM_STAGES; ++i)
+    {
+        const auto stage = static_cast<Stage>(i);
+        const auto& st = stats[stage];
+
+        stages.push_back({
+            {"name", stage2str(stage)},
+            {"wallSeconds", toSeconds(st.wall)},
+            {"cpuSeconds", toSeconds(st.cpu)},
+            {"files", st.files},
+            {"bytes", st.bytes},
+            {"cacheHits", st.cacheHits},
+            {"opens", st.opens},
+            {"reads", st.reads},
+        });
+    }
+
+    auto groupSizes = nlohmann::json::array();
+    for (const auto& [files, groups] : stats.groupSizes)
+    {
+        groupSizes.push_back({{"files", files}, {"groups", groups}});
+    }
+
+    const nlohmann::json json {
+        {"stages", std::move(stages)},
+        {"groupSizes", std::move(groupSizes)},
+    };
+
+    std::ofstream out(statsPath, std::ios::out | std::ios::binary);
+
+    if (!out)
+    {
+        throw std::system_error(
+            std::make_error_code(std::errc::no_such_file_or_directory),
+            std::format("Unable to open file: '{}'", statsPath));
+    }
+
+    out << json.dump(2) << '\n';
+    spdlog::info("Detection stats written to: '{}'", statsPath);
+}
 
-    const auto separator = '|';
-    std::ostringstream oss;
-    std::vector<std::string> sortedLines;
+void streamDuplicates(const Config& cfg,
+                      DuplicateDetector& detector,
+                      const fs::path& reportPath,
+                      const DupGroupCallback& cb)
+{
+    if (cfg.skipDetection())
+    {
+        spdlog::warn("Skip duplicate detection");
+        return;
+    }
 
-    detector.enumGroups([&out, &oss, &sortedLines](const DupGroup& group) {
-        sortedLines.clear();
+    GroupStream stream(STREAM_CAPACITY);
+    std::exception_ptr error;
 
-        for (const auto& e : group.entires)
+    // The console belongs to the review, the detection reports no progress there
+    std::thread detection([&cfg, &detector, &stream, &error] {
+        try
+        {
+            Progress silent(nullptr);
+            detect(cfg, detector, silent, [&stream](const DupGroup& group) {
+                return stream.push(group);
+            });
+        }
+        catch (...)
         {
-            oss.str("");
-            oss << group.groupId << separator
-                << std::string_view(e.sha256).substr(0, 16) << separator << e.size
-                << separator << core::file::path2s(e.file);
-            sortedLines.emplace_back(oss.str());
+            error = std::current_exception();
         }
+        stream.close();
+    });
+
+    size_t numGroups = 0;
+    size_t totalFiles = 0;
 
-        std::ranges::sort(sortedLines);
-        for (const auto& line : sortedLines)
+    try
+    {
+        std::ofstream out(reportPath, std::ios::out | std::ios::binary);
+
+        while (auto group = stream.pop())
         {
-            out << line << '\n';
+            writeGroup(out, *group);
+            out.flush();
+            ++numGroups;
+            totalFiles += group->entires.size();
+
+            // Nothing more is detected once the review is over
+            if (!cb(*group))
+            {
+                stream.close();
+                break;
+            }
         }
+    }
+    catch (...)
+    {
+        stream.close();
+        detection.join();
+        throw;
+    }
 
-        out << '\n';
-        return true;
-    });
+    detection.join();
 
-    spdlog::info("Detected {} duplicates groups", detector.numGroups());
-    spdlog::info("All groups combined have: {} files", totalFiles);
-    spdlog::info("In other words: {} duplicate files",
-                 totalFiles - detector.numGroups());
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    logTotals(numGroups, totalFiles);
 }
 
 } // namespace tools::dups
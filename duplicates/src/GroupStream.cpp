@@ -0,0 +1,69 @@
+#include <duplicates/GroupStream.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace tools::dups {
+
+GroupStream::GroupStream(size_t capacity)
+    : capacity_ {std::max<size_t>(capacity, 1)}
+{
+}
+
+bool GroupStream::push(DupGroup group)
+{
+    std::unique_lock lock(mutex_);
+    notFull_.wait(lock, [this] {
+        return closed_ || groups_.size() < capacity_;
+    });
+
+    if (closed_)
+    {
+        return false;
+    }
+
+    groups_.push_back(std::move(group));
+    lock.unlock();
+    notEmpty_.notify_one();
+
+    return true;
+}
+
+std::optional<DupGroup> GroupStream::pop()
+{
+    std::unique_lock lock(mutex_);
+    notEmpty_.wait(lock, [this] {
+        return closed_ || !groups_.empty();
+    });
+
+    if (groups_.empty())
+    {
+        return std::nullopt;
+    }
+
+    auto group = std::move(groups_.front());
+    groups_.pop_front();
+    lock.unlock();
+    notFull_.notify_one();
+
+    return group;
+}
+
+void GroupStream::close()
+{
+    {
+        std::lock_guard lock(mutex_);
+        closed_ = true;
+    }
+
+    notFull_.notify_all();
+    notEmpty_.notify_all();
+}
+
+bool GroupStream::closed() const
+{
+    std::lock_guard lock(mutex_);
+    return closed_;
+}
+
+} // namespace tools::dups
@@ -0,0 +1,307 @@
+#include <duplicates/HashCache.h>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+namespace tools::dups {
+namespace {
+
+constexpr std::array<char, 8> MAGIC {'D', 'U', 'P', 'D', 'I', 'G', 'S', 'T'};
+constexpr uint32_t VERSION = 3;
+
+// The log is merged into the table when the cache is closed, if it holds at least
+// that many records or a sixteenth of the table size, whichever is greater
+constexpr size_t COMPACT_MIN_RECORDS = 1024;
+
+struct Header
+{
+    std::array<char, 8> magic {MAGIC};
+    uint32_t version {VERSION};
+    uint32_t recordSize {sizeof(HashCache::Record)};
+
+    // The digests of the files of at least that size are tree digests
+    uint64_t treeMinBytes {};
+
+    bool valid(uint64_t expectedTreeMinBytes) const noexcept
+    {
+        return magic == MAGIC && version == VERSION &&
+               recordSize == sizeof(HashCache::Record) &&
+               treeMinBytes == expectedTreeMinBytes;
+    }
+};
+
+static_assert(sizeof(Header) == 24);
+static_assert(sizeof(HashCache::Record) == 64);
+
+bool less(const HashCache::Record& a, const HashCache::Record& b) noexcept
+{
+    return a.device < b.device || (a.device == b.device && a.inode < b.inode);
+}
+
+void write(std::ofstream& out, const void* data, size_t size)
+{
+    out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+}
+
+} // namespace
+
+size_t HashCache::KeyHash::operator()(const Key& key) const noexcept
+{
+    return std::hash<uint64_t> {}(key.inode * 31 + key.device);
+}
+
+HashCache::HashCache(fs::path dir, uint64_t treeMinBytes)
+    : tablePath_ {dir / "digests.tbl"}
+    , logPath_ {dir / "digests.log"}
+    , treeMinBytes_ {treeMinBytes}
+{
+    fs::create_directories(dir);
+
+    openTable();
+    openLog();
+
+    spdlog::debug("Hash cache '{}' opened, {} table and {} log records",
+                  dir.string(),
+                  table_.size(),
+                  log_.size());
+}
+
+HashCache::~HashCache()
+{
+    try
+    {
+        if (log_.size() >= std::max(COMPACT_MIN_RECORDS, table_.size() / 16))
+        {
+            compact();
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        spdlog::warn("Unable to compact the hash cache: {}", ex.what());
+    }
+}
+
+bool HashCache::lookup(const core::file::FileInfo& info,
+                       core::crypto::Digest& sha256) const
+{
+    const std::shared_lock lock(mutex_);
+    const auto* rec = find({info.device, info.inode});
+
+    if (!rec || rec->size != info.size || rec->mtime != info.mtime)
+    {
+        return false;
+    }
+
+    sha256 = rec->digest;
+    return true;
+}
+
+void HashCache::store(const core::file::FileInfo& info,
+                      const core::crypto::Digest& sha256)
+{
+    const Record rec {
+        .device = info.device,
+        .inode = info.inode,
+        .size = info.size,
+        .mtime = info.mtime,
+        .digest = sha256,
+    };
+
+    const std::unique_lock lock(mutex_);
+    log_[{rec.device, rec.inode}] = rec;
+    write(logFile_, &rec, sizeof(rec));
+}
+
+void HashCache::compact()
+{
+    const std::unique_lock lock(mutex_);
+
+    if (log_.empty())
+    {
+        return;
+    }
+
+    std::vector<Record> pending;
+    pending.reserve(log_.size());
+    for (const auto& [_, rec] : log_)
+    {
+        pending.push_back(rec);
+    }
+    std::ranges::sort(pending, less);
+
+    fs::path tmpPath = tablePath_;
+    tmpPath += ".tmp";
+
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        const Header header {.treeMinBytes = treeMinBytes_};
+        write(out, &header, sizeof(header));
+
+        // Merge the sorted log into the sorted table, the log takes precedence
+        auto tit = table_.begin();
+        auto pit = pending.begin();
+
+        while (tit != table_.end() || pit != pending.end())
+        {
+            if (pit == pending.end() || (tit != table_.end() && less(*tit, *pit)))
+            {
+                write(out, &*tit++, sizeof(Record));
+                continue;
+            }
+
+            if (tit != table_.end() && !less(*pit, *tit))
+            {
+                ++tit;
+            }
+            write(out, &*pit++, sizeof(Record));
+        }
+
+        if (!out.flush())
+        {
+            throw std::system_error(
+                std::make_error_code(std::errc::io_error),
+                std::format("Unable to write: '{}'", tmpPath.string()));
+        }
+    }
+
+    table_ = {};
+    tableFile_.close();
+    fs::rename(tmpPath, tablePath_);
+
+    openTable();
+    resetLog();
+    log_.clear();
+}
+
+size_t HashCache::size() const
+{
+    const std::shared_lock lock(mutex_);
+    return table_.size() + log_.size();
+}
+
+uint64_t HashCache::treeMinBytes() const noexcept
+{
+    return treeMinBytes_;
+}
+
+const fs::path& HashCache::tablePath() const noexcept
+{
+    return tablePath_;
+}
+
+const fs::path& HashCache::logPath() const noexcept
+{
+    return logPath_;
+}
+
+void HashCache::openTable()
+{
+    std::error_code ec;
+    const auto fileSize = fs::file_size(tablePath_, ec);
+
+    // boost::iostreams::mapped_file throws an exception when attempting to open an
+    // empty file in read-only mode
+    if (ec || fileSize < sizeof(Header))
+    {
+        return;
+    }
+
+    tableFile_.open(tablePath_.string());
+
+    Header header;
+    std::memcpy(&header, tableFile_.data(), sizeof(header));
+    const auto payload = tableFile_.size() - sizeof(Header);
+
+    // The digests of another threshold are of another kind for some of the sizes
+    if (!header.valid(treeMinBytes_) || payload % sizeof(Record) != 0)
+    {
+        spdlog::warn("Ignoring invalid hash cache table: '{}'", tablePath_.string());
+        tableFile_.close();
+        return;
+    }
+
+    // The mapping is page aligned and the header keeps the records aligned as well
+    table_ = {reinterpret_cast<const Record*>(tableFile_.data() + sizeof(Header)),
+              payload / sizeof(Record)};
+}
+
+void HashCache::openLog()
+{
+    std::ifstream in(logPath_, std::ios::binary);
+    Header header;
+    size_t count = 0;
+
+    if (in.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+        header.valid(treeMinBytes_))
+    {
+        Record rec;
+        while (in.read(reinterpret_cast<char*>(&rec), sizeof(rec)))
+        {
+            log_[{rec.device, rec.inode}] = rec;
+            ++count;
+        }
+    }
+    else
+    {
+        in.close();
+        resetLog();
+        return;
+    }
+
+    in.close();
+
+    // Drop a partially written trailing record, left behind by an interrupted run,
+    // so that the following appends stay aligned
+    fs::resize_file(logPath_, sizeof(Header) + count * sizeof(Record));
+    logFile_.open(logPath_, std::ios::binary | std::ios::app);
+
+    if (!logFile_)
+    {
+        throw std::system_error(
+            std::make_error_code(std::errc::io_error),
+            std::format("Unable to open: '{}'", logPath_.string()));
+    }
+}
+
+void HashCache::resetLog()
+{
+    logFile_.close();
+    logFile_.open(logPath_, std::ios::binary | std::ios::trunc);
+
+    if (!logFile_)
+    {
+        throw std::system_error(
+            std::make_error_code(std::errc::io_error),
+            std::format("Unable to open: '{}'", logPath_.string()));
+    }
+
+    const Header header {.treeMinBytes = treeMinBytes_};
+    write(logFile_, &header, sizeof(header));
+    logFile_.flush();
+}
+
+const HashCache::Record* HashCache::find(const Key& key) const
+{
+    if (const auto it = log_.find(key); it != log_.end())
+    {
+        return &it->second;
+    }
+
+    const Record probe {.device = key.device, .inode = key.inode};
+    const auto it = std::ranges::lower_bound(table_, probe, less);
+
+    if (it != table_.end() && it->device == key.device && it->inode == key.inode)
+    {
+        return &*it;
+    }
+
+    return nullptr;
+}
+
+} // namespace tools::dups
@@ -0,0 +1,508 @@
+#include <duplicates/HashEngine.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace tools::dups {
+namespace {
+
+size_t resolveWorkers(size_t workers)
+{
+    if (workers == 0)
+    {
+        workers = std::thread::hardware_concurrency();
+    }
+
+    return std::max<size_t>(workers, 1);
+}
+
+/**
+ * @brief Counts the calling worker as busy while it exists
+ */
+class Busy
+{
+    std::atomic<size_t>& busy_;
+
+public:
+    explicit Busy(std::atomic<size_t>& busy) noexcept
+        : busy_ {busy}
+    {
+        ++busy_;
+    }
+
+    Busy(const Busy&) = delete;
+    Busy& operator=(const Busy&) = delete;
+
+    ~Busy()
+    {
+        --busy_;
+    }
+};
+
+/**
+ * @brief Hands out the jobs of the queues in turns, respecting their limits
+ */
+class Scheduler
+{
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    const JobQueues& queues_;
+    std::vector<std::vector<size_t>> jobs_;
+    std::vector<size_t> next_;
+    std::vector<size_t> running_;
+    size_t remaining_ {0};
+    size_t turn_ {0};
+    bool stopped_ {false};
+
+public:
+    Scheduler(size_t count, const JobQueues& queues)
+        : queues_ {queues}
+        , jobs_(queues.limits.size())
+        , next_(queues.limits.size(), 0)
+        , running_(queues.limits.size(), 0)
+        , remaining_ {count}
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            jobs_[queues.queueOf[i]].push_back(i);
+        }
+
+        if (!queues.order.empty())
+        {
+            for (auto& jobs : jobs_)
+            {
+                std::ranges::stable_sort(jobs, {}, [&queues](size_t i) {
+                    return queues.order[i];
+                });
+            }
+        }
+    }
+
+    bool pop(size_t& index)
+    {
+        std::unique_lock lock(mutex_);
+
+        while (!stopped_ && remaining_ > 0)
+        {
+            for (size_t k = 0; k < jobs_.size(); ++k)
+            {
+                const size_t q = (turn_ + k) % jobs_.size();
+                const size_t limit = queues_.limits[q];
+
+                if (next_[q] < jobs_[q].size() && (limit == 0 || running_[q] < limit))
+                {
+                    index = jobs_[q][next_[q]++];
+                    ++running_[q];
+                    --remaining_;
+                    turn_ = q + 1;
+                    return true;
+                }
+            }
+
+            // All the queues with jobs left are busy
+            cv_.wait(lock);
+        }
+
+        return false;
+    }
+
+    void release(size_t index)
+    {
+        {
+            std::lock_guard lock(mutex_);
+            --running_[queues_.queueOf[index]];
+        }
+        cv_.notify_one();
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            stopped_ = true;
+        }
+        cv_.notify_all();
+    }
+};
+
+class JobQueue
+{
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<size_t> finished_;
+    std::exception_ptr error_;
+    std::atomic_size_t next_ {0};
+    std::atomic_bool stopped_ {false};
+    size_t count_ {0};
+    std::optional<Scheduler> scheduler_;
+
+public:
+    JobQueue(size_t count, const JobQueues* queues)
+        : count_ {count}
+    {
+        if (queues)
+        {
+            scheduler_.emplace(count, *queues);
+        }
+    }
+
+    bool pop(size_t& index)
+    {
+        if (scheduler_)
+        {
+            return scheduler_->pop(index);
+        }
+
+        if (stopped_.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        index = next_.fetch_add(1, std::memory_order_relaxed);
+        return index < count_;
+    }
+
+    /**
+     * @brief Called once the work on the job is over, whatever the outcome
+     */
+    void release(size_t index)
+    {
+        if (scheduler_)
+        {
+            scheduler_->release(index);
+        }
+    }
+
+    void finish(size_t index)
+    {
+        {
+            std::lock_guard lock(mutex_);
+            finished_.push_back(index);
+        }
+        cv_.notify_one();
+    }
+
+    void fail(std::exception_ptr error)
+    {
+        {
+            std::lock_guard lock(mutex_);
+            if (!error_)
+            {
+                error_ = std::move(error);
+            }
+        }
+        stop();
+        cv_.notify_one();
+    }
+
+    void stop() noexcept
+    {
+        stopped_.store(true, std::memory_order_relaxed);
+
+        if (scheduler_)
+        {
+            scheduler_->stop();
+        }
+    }
+
+    /**
+     * @brief Wait for finished jobs, returns false once an error is reported
+     */
+    bool wait(std::vector<size_t>& finished)
+    {
+        finished.clear();
+
+        std::unique_lock lock(mutex_);
+        cv_.wait(lock, [this] {
+            return !finished_.empty() || error_;
+        });
+
+        finished.swap(finished_);
+        return !error_;
+    }
+
+    std::exception_ptr error()
+    {
+        std::lock_guard lock(mutex_);
+        return error_;
+    }
+};
+
+} // namespace
+
+/**
+ * @brief Threads of the engine, every run hands the loop over its jobs to some of
+ * them
+ */
+struct HashEngine::Pool
+{
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable idle;
+
+    // Loop of the current run, the number of the workers it wants and of the ones
+    // which took it up
+    std::function<void()> loop;
+    size_t wanted {0};
+    size_t joined {0};
+    size_t active {0};
+    uint64_t generation {0};
+    bool stopping {false};
+
+    // Held for the whole run, the runs don't overlap
+    std::mutex runMutex;
+    std::vector<std::thread> threads;
+
+    explicit Pool(size_t workers)
+    {
+        threads.reserve(workers);
+        for (size_t t = 0; t < workers; ++t)
+        {
+            threads.emplace_back([this] {
+                serve();
+            });
+        }
+    }
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    ~Pool()
+    {
+        {
+            const std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        started.notify_all();
+
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+    }
+
+    /**
+     * @brief Hand the loop to `count` of the workers
+     */
+    void start(std::function<void()> runLoop, size_t count)
+    {
+        {
+            const std::lock_guard lock(mutex);
+            loop = std::move(runLoop);
+            wanted = count;
+            joined = 0;
+            ++generation;
+        }
+        started.notify_all();
+    }
+
+    /**
+     * @brief Wait for the workers running the loop, the ones which didn't take it up
+     * yet no longer do
+     */
+    void finish()
+    {
+        std::unique_lock lock(mutex);
+        wanted = joined;
+        idle.wait(lock, [this] {
+            return active == 0;
+        });
+        loop = nullptr;
+    }
+
+private:
+    void serve()
+    {
+        uint64_t seen = 0;
+        std::unique_lock lock(mutex);
+
+        while (true)
+        {
+            started.wait(lock, [this, &seen] {
+                return stopping || (generation != seen && joined < wanted);
+            });
+
+            if (stopping)
+            {
+                return;
+            }
+
+            seen = generation;
+            ++joined;
+            ++active;
+
+            // Not replaced before all the workers running it are done
+            lock.unlock();
+            loop();
+            lock.lock();
+
+            if (--active == 0)
+            {
+                idle.notify_all();
+            }
+        }
+    }
+};
+
+HashEngine::HashEngine(size_t workers)
+    : workers_ {resolveWorkers(workers)}
+{
+    // A single worker runs the jobs on the calling thread
+    if (workers_ > 1)
+    {
+        pool_ = std::make_unique<Pool>(workers_);
+    }
+}
+
+HashEngine::~HashEngine() = default;
+
+size_t HashEngine::workers() const noexcept
+{
+    return workers_;
+}
+
+HashEngine::Lease::Lease(const HashEngine& engine, size_t count) noexcept
+    : engine_ {engine}
+    , count_ {count}
+{
+}
+
+HashEngine::Lease::~Lease()
+{
+    engine_.busy_ -= count_;
+}
+
+size_t HashEngine::Lease::count() const noexcept
+{
+    return count_;
+}
+
+HashEngine::Lease HashEngine::borrowIdle(size_t wanted) const noexcept
+{
+    auto busy = busy_.load();
+    size_t count = 0;
+
+    do
+    {
+        count = std::min(wanted, workers_ - std::min(busy, workers_));
+    } while (count > 0 && !busy_.compare_exchange_weak(busy, busy + count));
+
+    return {*this, count};
+}
+
+void HashEngine::run(size_t count,
+                     const WorkCallback& work,
+                     const DoneCallback& done) const
+{
+    runQueued(count, nullptr, work, done);
+}
+
+void HashEngine::run(size_t count,
+                     const JobQueues& queues,
+                     const WorkCallback& work,
+                     const DoneCallback& done) const
+{
+    runQueued(count, &queues, work, done);
+}
+
+void HashEngine::runQueued(size_t count,
+                           const JobQueues* queues,
+                           const WorkCallback& work,
+                           const DoneCallback& done) const
+{
+    size_t numThreads = std::min(workers_, count);
+
+    // More threads than the queues allow in total would only wait
+    if (queues && std::ranges::find(queues->limits, 0U) == queues->limits.end())
+    {
+        size_t total = 0;
+        for (const auto limit : queues->limits)
+        {
+            total += limit;
+        }
+        numThreads = std::min(numThreads, total);
+    }
+
+    JobQueue queue(count, queues);
+
+    if (numThreads <= 1)
+    {
+        // The queues still decide the order of the jobs
+        size_t index = 0;
+        while (queue.pop(index))
+        {
+            {
+                const Busy busy(busy_);
+                work(index);
+            }
+            queue.release(index);
+            done(index);
+        }
+        return;
+    }
+
+    const std::lock_guard run(pool_->runMutex);
+
+    auto stopAll = [this, &queue]() noexcept {
+        queue.stop();
+        pool_->finish();
+    };
+
+    pool_->start(
+        [this, &queue, &work] {
+            size_t index = 0;
+            while (queue.pop(index))
+            {
+                try
+                {
+                    {
+                        const Busy busy(busy_);
+                        work(index);
+                    }
+                    queue.finish(index);
+                }
+                catch (...)
+                {
+                    queue.fail(std::current_exception());
+                }
+                queue.release(index);
+            }
+        },
+        numThreads);
+
+    std::vector<size_t> finished;
+    size_t delivered = 0;
+
+    try
+    {
+        while (delivered < count && queue.wait(finished))
+        {
+            for (const auto index : finished)
+            {
+                done(index);
+                ++delivered;
+            }
+        }
+    }
+    catch (...)
+    {
+        stopAll();
+        throw;
+    }
+
+    stopAll();
+
+    if (auto error = queue.error())
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace tools::dups
@@ -76,9 +76,8 @@ int main(int argc, const char* argv[])
 
         scanDirectories(cfg, detector, progress);
         outputFiles(cfg.allFilesPath(), detector);
-
-        detectDuplicates(cfg, detector, progress);
-        reportDuplicates(cfg.dupFilesPath(), detector);
+        exportManifest(cfg, detector, progress);
+        importManifests(cfg, detector);
 
         // start deletion of the duplicates
         auto strategy = createDeletionStrategy(cfg);
@@ -95,7 +94,20 @@ int main(int argc, const char* argv[])
         deletionCfg.keepFromPaths().add(cfg.dirsToKeepFrom());
         deletionCfg.deleteFromPaths().add(cfg.dirsToDeleteFrom());
 
-        deleteDuplicates(detector, deletionCfg);
+        // The review of the groups starts as soon as the first one is confirmed
+        if (cfg.streamGroups())
+        {
+            streamDuplicates(cfg,
+                             detector,
+                             cfg.dupFilesPath(),
+                             duplicatesDeleter(deletionCfg));
+        }
+        else
+        {
+            detectDuplicates(cfg, detector, progress);
+            reportDuplicates(cfg.dupFilesPath(), detector);
+            deleteDuplicates(detector, deletionCfg);
+        }
     }
     catch (const std::system_error& se)
     {
@@ -0,0 +1,213 @@
+#include <duplicates/Manifest.h>
+#include <duplicates/Node.h>
+#include "BinaryFile.h"
+#include <core/utils/FmtExt.h>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace tools::dups {
+namespace {
+
+constexpr std::array<char, 8> MAGIC {'D', 'U', 'P', 'M', 'A', 'N', 'I', 'F'};
+constexpr uint32_t VERSION = 1;
+
+// Longer paths are taken for a sign of a damaged file
+constexpr uint32_t MAX_PATH_LENGTH = 32 * 1024;
+
+using Writer = BinaryWriter<LittleEndian>;
+using Reader = BinaryReader<LittleEndian>;
+
+/**
+ * @brief Path of the file under the root of the manifest, empty if the stored one
+ * would lead out of it
+ */
+fs::path virtualPath(const fs::path& root, const std::u8string& stored)
+{
+    const auto relative = fs::path(stored).relative_path();
+
+    if (relative.empty() || std::ranges::any_of(relative, [](const fs::path& name) {
+            return name == "..";
+        }))
+    {
+        return {};
+    }
+
+    return root / relative;
+}
+
+} // namespace
+
+Manifest::Manifest(fs::path path)
+    : path_ {std::move(path)}
+{
+}
+
+void Manifest::save(const DuplicateDetector& detector,
+                    const Options& opts,
+                    const ProgressCallback& cb) const
+{
+    // The number of the files is known once they are digested
+    struct Record
+    {
+        std::u8string path;
+        uint64_t size {};
+        FileDigests digests;
+    };
+
+    std::vector<Record> records;
+    fs::path path;
+
+    detector.digestFiles(
+        opts,
+        [&records, &path](const Node* node, const FileDigests& digests) {
+            node->fullPath(path);
+            records.push_back({
+                .path = path.generic_u8string(),
+                .size = node->size(),
+                .digests = digests,
+            });
+        },
+        cb);
+
+    Writer out(path_);
+    out.put(MAGIC.data(), MAGIC.size());
+    out.put(VERSION);
+    out.put(uint32_t {0});
+    out.put(static_cast<uint64_t>(opts.treeHashMinBytes));
+    out.put(static_cast<uint64_t>(records.size()));
+
+    const std::u8string* prev = nullptr;
+
+    for (const auto& r : records)
+    {
+        const auto& curr = r.path;
+        const auto shared =
+            prev ? static_cast<size_t>(std::ranges::mismatch(*prev, curr).in2 -
+                                       curr.begin())
+                 : size_t {0};
+        const auto suffix = curr.size() - shared;
+
+        out.put(static_cast<uint32_t>(shared));
+        out.put(static_cast<uint32_t>(suffix));
+        out.put(curr.data() + shared, suffix);
+        out.put(r.size);
+        out.put(r.digests.head);
+        out.put(r.digests.tail);
+        out.put(r.digests.sample);
+        out.put(r.digests.sha256);
+        prev = &curr;
+    }
+
+    out.commit();
+    spdlog::info("Manifest of {} files saved: '{}'", records.size(), path_);
+}
+
+size_t Manifest::load(DuplicateDetector& detector, const Options& opts) const
+{
+    Reader in(path_);
+    if (!in.isOpen())
+    {
+        throw std::system_error(
+            std::make_error_code(std::errc::no_such_file_or_directory),
+            std::format("Unable to open: '{}'", path_));
+    }
+
+    std::array<char, 8> magic {};
+    uint32_t version = 0;
+    uint32_t reserved = 0;
+    uint64_t treeMinBytes = 0;
+    uint64_t numFiles = 0;
+
+    if (!in.get(magic.data(), magic.size()) || magic != MAGIC || !in.get(version) ||
+        !in.get(reserved) || !in.get(treeMinBytes) || !in.get(numFiles))
+    {
+        throw std::runtime_error(std::format("Not a manifest: '{}'", path_));
+    }
+
+    if (version != VERSION)
+    {
+        throw std::runtime_error(
+            std::format("Unsupported manifest version {}: '{}'", version, path_));
+    }
+
+    // The SHA256 of a large file and its tree digest never match
+    if (treeMinBytes != opts.treeHashMinBytes)
+    {
+        throw std::runtime_error(
+            std::format("The manifest has tree digests of the files of {} bytes and "
+                        "more, the detection of the ones of {} bytes: '{}'",
+                        treeMinBytes,
+                        opts.treeHashMinBytes,
+                        path_));
+    }
+
+    auto damaged = [this]() {
+        return std::runtime_error(std::format("Damaged manifest: '{}'", path_));
+    };
+
+    std::vector<std::pair<fs::path, FileMeta>> files;
+    std::u8string curr;
+
+    // The count is not trusted to reserve the memory upfront
+    for (uint64_t i = 0; i < numFiles; ++i)
+    {
+        uint32_t shared = 0;
+        uint32_t suffix = 0;
+        uint64_t size = 0;
+        FileDigests digests;
+
+        if (!in.get(shared) || !in.get(suffix) || shared > curr.size() ||
+            suffix > MAX_PATH_LENGTH)
+        {
+            throw damaged();
+        }
+
+        curr.resize(shared + suffix);
+
+        if (!in.get(curr.data() + shared, suffix) || !in.get(size) ||
+            !in.get(digests.head) || !in.get(digests.tail) ||
+            !in.get(digests.sample) || !in.get(digests.sha256))
+        {
+            throw damaged();
+        }
+
+        auto path = virtualPath(path_, curr);
+
+        if (path.empty())
+        {
+            throw damaged();
+        }
+
+        files.emplace_back(std::move(path),
+                           FileMeta {.size = size, .digests = digests});
+    }
+
+    if (!in.eof())
+    {
+        throw damaged();
+    }
+
+    for (const auto& [path, meta] : files)
+    {
+        detector.addFile(path, meta);
+    }
+
+    spdlog::info("Manifest of {} files loaded: '{}'", files.size(), path_);
+    return files.size();
+}
+
+const fs::path& Manifest::path() const noexcept
+{
+    return path_;
+}
+
+} // namespace tools::dups
@@ -2,89 +2,135 @@
 #include <core/utils/Crypto.h>
 
 #include <filesystem>
-#include <cassert>
+#include <cstring>
+#include <stdexcept>
 
 namespace fs = std::filesystem;
 
 namespace tools::dups {
 namespace detail {
 
-void fullPathHelper(const Node* node, fs::path& dest)
-{
-    if (node != nullptr)
-    {
-        fullPathHelper(node->parent(), dest);
+// Size of the chunks of the name arena, in characters
+constexpr size_t CHUNK_SIZE = 64 * 1024;
 
-        if (node->parent() != nullptr)
-        {
-            dest /= node->name();
-        }
+// Initial number of slots of the hash tables, always a power of two
+constexpr size_t MIN_SLOTS = 64;
 
-        // if (!dest.empty() || (!node->name().empty() &&
-        //                       (node->name().native().size() != 2 ||
-        //                       node->name().native()[1] != ':')))
-        // {
-        //     dest.push_back(fs::path::preferred_separator);
-        // }
-    }
-}
-
-bool tryGetFileSize(const fs::path& p, size_t& size)
+bool tryGetFileSize(const fs::path& p, uint64_t& size)
 {
     std::error_code ec {};
     size = fs::file_size(p, ec);
     return !ec;
 }
 
+size_t mix(uint64_t key) noexcept
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+
+    return static_cast<size_t>(key);
+}
+
+size_t childHash(uint32_t parent, uint32_t nameId) noexcept
+{
+    return mix((uint64_t {parent} << 32) | nameId);
+}
+
+size_t nameHash(NodeTree::NameView name) noexcept
+{
+    return mix(std::hash<NodeTree::NameView> {}(name));
+}
+
 } // namespace detail
 
-Node::Node(const fs::path* name, Node* parent)
-    : name_(name)
-    , parent_(parent)
-    , depth_(parent ? parent->depth() + 1 : 0)
+Node::Node(NodeTree* tree, uint32_t index) noexcept
+    : tree_(tree)
+    , index_(index)
 {
-    assert(name_ != nullptr);
 }
 
-const fs::path& Node::name() const noexcept
+fs::path Node::name() const
 {
-    return *name_;
+    return fs::path(tree_->names_[tree_->nameId_[index_]]);
 }
 
 Node* Node::parent() const noexcept
 {
-    return parent_;
+    const auto parent = tree_->parent_[index_];
+
+    return parent != NodeTree::NONE ? &tree_->nodes_[parent] : nullptr;
 }
 
 bool Node::leaf() const noexcept
 {
-    return children_.empty();
+    return tree_->firstChild_[index_] == NodeTree::NONE;
 }
 
 size_t Node::size() const noexcept
 {
-    return size_;
+    return static_cast<size_t>(tree_->size_[index_]);
+}
+
+void Node::setSize(size_t size) noexcept
+{
+    // Unsigned arithmetic wraps around, adding the difference works for shrinking
+    // files as well
+    const uint64_t diff = size - tree_->size_[index_];
+
+    for (auto i = index_; i != NodeTree::NONE; i = tree_->parent_[i])
+    {
+        tree_->size_[i] += diff;
+    }
 }
 
 uint16_t Node::depth() const noexcept
 {
-    return depth_;
+    return tree_->depth_[index_];
 }
 
-const std::string& Node::sha256() const
+const FileId& Node::id() const noexcept
 {
-    if (sha256_.empty())
-    {
-        sha256_ = core::crypto::fileSha256(fullPath());
-    }
+    return tree_->id_[index_];
+}
+
+void Node::setId(const FileId& id) noexcept
+{
+    tree_->id_[index_] = id;
+}
+
+int64_t Node::mtime() const noexcept
+{
+    return tree_->mtime_[index_];
+}
+
+void Node::setMtime(int64_t mtime) noexcept
+{
+    tree_->mtime_[index_] = mtime;
+}
 
-    return sha256_;
+const Node::Digest& Node::sha256() const
+{
+    return sha256([](const fs::path& file) {
+        return core::crypto::fileDigest(file, core::crypto::DigestType::Sha256);
+    });
+}
+
+const Node::Digest& Node::sha256(const DigestFunction& digest) const
+{
+    auto& sha256 = tree_->digest_[index_];
+
+    std::call_once(tree_->digestOnce_[index_], [this, &sha256, &digest] {
+        sha256 = digest(fullPath());
+    });
+
+    return sha256;
 }
 
 void Node::fullPath(fs::path& path) const
 {
     path.clear();
-    detail::fullPathHelper(this, path);
+    appendPath(path);
 }
 
 fs::path Node::fullPath() const
@@ -97,84 +143,99 @@ fs::path Node::fullPath() const
 
 bool Node::hasChild(const fs::path& name) const
 {
-    auto it = children_.find(&name);
+    const auto nameId = tree_->findName(name.native());
 
-    return it != children_.end();
+    return nameId != NodeTree::NONE &&
+           tree_->findChild(index_, nameId) != NodeTree::NONE;
 }
 
 Node* Node::addChild(const fs::path& name)
 {
-    auto [it, ok] = children_.emplace(&name, nullptr);
-
-    if (ok)
-    {
-        it->second = std::make_unique<Node>(it->first, this);
-    }
-
-    return it->second.get();
+    return &tree_->nodes_[tree_->addChild(index_, name.native())];
 }
 
 void Node::enumLeafs(const ConstNodeCallback& cb) const
 {
-    if (children_.empty())
+    const auto& tree = *tree_;
+
+    if (leaf())
     {
         cb(this);
     }
 
-    for (const auto& it : children_)
+    for (auto i = tree.firstChild_[index_]; i != NodeTree::NONE;
+         i = tree.nextSibling_[i])
     {
-        const Node* node = it.second.get();
-        node->enumLeafs(cb);
+        const Node& child = tree.nodes_[i];
+        child.enumLeafs(cb);
     }
 }
 
 void Node::enumLeafs(const MutableNodeCallback& cb)
 {
-    if (children_.empty())
+    auto& tree = *tree_;
+
+    if (leaf())
     {
         cb(this);
     }
 
-    for (auto& it : children_)
+    for (auto i = tree.firstChild_[index_]; i != NodeTree::NONE;
+         i = tree.nextSibling_[i])
     {
-        Node* child = it.second.get();
-        child->enumLeafs(cb);
+        tree.nodes_[i].enumLeafs(cb);
     }
 }
 
 void Node::enumNodes(const ConstNodeCallback& cb) const
 {
+    const auto& tree = *tree_;
+
     cb(this);
 
     // Non-leafs
-    for (const auto& it : children_)
+    for (auto i = tree.firstChild_[index_]; i != NodeTree::NONE;
+         i = tree.nextSibling_[i])
     {
-        const Node* node = it.second.get();
-        if (!node->leaf())
+        const Node& child = tree.nodes_[i];
+        if (!child.leaf())
         {
-            node->enumNodes(cb);
+            child.enumNodes(cb);
         }
     }
 
     // Leafs
-    for (const auto& it : children_)
+    for (auto i = tree.firstChild_[index_]; i != NodeTree::NONE;
+         i = tree.nextSibling_[i])
     {
-        const Node* node = it.second.get();
-        if (node->leaf())
+        const Node& child = tree.nodes_[i];
+        if (child.leaf())
         {
-            node->enumNodes(cb);
+            child.enumNodes(cb);
         }
     }
 }
 
+void Node::enumChildren(const ConstNodeCallback& cb) const
+{
+    const auto& tree = *tree_;
+
+    for (auto i = tree.firstChild_[index_]; i != NodeTree::NONE;
+         i = tree.nextSibling_[i])
+    {
+        cb(&tree.nodes_[i]);
+    }
+}
+
 size_t Node::nodesCount() const noexcept
 {
+    const auto& tree = *tree_;
     size_t count = 0;
 
-    for (const auto& it : children_)
+    for (auto i = tree.firstChild_[index_]; i != NodeTree::NONE;
+         i = tree.nextSibling_[i])
     {
-        const auto& child = it.second;
-        count += child->nodesCount();
+        count += tree.nodes_[i].nodesCount();
     }
 
     return count + 1;
@@ -187,12 +248,13 @@ size_t Node::leafsCount() const noexcept
         return 1;
     }
 
+    const auto& tree = *tree_;
     size_t count = 0;
 
-    for (const auto& it : children_)
+    for (auto i = tree.firstChild_[index_]; i != NodeTree::NONE;
+         i = tree.nextSibling_[i])
     {
-        const auto& child = it.second;
-        count += child->leafsCount();
+        count += tree.nodes_[i].leafsCount();
     }
 
     return count;
@@ -201,35 +263,256 @@ size_t Node::leafsCount() const noexcept
 void Node::update(const UpdateCallback& cb)
 {
     fs::path p;
-    updateHelper(cb, this, p);
+    updateHelper(cb, p);
 }
 
-void Node::updateHelper(const UpdateCallback& cb, Node* node, fs::path& p)
+void Node::appendPath(fs::path& path) const
 {
-    if (node == nullptr)
+    const auto parent = tree_->parent_[index_];
+
+    // The name of the root is not part of the path
+    if (parent != NodeTree::NONE)
     {
-        return;
+        tree_->nodes_[parent].appendPath(path);
+        path /= tree_->names_[tree_->nameId_[index_]];
     }
+}
+
+void Node::updateHelper(const UpdateCallback& cb, fs::path& p)
+{
+    auto& tree = *tree_;
 
-    if (node->children_.empty())
+    if (leaf())
     {
-        p.clear();
-        node->fullPath(p);
-        detail::tryGetFileSize(p, node->size_);
-        cb(node);
+        // The files which can't be queried, like the ones of other hosts, keep the
+        // size they have
+        fullPath(p);
+        if (uint64_t size = 0; detail::tryGetFileSize(p, size))
+        {
+            tree.size_[index_] = size;
+        }
+        cb(this);
         return;
     }
 
-    node->size_ = 0;
-    node->sha256_.clear();
+    tree.size_[index_] = 0;
+    tree.digest_[index_] = {};
 
-    for (auto& it : node->children_)
+    for (auto i = tree.firstChild_[index_]; i != NodeTree::NONE;
+         i = tree.nextSibling_[i])
     {
-        Node* child = it.second.get();
+        tree.nodes_[i].updateHelper(cb, p);
+        tree.size_[index_] += tree.size_[i];
+    }
+}
+
+NodeTree::NodeTree(const fs::path& rootName)
+{
+    parent_.push_back(NONE);
+    firstChild_.push_back(NONE);
+    lastChild_.push_back(NONE);
+    nextSibling_.push_back(NONE);
+    nameId_.push_back(internName(rootName.native()));
+    depth_.push_back(0);
+    size_.push_back(0);
+    id_.emplace_back();
+    mtime_.push_back(0);
+    digest_.emplace_back();
+    digestOnce_.emplace_back();
+    nodes_.push_back(Node(this, 0));
+}
 
-        updateHelper(cb, child, p);
-        node->size_ += child->size();
+Node& NodeTree::root() noexcept
+{
+    return nodes_.front();
+}
+
+const Node& NodeTree::root() const noexcept
+{
+    return nodes_.front();
+}
+
+size_t NodeTree::size() const noexcept
+{
+    return nodes_.size();
+}
+
+uint32_t NodeTree::findName(NameView name) const noexcept
+{
+    if (nameSlots_.empty())
+    {
+        return NONE;
+    }
+
+    const auto mask = nameSlots_.size() - 1;
+
+    for (auto i = detail::nameHash(name) & mask; nameSlots_[i] != 0;
+         i = (i + 1) & mask)
+    {
+        const auto nameId = nameSlots_[i] - 1;
+        if (names_[nameId] == name)
+        {
+            return nameId;
+        }
+    }
+
+    return NONE;
+}
+
+uint32_t NodeTree::internName(NameView name)
+{
+    if (const auto nameId = findName(name); nameId != NONE)
+    {
+        return nameId;
+    }
+
+    using Char = fs::path::value_type;
+    Char* dest = nullptr;
+
+    if (name.size() > detail::CHUNK_SIZE)
+    {
+        // Names that long are exotic, they get a chunk of their own
+        chunks_.push_back(std::make_unique_for_overwrite<Char[]>(name.size()));
+        chunkFree_ = 0;
+        dest = chunks_.back().get();
+    }
+    else
+    {
+        if (chunks_.empty() || name.size() > chunkFree_)
+        {
+            chunks_.push_back(
+                std::make_unique_for_overwrite<Char[]>(detail::CHUNK_SIZE));
+            chunkFree_ = detail::CHUNK_SIZE;
+        }
+
+        dest = chunks_.back().get() + (detail::CHUNK_SIZE - chunkFree_);
+        chunkFree_ -= name.size();
+    }
+
+    std::memcpy(dest, name.data(), name.size() * sizeof(Char));
+
+    const auto nameId = static_cast<uint32_t>(names_.size());
+    names_.emplace_back(dest, name.size());
+
+    if ((names_.size() * 2) > nameSlots_.size())
+    {
+        nameSlots_.assign(std::max(detail::MIN_SLOTS, nameSlots_.size() * 2), 0);
+        for (uint32_t i = 0; i < names_.size(); ++i)
+        {
+            insertNameSlot(i);
+        }
+    }
+    else
+    {
+        insertNameSlot(nameId);
+    }
+
+    return nameId;
+}
+
+uint32_t NodeTree::findChild(uint32_t parent, uint32_t nameId) const noexcept
+{
+    if (childSlots_.empty())
+    {
+        return NONE;
+    }
+
+    const auto mask = childSlots_.size() - 1;
+
+    for (auto i = detail::childHash(parent, nameId) & mask; childSlots_[i] != 0;
+         i = (i + 1) & mask)
+    {
+        const auto index = childSlots_[i] - 1;
+        if (parent_[index] == parent && nameId_[index] == nameId)
+        {
+            return index;
+        }
+    }
+
+    return NONE;
+}
+
+uint32_t NodeTree::addChild(uint32_t parent, NameView name)
+{
+    const auto nameId = internName(name);
+
+    if (const auto index = findChild(parent, nameId); index != NONE)
+    {
+        return index;
+    }
+
+    if (nodes_.size() >= NONE)
+    {
+        throw std::length_error("Too many nodes in the tree");
+    }
+
+    const auto index = static_cast<uint32_t>(nodes_.size());
+
+    parent_.push_back(parent);
+    firstChild_.push_back(NONE);
+    lastChild_.push_back(NONE);
+    nextSibling_.push_back(NONE);
+    nameId_.push_back(nameId);
+    depth_.push_back(static_cast<uint16_t>(depth_[parent] + 1));
+    size_.push_back(0);
+    id_.emplace_back();
+    mtime_.push_back(0);
+    digest_.emplace_back();
+    digestOnce_.emplace_back();
+    nodes_.push_back(Node(this, index));
+
+    // Children are appended, so they are enumerated in the order of insertion
+    if (lastChild_[parent] == NONE)
+    {
+        firstChild_[parent] = index;
+    }
+    else
+    {
+        nextSibling_[lastChild_[parent]] = index;
+    }
+    lastChild_[parent] = index;
+
+    // The root is not a child of any node, so it never occupies a slot
+    if ((nodes_.size() * 2) > childSlots_.size())
+    {
+        childSlots_.assign(std::max(detail::MIN_SLOTS, childSlots_.size() * 2), 0);
+        for (uint32_t i = 1; i < nodes_.size(); ++i)
+        {
+            insertChildSlot(i);
+        }
+    }
+    else
+    {
+        insertChildSlot(index);
+    }
+
+    return index;
+}
+
+void NodeTree::insertChildSlot(uint32_t index) noexcept
+{
+    const auto mask = childSlots_.size() - 1;
+    auto i = detail::childHash(parent_[index], nameId_[index]) & mask;
+
+    while (childSlots_[i] != 0)
+    {
+        i = (i + 1) & mask;
+    }
+
+    childSlots_[i] = index + 1;
+}
+
+void NodeTree::insertNameSlot(uint32_t nameId) noexcept
+{
+    const auto mask = nameSlots_.size() - 1;
+    auto i = detail::nameHash(names_[nameId]) & mask;
+
+    while (nameSlots_[i] != 0)
+    {
+        i = (i + 1) & mask;
     }
+
+    nameSlots_[i] = nameId + 1;
 }
 
 } // namespace tools::dups
@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+
+#include <duplicates/Checkpoint.h>
+#include <duplicates/DuplicateDetector.h>
+#include <core/utils/File.h>
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+
+using namespace core;
+
+namespace tools::dups {
+namespace {
+
+std::vector<std::string> listFiles(const DuplicateDetector& dd)
+{
+    std::vector<std::string> files;
+
+    dd.root()->enumLeafs([&files](const Node* node) {
+        files.push_back(std::format("{} {} {} {}",
+                                    file::path2s(node->fullPath()),
+                                    node->id().inode,
+                                    node->size(),
+                                    node->mtime()));
+    });
+
+    return files;
+}
+
+DetectionState makeState()
+{
+    return {
+        .stage = Stage::Tail,
+        .groups = {{0, 2}, {1, 3, 4}},
+        .compared = {{5, 6}},
+        .comparedDigests = {{7, 8, 9}},
+        .digests = {{1, {1, 2, 3}}, {4, {4, 5, 6}}},
+    };
+}
+
+bool operator==(const DetectionState& a, const DetectionState& b)
+{
+    return a.stage == b.stage && a.groups == b.groups && a.compared == b.compared &&
+           a.comparedDigests == b.comparedDigests && a.digests == b.digests;
+}
+
+} // namespace
+
+TEST(CheckpointTest, FilesAreRestoredInTheSameOrder)
+{
+    file::TempDir dir("checkpoint");
+
+    // The paths don't have to exist
+    DuplicateDetector dd;
+    dd.addFile("/data/photos/a.jpg", {.id = {1, 10}, .size = 100, .mtime = 1000});
+    dd.addFile("/data/photos/b.jpg", {.id = {1, 11}, .size = 200});
+    dd.addFile("/data/music/c.mp3", {.id = {1, 12}, .size = 300});
+    dd.addFile("/data/photos/sub/d.jpg", {.id = {1, 13}, .size = 400});
+    dd.addFile("/other/e.txt");
+    dd.addIncompleteDir("/data/photos/sub");
+    dd.addIncompleteDir("/data/video");
+
+    Checkpoint checkpoint(dir.path(), {1});
+    checkpoint.saveFiles(dd);
+
+    DuplicateDetector restored;
+    ASSERT_TRUE(checkpoint.loadFiles(restored));
+    EXPECT_EQ(restored.numFiles(), dd.numFiles());
+    EXPECT_EQ(listFiles(restored), listFiles(dd));
+    EXPECT_EQ(restored.incompleteDirs(), dd.incompleteDirs());
+
+    // A different scan doesn't load them
+    DuplicateDetector other;
+    EXPECT_FALSE(Checkpoint(dir.path(), {2}).loadFiles(other));
+    EXPECT_EQ(other.numFiles(), 0U);
+}
+
+TEST(CheckpointTest, StateOfTheSameScanIsRestored)
+{
+    file::TempDir dir("checkpoint");
+    Checkpoint checkpoint(dir.path(), {1});
+    const auto state = makeState();
+
+    DetectionState loaded;
+    EXPECT_FALSE(checkpoint.loadState(7, loaded));
+
+    checkpoint.saveState(7, state);
+    ASSERT_TRUE(checkpoint.loadState(7, loaded));
+    EXPECT_TRUE(loaded == state);
+
+    // The state of a different number of files or a different scan doesn't apply
+    EXPECT_FALSE(checkpoint.loadState(8, loaded));
+    EXPECT_FALSE(Checkpoint(dir.path(), {2}).loadState(7, loaded));
+
+    // New files invalidate the state
+    DuplicateDetector dd;
+    checkpoint.saveFiles(dd);
+    EXPECT_FALSE(checkpoint.loadState(7, loaded));
+}
+
+TEST(CheckpointTest, ChangedFilesAreDroppedFromTheState)
+{
+    file::TempDir dir("checkpoint");
+    const auto data = dir.path() / "data";
+    fs::create_directories(data);
+
+    // Added the way the scan adds them
+    DuplicateDetector dd;
+    for (const auto* name : {"a", "b", "c", "d", "e"})
+    {
+        file::write(data / name, "content");
+
+        file::FileInfo info;
+        std::error_code ec;
+        ASSERT_TRUE(file::fileInfo(data / name, info, ec));
+        dd.addFile(data / name,
+                   {.id = {info.device, info.inode},
+                    .size = info.size,
+                    .mtime = info.mtime});
+    }
+
+    std::vector<fs::path> paths;
+    dd.enumFiles([&paths](const fs::path& path) {
+        paths.push_back(path);
+    });
+    auto id = [&paths, &data](const char* name) {
+        return static_cast<uint32_t>(std::ranges::find(paths, data / name) -
+                                     paths.begin());
+    };
+
+    Checkpoint checkpoint(dir.path() / "checkpoint", {1});
+    checkpoint.saveFiles(dd);
+    checkpoint.saveState(paths.size(),
+                         {
+                             .stage = Stage::Head,
+                             .groups = {{id("a"), id("b"), id("c")},
+                                        {id("d"), id("e")}},
+                             .compared = {{id("a"), id("b")}, {id("c"), id("e")}},
+                             .comparedDigests = {{1}, {2}},
+                             .digests = {{id("a"), {3}}, {id("c"), {4}}},
+                         });
+
+    // Modified in place with the same size, and removed
+    file::write(data / "c", "changed");
+    fs::last_write_time(data / "c",
+                        fs::last_write_time(data / "c") + std::chrono::hours(1));
+    fs::remove(data / "d");
+
+    DuplicateDetector restored;
+    ASSERT_TRUE(checkpoint.loadFiles(restored));
+
+    DetectionState loaded;
+    ASSERT_TRUE(checkpoint.loadState(restored, loaded));
+    EXPECT_TRUE(loaded == (DetectionState {
+                              .stage = Stage::Head,
+                              .groups = {{id("a"), id("b")}},
+                              .compared = {{id("a"), id("b")}},
+                              .comparedDigests = {{1}},
+                              .digests = {{id("a"), {3}}},
+                          }));
+}
+
+TEST(CheckpointTest, DamagedStateIsIgnored)
+{
+    file::TempDir dir("checkpoint");
+    Checkpoint checkpoint(dir.path(), {1});
+    checkpoint.saveState(7, makeState());
+
+    // Files out of range
+    DetectionState loaded;
+    EXPECT_FALSE(checkpoint.loadState(4, loaded));
+
+    // Truncated
+    fs::resize_file(checkpoint.statePath(), fs::file_size(checkpoint.statePath()) - 1);
+    EXPECT_FALSE(checkpoint.loadState(7, loaded));
+}
+
+} // namespace tools::dups
@@ -51,6 +51,29 @@ TEST_F(SilentConfig, ScanDirOption)
     EXPECT_EQ(cfg.scanDirs().size(), 2U);
 }
 
+TEST_F(SilentConfig, BackupDirOption)
+{
+    auto result =
+        parse({"duplicates", "--scan-dir", "/tmp/a", "--backup-dir", "/tmp/b"});
+    populateConfig(result, cfg);
+    EXPECT_EQ(cfg.scanDirs().size(), 1U);
+    ASSERT_EQ(cfg.backupDirs().size(), 1U);
+}
+
+TEST_F(SilentConfig, ManifestOptions)
+{
+    auto result = parse({"duplicates",
+                         "--manifest",
+                         "/tmp/a.dupm",
+                         "--manifest",
+                         "/tmp/b.dupm",
+                         "--export-manifest",
+                         "/tmp/this.dupm"});
+    populateConfig(result, cfg);
+    EXPECT_EQ(cfg.manifests().size(), 2U);
+    EXPECT_EQ(cfg.exportManifestPath().filename(), "this.dupm");
+}
+
 TEST_F(SilentConfig, DryRunOption)
 {
     auto result = parse({"duplicates", "--dry-run"});
@@ -72,6 +95,97 @@ TEST_F(SilentConfig, MaxSizeOption)
     EXPECT_EQ(cfg.maxFileSizeBytes(), 1000000U);
 }
 
+TEST_F(SilentConfig, HashWorkersOption)
+{
+    auto result = parse({"duplicates", "--hash-workers", "8"});
+    populateConfig(result, cfg);
+    EXPECT_EQ(cfg.hashWorkers(), 8U);
+}
+
+TEST_F(SilentConfig, DeviceWorkersOptions)
+{
+    auto result =
+        parse({"duplicates", "--hdd-workers", "2", "--ssd-workers", "12"});
+    populateConfig(result, cfg);
+    EXPECT_EQ(cfg.hddWorkers(), 2U);
+    EXPECT_EQ(cfg.ssdWorkers(), 12U);
+}
+
+TEST_F(SilentConfig, PhysicalOrderOption)
+{
+    auto result = parse({"duplicates", "--physical-order=false"});
+    populateConfig(result, cfg);
+    EXPECT_FALSE(cfg.physicalOrder());
+}
+
+TEST_F(SilentConfig, CheckpointOptions)
+{
+    auto result = parse({"duplicates", "--checkpoint-interval", "5", "--resume"});
+    populateConfig(result, cfg);
+    EXPECT_EQ(cfg.checkpointInterval(), std::chrono::seconds(5));
+    EXPECT_TRUE(cfg.resume());
+}
+
+TEST_F(SilentConfig, StreamOption)
+{
+    auto result = parse({"duplicates", "--stream"});
+    populateConfig(result, cfg);
+    EXPECT_TRUE(cfg.streamGroups());
+}
+
+TEST_F(SilentConfig, DirGroupsOption)
+{
+    auto result = parse({"duplicates", "--dir-groups"});
+    populateConfig(result, cfg);
+    EXPECT_TRUE(cfg.directoryGroups());
+}
+
+TEST_F(SilentConfig, StatsFileOption)
+{
+    auto result = parse({"duplicates"});
+    populateConfig(result, cfg);
+    EXPECT_TRUE(cfg.statsFilePath().empty());
+
+    result = parse({"duplicates", "--stats-file", "stats.json"});
+    populateConfig(result, cfg);
+    EXPECT_EQ(cfg.statsFilePath(), cfg.dataDir() / "stats.json");
+}
+
+TEST_F(SilentConfig, HashCacheOption)
+{
+    auto result = parse({"duplicates", "--hash-cache=false"});
+    populateConfig(result, cfg);
+    EXPECT_FALSE(cfg.hashCache());
+}
+
+TEST_F(SilentConfig, CompareMaxFilesOption)
+{
+    auto result = parse({"duplicates", "--compare-max-files", "0"});
+    populateConfig(result, cfg);
+    EXPECT_EQ(cfg.compareMaxFiles(), 0U);
+}
+
+TEST_F(SilentConfig, ReadBufferOption)
+{
+    auto result = parse({"duplicates", "--read-buffer", "262144"});
+    populateConfig(result, cfg);
+    EXPECT_EQ(cfg.readBufferBytes(), 262144U);
+}
+
+TEST_F(SilentConfig, TreeHashMinOption)
+{
+    auto result = parse({"duplicates", "--tree-hash-min", "0"});
+    populateConfig(result, cfg);
+    EXPECT_EQ(cfg.treeHashMinBytes(), 0U);
+}
+
+TEST_F(SilentConfig, ReadBackendOption)
+{
+    auto result = parse({"duplicates", "--read-backend", "io_uring"});
+    populateConfig(result, cfg);
+    EXPECT_EQ(cfg.readBackend(), ReadBackend::IoUring);
+}
+
 TEST_F(SilentConfig, UpdateFreqOption)
 {
     auto result = parse({"duplicates", "--update-freq", "500"});
@@ -7,6 +7,7 @@
 #include <core/utils/LogCapture.h>
 
 #include <chrono>
+#include <stdexcept>
 
 namespace tools::dups {
 
@@ -55,6 +56,37 @@ TEST(ConfigTest, SetScanDirsReplacesExisting)
     EXPECT_EQ(cfg.scanDirs().size(), 2U);
 }
 
+TEST(ConfigTest, AddBackupDirNormalizesPath)
+{
+    Config cfg("/data", "/cache");
+    EXPECT_TRUE(cfg.backupDirs().empty());
+    cfg.addBackupDir("backup/foo/../bar");
+
+    ASSERT_EQ(cfg.backupDirs().size(), 1U);
+    EXPECT_EQ(cfg.backupDirs().front(), NORM_PATH / "backup/bar");
+
+    cfg.setBackupDirs({"/b", "/c"});
+    EXPECT_EQ(cfg.backupDirs().size(), 2U);
+}
+
+TEST(ConfigTest, ManifestPathsAreNormalized)
+{
+    Config cfg("/data", "/cache");
+    EXPECT_TRUE(cfg.manifests().empty());
+    EXPECT_TRUE(cfg.exportManifestPath().empty());
+
+    cfg.addManifest("hosts/../other.dupm");
+    ASSERT_EQ(cfg.manifests().size(), 1U);
+    EXPECT_EQ(cfg.manifests().front(), NORM_PATH / "other.dupm");
+
+    // Not moved to the data directory
+    cfg.setExportManifestPath("out/this.dupm");
+    EXPECT_EQ(cfg.exportManifestPath(), NORM_PATH / "out/this.dupm");
+
+    cfg.setExportManifestPath("");
+    EXPECT_TRUE(cfg.exportManifestPath().empty());
+}
+
 // ─── keep / delete dirs ───────────────────────────────────────────────────────
 
 TEST(ConfigTest, AddDirToKeepFrom)
@@ -141,6 +173,104 @@ TEST(ConfigTest, FileSizeBounds)
     EXPECT_EQ(cfg.maxFileSizeBytes(), 1024UL * 1024);
 }
 
+TEST(ConfigTest, HashWorkers)
+{
+    Config cfg("/data", "/cache");
+    EXPECT_EQ(cfg.hashWorkers(), 0U);
+    cfg.setHashWorkers(6);
+    EXPECT_EQ(cfg.hashWorkers(), 6U);
+}
+
+TEST(ConfigTest, DeviceWorkers)
+{
+    Config cfg("/data", "/cache");
+    EXPECT_EQ(cfg.hddWorkers(), 1U);
+    EXPECT_EQ(cfg.ssdWorkers(), 0U);
+    cfg.setHddWorkers(2);
+    cfg.setSsdWorkers(16);
+    EXPECT_EQ(cfg.hddWorkers(), 2U);
+    EXPECT_EQ(cfg.ssdWorkers(), 16U);
+}
+
+TEST(ConfigTest, PhysicalOrder)
+{
+    Config cfg("/data", "/cache");
+    EXPECT_TRUE(cfg.physicalOrder());
+    cfg.setPhysicalOrder(false);
+    EXPECT_FALSE(cfg.physicalOrder());
+}
+
+TEST(ConfigTest, Checkpoints)
+{
+    Config cfg("/data", "/cache");
+    EXPECT_EQ(cfg.checkpointInterval(), std::chrono::seconds(60));
+    EXPECT_FALSE(cfg.resume());
+    cfg.setCheckpointInterval(std::chrono::seconds(0));
+    cfg.setResume(true);
+    EXPECT_EQ(cfg.checkpointInterval(), std::chrono::seconds(0));
+    EXPECT_TRUE(cfg.resume());
+}
+
+TEST(ConfigTest, StreamGroups)
+{
+    Config cfg("/data", "/cache");
+    EXPECT_FALSE(cfg.streamGroups());
+    cfg.setStreamGroups(true);
+    EXPECT_TRUE(cfg.streamGroups());
+}
+
+TEST(ConfigTest, DirectoryGroups)
+{
+    Config cfg("/data", "/cache");
+    EXPECT_FALSE(cfg.directoryGroups());
+    cfg.setDirectoryGroups(true);
+    EXPECT_TRUE(cfg.directoryGroups());
+}
+
+TEST(ConfigTest, HashCache)
+{
+    Config cfg("/data", "/cache");
+    EXPECT_TRUE(cfg.hashCache());
+    cfg.setHashCache(false);
+    EXPECT_FALSE(cfg.hashCache());
+}
+
+TEST(ConfigTest, CompareMaxFiles)
+{
+    Config cfg("/data", "/cache");
+    EXPECT_EQ(cfg.compareMaxFiles(), 4U);
+    cfg.setCompareMaxFiles(0);
+    EXPECT_EQ(cfg.compareMaxFiles(), 0U);
+}
+
+TEST(ConfigTest, ReadBufferBytes)
+{
+    Config cfg("/data", "/cache");
+    EXPECT_EQ(cfg.readBufferBytes(), 1024U * 1024);
+    cfg.setReadBufferBytes(64 * 1024);
+    EXPECT_EQ(cfg.readBufferBytes(), 64U * 1024);
+}
+
+TEST(ConfigTest, TreeHashMinBytes)
+{
+    Config cfg("/data", "/cache");
+    EXPECT_EQ(cfg.treeHashMinBytes(), 1024ULL * 1024 * 1024);
+    cfg.setTreeHashMinBytes(0);
+    EXPECT_EQ(cfg.treeHashMinBytes(), 0U);
+}
+
+TEST(ConfigTest, ReadBackend)
+{
+    Config cfg("/data", "/cache");
+    EXPECT_EQ(cfg.readBackend(), ReadBackend::Threads);
+    cfg.setReadBackend(ReadBackend::IoUring);
+    EXPECT_EQ(cfg.readBackend(), ReadBackend::IoUring);
+
+    EXPECT_EQ(str2backend("io_uring"), ReadBackend::IoUring);
+    EXPECT_EQ(str2backend(backend2str(ReadBackend::Threads)), ReadBackend::Threads);
+    EXPECT_THROW(str2backend("aio"), std::invalid_argument);
+}
+
 TEST(ConfigTest, UpdateFrequency)
 {
     Config cfg("/data", "/cache");
@@ -169,6 +299,7 @@ TEST(ConfigTest, ApplyDefaultsSetsExpectedValues)
     EXPECT_FALSE(cfg.allFilesPath().empty());
     EXPECT_FALSE(cfg.dupFilesPath().empty());
     EXPECT_FALSE(cfg.ignFilesPath().empty());
+    EXPECT_TRUE(cfg.statsFilePath().empty());
 }
 
 // ─── missing path setters / getters ──────────────────────────────────────────
@@ -235,6 +366,19 @@ TEST(ConfigTest, ApplyOverridesReadsTomlValues)
     core::file::write(cfgFile,
         "min_file_size_bytes = 2048\n"
         "max_file_size_bytes = 999999\n"
+        "hash_workers = 3\n"
+        "hdd_workers = 2\n"
+        "ssd_workers = 8\n"
+        "physical_order = false\n"
+        "checkpoint_interval_sec = 300\n"
+        "resume = true\n"
+        "stream_groups = true\n"
+        "dir_groups = true\n"
+        "hash_cache = false\n"
+        "compare_max_files = 2\n"
+        "read_buffer_bytes = 65536\n"
+        "read_backend = \"io_uring\"\n"
+        "tree_hash_min_bytes = 4096\n"
         "dry_run = false\n"
         "scan_directories = [\"/tmp/scans\"]\n"
         "exclusion_patterns = [\"pattern\"]\n"
@@ -251,6 +395,19 @@ TEST(ConfigTest, ApplyOverridesReadsTomlValues)
 
     EXPECT_EQ(cfg.minFileSizeBytes(), 2048U);
     EXPECT_EQ(cfg.maxFileSizeBytes(), 999999U);
+    EXPECT_EQ(cfg.hashWorkers(), 3U);
+    EXPECT_EQ(cfg.hddWorkers(), 2U);
+    EXPECT_EQ(cfg.ssdWorkers(), 8U);
+    EXPECT_FALSE(cfg.physicalOrder());
+    EXPECT_EQ(cfg.checkpointInterval(), std::chrono::seconds(300));
+    EXPECT_TRUE(cfg.resume());
+    EXPECT_TRUE(cfg.streamGroups());
+    EXPECT_TRUE(cfg.directoryGroups());
+    EXPECT_FALSE(cfg.hashCache());
+    EXPECT_EQ(cfg.compareMaxFiles(), 2U);
+    EXPECT_EQ(cfg.readBufferBytes(), 65536U);
+    EXPECT_EQ(cfg.readBackend(), ReadBackend::IoUring);
+    EXPECT_EQ(cfg.treeHashMinBytes(), 4096U);
     EXPECT_FALSE(cfg.dryRun());
     EXPECT_EQ(cfg.scanDirs().size(), 1U);
     EXPECT_EQ(cfg.exclusionPatterns().size(), 1U);
@@ -263,8 +420,12 @@ TEST(ConfigTest, ApplyOverridesReadsDirAndFilePaths)
     core::file::write(cfgFile,
         "dirs_to_keep_from   = [\"keep/a\"]\n"
         "dirs_to_delete_from = [\"delete/b\"]\n"
+        "backup_directories = [\"backup/c\"]\n"
+        "manifests = [\"hosts/other.dupm\"]\n"
+        "export_manifest = \"this.dupm\"\n"
         "all_files = \"custom_all.txt\"\n"
         "dup_files = \"custom_dup.txt\"\n"
+        "stats_file = \"custom_stats.json\"\n"
         "ign_files = \"custom_ign.txt\"\n"
         "scan_directories = []\n"
         "exclusion_patterns = []\n");
@@ -283,8 +444,16 @@ TEST(ConfigTest, ApplyOverridesReadsDirAndFilePaths)
     ASSERT_EQ(cfg.dirsToDeleteFrom().size(), 1U);
     EXPECT_EQ(cfg.dirsToDeleteFrom().front(), NORM_PATH / "delete/b");
 
+    ASSERT_EQ(cfg.backupDirs().size(), 1U);
+    EXPECT_EQ(cfg.backupDirs().front(), NORM_PATH / "backup/c");
+
+    ASSERT_EQ(cfg.manifests().size(), 1U);
+    EXPECT_EQ(cfg.manifests().front(), NORM_PATH / "hosts/other.dupm");
+    EXPECT_EQ(cfg.exportManifestPath(), NORM_PATH / "this.dupm");
+
     EXPECT_EQ(cfg.allFilesPath(), cfg.dataDir() / "custom_all.txt");
     EXPECT_EQ(cfg.dupFilesPath(), cfg.dataDir() / "custom_dup.txt");
+    EXPECT_EQ(cfg.statsFilePath(), cfg.dataDir() / "custom_stats.json");
     EXPECT_EQ(cfg.ignFilesPath(), cfg.dataDir() / "custom_ign.txt");
 }
 
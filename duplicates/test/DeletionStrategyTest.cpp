@@ -27,6 +27,38 @@ TEST(DeletionStrategyTest, PermanentDelete)
     EXPECT_FALSE(fs::exists(file));
 }
 
+TEST(DeletionStrategyTest, PermanentDeleteOfDirectory)
+{
+    MuteLogger mute;
+    file::TempDir data("dups");
+    PermanentDelete strategy;
+
+    const fs::path dir = data.path() / "dir";
+    fs::create_directories(dir / "sub");
+    file::write(dir / "sub" / "test.txt", "test content");
+
+    strategy.remove(dir);
+    EXPECT_FALSE(fs::exists(dir));
+}
+
+TEST(DeletionStrategyTest, BackupAndDeleteOfDirectory)
+{
+    MuteLogger mute;
+    file::TempDir data("dups");
+    const auto backupDir = data.path() / "backup";
+    BackupAndDelete strategy(backupDir);
+
+    const fs::path dir = data.path() / "dir";
+    fs::create_directories(dir / "sub");
+    file::write(dir / "sub" / "test.txt", "test content");
+
+    strategy.remove(dir);
+    EXPECT_FALSE(fs::exists(dir));
+
+    const auto hash = crypto::md5(file::path2s(data.path()));
+    EXPECT_TRUE(fs::exists(backupDir / hash / "dir" / "sub" / "test.txt"));
+}
+
 TEST(DeletionStrategyTest, BackupAndDelete)
 {
     MuteLogger mute;
@@ -47,7 +47,7 @@ void emulateDupGroups(const std::vector<PathsVec>& groupVec,
         entries.clear();
         for (const auto& p : grp)
         {
-            entries.emplace_back(p, 0, "n/a");
+            entries.emplace_back(p, 0, core::crypto::Digest {});
         }
 
         group.groupId = 0; // doesn't matter while emulating
@@ -403,4 +403,87 @@ TEST_F(DuplicateDeletionTest, DeleteDuplicates_SkipsIgnoredFiles)
     deleteDuplicates(groups, cfg);
 }
 
+TEST_F(DuplicateDeletionTest, DuplicatesDeleter_ProcessesGroupsOneByOne)
+{
+    cfg.deleteFromPaths().add(fs::path {"safeDir"});
+
+    std::vector<PathsVec> groupVec {
+        {fs::path("origDir/file1.txt"), fs::path("safeDir/file2.txt")},
+        {fs::path("origDir/file3.txt"), fs::path("safeDir/file4.txt")}};
+
+    EXPECT_CALL(strategy, remove(fs::path("safeDir/file2.txt"))).Times(1);
+    EXPECT_CALL(strategy, remove(fs::path("safeDir/file4.txt"))).Times(1);
+
+    // The groups are not known upfront
+    emulateDupGroups(groupVec, duplicatesDeleter(cfg));
+}
+
+TEST_F(DuplicateDeletionTest, RemoteFilesAreNeitherDeletedNorKept)
+{
+    MuteLogger mute;
+    cfg.keepFromPaths().add(fs::path {"nas.dupm"});
+    cfg.deleteFromPaths().add(fs::path {"photos/old"});
+
+    auto local = [](const char* path) {
+        return DupEntry {.file = path};
+    };
+    auto remote = [](const char* path) {
+        return DupEntry {.file = path, .remote = true};
+    };
+
+    // The only local copies stay, whatever the rules say about the remote ones
+    const std::vector<DupGroup> groups {
+        {.entires = {local("photos/a.jpg"), remote("nas.dupm/a.jpg")}},
+        {.entires = {local("photos/b copy.jpg"), remote("nas.dupm/b.jpg")}},
+        {.entires = {local("photos/old/c.jpg"), remote("nas.dupm/c.jpg")}},
+        {.entires = {local("photos/d(1).jpg"),
+                     remote("nas.dupm/d.jpg"),
+                     local("photos/d.jpg")}},
+    };
+
+    // The local copies are chosen from by the naming rule
+    EXPECT_CALL(strategy, remove(fs::path("photos/d(1).jpg"))).Times(1);
+
+    const auto deleter = duplicatesDeleter(cfg);
+    for (const auto& group : groups)
+    {
+        EXPECT_TRUE(deleter(group));
+    }
+}
+
+TEST_F(DuplicateDeletionTest, DirectoriesWithOtherContentAreNotDeleted)
+{
+    MuteLogger mute;
+    file::TempDir data("dups-deletion");
+    const auto& dir = data.path();
+
+    for (const auto* name : {"orig", "copy"})
+    {
+        fs::create_directories(dir / name / "sub");
+        file::write(dir / name / "sub" / "file", "content");
+    }
+
+    const DupGroup group {.entires = {
+                              {.file = dir / "orig", .size = 7, .directory = true},
+                              {.file = dir / "copy", .size = 7, .directory = true},
+                          }};
+    const auto deleter = duplicatesDeleter(cfg);
+
+    // The paths are listed sorted, the original is kept
+    in.str("2\n");
+    EXPECT_CALL(strategy, remove(dir / "copy")).Times(1);
+    EXPECT_TRUE(deleter(group));
+    testing::Mock::VerifyAndClearExpectations(&strategy);
+
+    // A file the detection didn't see, however small
+    EXPECT_CALL(strategy, remove(testing::_)).Times(0);
+    file::write(dir / "copy" / "small", "x");
+    EXPECT_TRUE(deleter(group));
+    fs::remove(dir / "copy" / "small");
+
+    // The same sizes under other names
+    fs::rename(dir / "copy" / "sub" / "file", dir / "copy" / "sub" / "other");
+    EXPECT_TRUE(deleter(group));
+}
+
 } // namespace tools::dups
@@ -2,15 +2,21 @@
 #include <gtest/gtest.h>
 
 #include <duplicates/DuplicateDetector.h>
+#include <duplicates/HashCache.h>
 #include <duplicates/Utils.h>
+#include <core/utils/Crypto.h>
 #include <core/utils/File.h>
 #include <core/utils/StopWatch.h>
 #include <core/utils/Str.h>
 #include <core/utils/Sys.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <limits>
+#include <map>
 #include <queue>
+#include <set>
+#include <stdexcept>
 #include <unordered_map>
 #include "duplicates/IDuplicates.h"
 #include "duplicates/Progress.h"
@@ -112,6 +118,25 @@ void addFiles(const FileDataMap& files, DuplicateDetector& dd)
     }
 }
 
+using GroupList = std::vector<std::vector<fs::path>>;
+
+GroupList collectGroups(const DuplicateDetector& dd)
+{
+    GroupList groups;
+
+    dd.enumGroups([&groups](const DupGroup& grp) {
+        auto& files = groups.emplace_back();
+        for (const auto& e : grp.entires)
+        {
+            files.push_back(e.file);
+        }
+        std::ranges::sort(files);
+        return true;
+    });
+
+    return groups;
+}
+
 } // namespace
 
 TEST(DuplicateDetectorTest, AddFiles)
@@ -202,6 +227,852 @@ TEST(DuplicateDetectorTest, DetectDuplicates)
 }
 
 
+TEST(DuplicateDetectorTest, GroupViewsReferToTheDetectedFiles)
+{
+    file::TempDir data("dups");
+    DuplicateDetector dd;
+
+    const auto files = getTestFiles(data.path());
+    createFiles(files);
+    addFiles(files, dd);
+    EXPECT_TRUE(dd.groups().empty());
+
+    dd.detect({}, defaultProgressCallback);
+    const auto groups = dd.groups();
+    ASSERT_EQ(groups.size(), 3U);
+
+    // The groups of the largest files first, the same as the copies
+    std::vector<DupGroup> copies;
+    dd.enumGroups([&copies](const DupGroup& grp) {
+        copies.push_back(grp);
+        return true;
+    });
+    ASSERT_EQ(copies.size(), groups.size());
+
+    const std::vector<size_t> expectedSizes {3, 2, 1};
+    const std::vector<size_t> expectedFiles {2, 3, 4};
+
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        const auto& view = groups[g];
+        const auto& copy = copies[g];
+
+        EXPECT_EQ(view.groupId, g + 1);
+        EXPECT_EQ(copy.groupId, view.groupId);
+        ASSERT_EQ(view.entries.size(), expectedFiles[g]);
+        ASSERT_EQ(copy.entires.size(), view.entries.size());
+
+        for (size_t i = 0; i < view.entries.size(); ++i)
+        {
+            const auto& e = view.entries[i];
+            const auto path = e.file();
+
+            EXPECT_EQ(e.size(), expectedSizes[g]);
+            EXPECT_EQ(crypto::toHex(e.sha256()), crypto::sha256(files.at(path)));
+            EXPECT_FALSE(e.link());
+            EXPECT_EQ(e.node()->fullPath(), path);
+
+            EXPECT_EQ(copy.entires[i].file, path);
+            EXPECT_EQ(copy.entires[i].size, e.size());
+            EXPECT_EQ(copy.entires[i].sha256, e.sha256());
+        }
+    }
+
+    dd.reset();
+    EXPECT_TRUE(dd.groups().empty());
+    EXPECT_EQ(dd.numGroups(), 0U);
+}
+
+TEST(DuplicateDetectorTest, EqualDirectoriesAreGroupedAsAWhole)
+{
+    file::TempDir data("dups");
+    const auto& dir = data.path();
+
+    // The directories `a` and `b` are equal, `c/x` equals their `x` and `d` has a
+    // renamed copy of one of their files
+    const std::map<fs::path, std::string> files {{dir / "a/x/1", "one"},
+                                                 {dir / "a/x/2", "two"},
+                                                 {dir / "a/y", "three"},
+                                                 {dir / "b/x/1", "one"},
+                                                 {dir / "b/x/2", "two"},
+                                                 {dir / "b/y", "three"},
+                                                 {dir / "c/x/1", "one"},
+                                                 {dir / "c/x/2", "two"},
+                                                 {dir / "c/u", "unique"},
+                                                 {dir / "d/2-copy", "two"}};
+    DuplicateDetector dd;
+
+    for (const auto& [file, content] : files)
+    {
+        fs::create_directories(file.parent_path());
+        file::write(file, content);
+        dd.addFile(file);
+    }
+
+    dd.detect({}, defaultProgressCallback);
+    EXPECT_EQ(dd.numGroups(), 3U);
+
+    dd.detect({.directoryGroups = true}, defaultProgressCallback);
+    const auto groups = dd.groups();
+    ASSERT_EQ(groups.size(), 3U);
+
+    // The inner directories and the files are represented by the outer ones, a
+    // single copy outside of them is paired with one inside
+    using Paths = std::vector<fs::path>;
+    const auto found = collectGroups(dd);
+    EXPECT_EQ(found[0], (Paths {dir / "a", dir / "b"}));
+    EXPECT_THAT(found[1],
+                testing::AnyOf(Paths {dir / "a/x", dir / "c/x"},
+                               Paths {dir / "b/x", dir / "c/x"}));
+    EXPECT_THAT(found[2],
+                testing::AnyOf(Paths {dir / "a/x/2", dir / "d/2-copy"},
+                               Paths {dir / "b/x/2", dir / "d/2-copy"}));
+
+    const std::vector<size_t> expectedSizes {11, 6, 3};
+    const std::vector<bool> expectedDirs {true, true, false};
+
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        const auto& entries = groups[g].entries;
+        ASSERT_EQ(entries.size(), 2U);
+
+        for (const auto& e : entries)
+        {
+            EXPECT_EQ(e.size(), expectedSizes[g]);
+            EXPECT_EQ(e.directory(), expectedDirs[g]);
+            EXPECT_EQ(e.sha256(), entries.front().sha256());
+        }
+    }
+
+    EXPECT_NE(groups[0].entries[0].sha256(), groups[1].entries[0].sha256());
+    EXPECT_EQ(crypto::toHex(groups[2].entries[0].sha256()), crypto::sha256("two"));
+}
+
+TEST(DuplicateDetectorTest, DirectoriesWithEntriesLeftOutAreNotGrouped)
+{
+    file::TempDir data("dups");
+    const auto& dir = data.path();
+    const std::string large(2048, 'x');
+
+    // The directories differ only in the files below the minimum size, which the
+    // scan leaves out of the tree, directly or in a subdirectory of their own
+    const std::map<fs::path, std::string> files {{dir / "a/x/1", large},
+                                                 {dir / "a/x/2", large + 'y'},
+                                                 {dir / "b/x/1", large},
+                                                 {dir / "b/x/2", large + 'y'},
+                                                 {dir / "c/x/1", large},
+                                                 {dir / "c/x/2", large + 'y'}};
+    DuplicateDetector dd;
+
+    for (const auto& [file, content] : files)
+    {
+        fs::create_directories(file.parent_path());
+        file::write(file, content);
+        dd.addFile(file);
+    }
+
+    file::write(dir / "b/x/small", "unique");
+    dd.addIncompleteDir(dir / "b/x");
+    fs::create_directories(dir / "c/sub");
+    file::write(dir / "c/sub/small", "unique");
+    dd.addIncompleteDir(dir / "c/sub");
+
+    dd.detect({.directoryGroups = true}, defaultProgressCallback);
+
+    // Only `a/x` and `c/x` are complete, `c` holds a file left out
+    using Paths = std::vector<fs::path>;
+    const auto found = collectGroups(dd);
+    ASSERT_EQ(found.size(), 3U);
+    EXPECT_EQ(found[0], (Paths {dir / "a/x", dir / "c/x"}));
+    EXPECT_THAT(found[1],
+                testing::AnyOf(Paths {dir / "a/x/2", dir / "b/x/2"},
+                               Paths {dir / "b/x/2", dir / "c/x/2"}));
+    EXPECT_THAT(found[2],
+                testing::AnyOf(Paths {dir / "a/x/1", dir / "b/x/1"},
+                               Paths {dir / "b/x/1", dir / "c/x/1"}));
+}
+
+TEST(DuplicateDetectorTest, OnlyCopiesAcrossTheSetsAreDetected)
+{
+    file::TempDir data("dups");
+    const auto& dir = data.path();
+
+    // `src/a` and `src/b` are copies within the source set, `src/c` is backed up
+    const FileDataMap files {{dir / "src/a", "one"},
+                             {dir / "src/b", "one"},
+                             {dir / "src/c", "three"},
+                             {dir / "src/e", "seven"},
+                             {dir / "bak/c-copy", "three"},
+                             {dir / "bak/d", "four"}};
+    createFiles(files);
+
+    DuplicateDetector dd;
+    addFiles(files, dd);
+    dd.detect({}, defaultProgressCallback);
+    EXPECT_EQ(dd.numGroups(), 2U);
+
+    dd.detect({.backupDirs = {dir / "bak"}}, defaultProgressCallback);
+    const auto groups = dd.groups();
+    ASSERT_EQ(groups.size(), 1U);
+
+    // The size bucket of the source files only is never read
+    EXPECT_EQ(dd.stats()[Stage::Head].files, 3U);
+
+    const auto& entries = groups[0].entries;
+    ASSERT_EQ(entries.size(), 2U);
+
+    for (const auto& e : entries)
+    {
+        EXPECT_EQ(e.backup(), e.file() == dir / "bak/c-copy") << e.file();
+    }
+
+    // Without the files of the backup set nothing is detected
+    dd.detect({.backupDirs = {dir / "missing"}}, defaultProgressCallback);
+    EXPECT_EQ(dd.numGroups(), 0U);
+}
+
+TEST(DuplicateDetectorTest, SameGroupsForAnyNumberOfWorkers)
+{
+    file::TempDir data("dups");
+    const auto files = getTestFiles(data.path());
+    createFiles(files);
+
+    GroupList expected;
+
+    for (const size_t workers : {1U, 2U, 4U, 0U})
+    {
+        DuplicateDetector dd;
+        addFiles(files, dd);
+
+        size_t calls = 0;
+        size_t lastPercent = 0;
+        auto progress = [&calls, &lastPercent](Stage stage,
+                                               const Node* node,
+                                               size_t percent) {
+            ASSERT_NE(node, nullptr);
+            if (stage == Stage::Confirm)
+            {
+                EXPECT_GE(percent, lastPercent);
+                lastPercent = percent;
+                ++calls;
+            }
+        };
+        dd.detect({.hashWorkers = workers, .compareMaxFiles = 0}, progress);
+
+        // Every file sharing its size with another one is hashed exactly once
+        EXPECT_EQ(calls, files.size() - 1);
+        EXPECT_EQ(lastPercent, 100U);
+
+        const auto groups = collectGroups(dd);
+        EXPECT_EQ(groups.size(), 3U);
+
+        if (expected.empty())
+        {
+            expected = groups;
+        }
+        EXPECT_EQ(groups, expected);
+    }
+}
+
+TEST(DuplicateDetectorTest, SameGroupsForAnyReadBackend)
+{
+    file::TempDir data("dups");
+    const auto files = getTestFiles(data.path());
+    createFiles(files);
+
+    GroupList expected;
+    std::map<Stage, size_t> expectedCalls;
+
+    // The io_uring falls back to the threads where it is not available, it leaves
+    // the devices with limited reads to the workers
+    for (const auto& opts : {Options {.compareMaxFiles = 0},
+                             Options {.compareMaxFiles = 0,
+                                      .readBackend = ReadBackend::IoUring},
+                             Options {.hddWorkers = 1,
+                                      .ssdWorkers = 1,
+                                      .compareMaxFiles = 0,
+                                      .readBackend = ReadBackend::IoUring}})
+    {
+        DuplicateDetector dd;
+        addFiles(files, dd);
+
+        std::map<Stage, size_t> calls;
+        auto progress = [&calls](Stage stage, const Node*, size_t) {
+            ++calls[stage];
+        };
+        dd.detect(opts, progress);
+
+        const auto groups = collectGroups(dd);
+        EXPECT_EQ(groups.size(), 3U);
+
+        if (expected.empty())
+        {
+            expected = groups;
+            expectedCalls = calls;
+        }
+        EXPECT_EQ(groups, expected);
+        EXPECT_EQ(calls, expectedCalls);
+    }
+}
+
+TEST(DuplicateDetectorTest, LargeFilesGetTheTreeDigest)
+{
+    file::TempDir data("dups");
+    const std::string large(100'000, 'x');
+    std::string other = large;
+    other[50'000] = 'y';
+
+    const FileDataMap files {{data.path() / "a", large},
+                             {data.path() / "b", large},
+                             {data.path() / "c", other},
+                             {data.path() / "d", "small"},
+                             {data.path() / "e", "small"}};
+    createFiles(files);
+
+    // A file smaller than a chunk is a single one
+    auto treeDigest = [](std::string_view content) {
+        crypto::Sha256Hasher leaf;
+        crypto::Sha256Hasher root;
+        crypto::Digest digest {};
+
+        leaf.update(content);
+        leaf.final(digest);
+        root.update({reinterpret_cast<const char*>(digest.data()), digest.size()});
+        root.final(digest);
+        return digest;
+    };
+
+    for (const auto backend : {ReadBackend::Threads, ReadBackend::IoUring})
+    {
+        DuplicateDetector dd;
+        addFiles(files, dd);
+        dd.detect({.readBackend = backend, .treeHashMinBytes = 1000},
+                  defaultProgressCallback);
+
+        const auto groups = dd.groups();
+        ASSERT_EQ(groups.size(), 2U);
+
+        // The large files are hashed instead of compared, the small ones keep the
+        // plain digest
+        for (const auto& e : groups[0].entries)
+        {
+            EXPECT_EQ(e.sha256(), treeDigest(large));
+        }
+        for (const auto& e : groups[1].entries)
+        {
+            EXPECT_EQ(crypto::toHex(e.sha256()), crypto::sha256("small"));
+        }
+
+        EXPECT_EQ(dd.stats()[Stage::Compare].files, 2U);
+        EXPECT_EQ(dd.stats()[Stage::Confirm].files, 2U);
+    }
+}
+
+TEST(DuplicateDetectorTest, SameSizeDifferentContentIsNotReported)
+{
+    file::TempDir data("dups");
+    const FileDataMap files {{data.path() / "a", "abc"},
+                             {data.path() / "b", "abc"},
+                             {data.path() / "c", "xyz"}};
+    createFiles(files);
+
+    DuplicateDetector dd;
+    addFiles(files, dd);
+    dd.detect({.hashWorkers = 2}, defaultProgressCallback);
+
+    const auto groups = collectGroups(dd);
+    ASSERT_EQ(groups.size(), 1U);
+    EXPECT_EQ(dd.numGroups(), 1U);
+    EXPECT_EQ(groups.front(),
+              (std::vector<fs::path> {data.path() / "a", data.path() / "b"}));
+}
+
+
+TEST(DuplicateDetectorTest, PartialRoundsDropCandidatesBeforeFullDigest)
+{
+    file::TempDir data("dups");
+    const std::string content(20'000, 'x');
+
+    auto modified = [&content](size_t pos) {
+        std::string s = content;
+        s[pos] = 'y';
+        return s;
+    };
+
+    const FileDataMap files {{data.path() / "a", content},
+                             {data.path() / "b", content},
+                             {data.path() / "head", modified(10)},
+                             {data.path() / "middle", modified(10'000)},
+                             {data.path() / "tail", modified(content.size() - 1)}};
+    createFiles(files);
+
+    DuplicateDetector dd;
+    addFiles(files, dd);
+
+    std::map<Stage, size_t> calls;
+    std::map<Stage, size_t> lastPercent;
+    auto progress = [&calls, &lastPercent](Stage stage, const Node*, size_t percent) {
+        ++calls[stage];
+        lastPercent[stage] = percent;
+    };
+    dd.detect({.compareMaxFiles = 0}, progress);
+
+    // Each round digests only the survivors of the previous one
+    EXPECT_EQ(calls[Stage::Head], 5U);
+    EXPECT_EQ(calls[Stage::Tail], 4U);
+    EXPECT_EQ(calls[Stage::Sample], 3U);
+    EXPECT_EQ(calls[Stage::Calculate], 2U);
+    EXPECT_EQ(calls[Stage::Confirm], 2U);
+
+    for (const auto& [stage, percent] : lastPercent)
+    {
+        EXPECT_EQ(percent, 100U) << stage2str(stage);
+    }
+
+    const auto groups = collectGroups(dd);
+    ASSERT_EQ(groups.size(), 1U);
+    EXPECT_EQ(groups.front(),
+              (std::vector<fs::path> {data.path() / "a", data.path() / "b"}));
+}
+
+TEST(DuplicateDetectorTest, HashCacheSkipsReadingUnchangedFiles)
+{
+    file::TempDir data("dups");
+    file::TempDir cacheDir("dups-cache");
+    const std::string content(20'000, 'x');
+
+    const FileDataMap files {{data.path() / "a", content},
+                             {data.path() / "b", content},
+                             {data.path() / "c", content}};
+    createFiles(files);
+
+    auto detect = [&files, &cacheDir](std::map<Stage, size_t>& calls) {
+        HashCache cache(cacheDir.path(), Options {}.treeHashMinBytes);
+        DuplicateDetector dd;
+        addFiles(files, dd);
+        dd.detect({.hashCache = &cache}, [&calls](Stage stage, const Node*, size_t) {
+            ++calls[stage];
+        });
+
+        return collectGroups(dd);
+    };
+
+    std::map<Stage, size_t> calls;
+    const auto expected = detect(calls);
+    ASSERT_EQ(expected.size(), 1U);
+    EXPECT_EQ(calls[Stage::Head], 3U);
+    EXPECT_EQ(calls[Stage::Compare], 3U);
+    EXPECT_EQ(calls[Stage::Confirm], 0U);
+
+    // All the digests are known, no reading needed
+    calls.clear();
+    EXPECT_EQ(detect(calls), expected);
+    EXPECT_EQ(calls[Stage::Head], 0U);
+    EXPECT_EQ(calls[Stage::Compare], 0U);
+    EXPECT_EQ(calls[Stage::Confirm], 3U);
+
+    // A modified file invalidates its entry
+    std::string other = content;
+    other.back() = 'y';
+    const auto changed = data.path() / "c";
+    file::write(changed, other);
+    fs::last_write_time(changed, fs::last_write_time(changed) + std::chrono::hours(1));
+
+    calls.clear();
+    const auto groups = detect(calls);
+    ASSERT_EQ(groups.size(), 1U);
+    EXPECT_EQ(groups.front(),
+              (std::vector<fs::path> {data.path() / "a", data.path() / "b"}));
+    EXPECT_EQ(calls[Stage::Head], 3U);
+    EXPECT_EQ(calls[Stage::Tail], 3U);
+    EXPECT_EQ(calls[Stage::Compare], 2U);
+}
+
+TEST(DuplicateDetectorTest, HashCacheOfAnotherTreeThresholdIsRejected)
+{
+    file::TempDir cacheDir("dups-cache");
+    HashCache cache(cacheDir.path(), 0);
+
+    DuplicateDetector dd;
+    dd.addFile("/a", {.size = 10});
+    dd.addFile("/b", {.size = 10});
+    EXPECT_THROW(dd.detect({.hashCache = &cache}, defaultProgressCallback),
+                 std::invalid_argument);
+}
+
+TEST(DuplicateDetectorTest, KnownSizesAreNotQueriedAgain)
+{
+    // These paths doesn't have to be existing files
+    DuplicateDetector dd;
+    dd.addFile("/a/b/c.txt", {.size = 10});
+    dd.addFile("/a/d", {.size = 20});
+    dd.addFile("/a/d", {.size = 5});
+
+    std::map<Stage, size_t> calls;
+    dd.detect({}, [&calls](Stage stage, const Node*, size_t) {
+        ++calls[stage];
+    });
+
+    EXPECT_EQ(calls[Stage::Prepare], 0U);
+    EXPECT_EQ(dd.root()->size(), 15U);
+
+    // A single file without the size requires querying all of them
+    dd.addFile("/e/.f");
+    calls.clear();
+    dd.detect({}, [&calls](Stage stage, const Node*, size_t) {
+        ++calls[stage];
+    });
+
+    EXPECT_EQ(calls[Stage::Prepare], 3U);
+}
+
+TEST(DuplicateDetectorTest, HardLinksAreReadOnce)
+{
+    file::TempDir data("dups");
+    const std::string content(20'000, 'x');
+
+    const auto original = data.path() / "a";
+    const auto link = data.path() / "b";
+    const auto copy = data.path() / "c";
+    file::write(original, content);
+    file::write(copy, content);
+    fs::create_hard_link(original, link);
+
+    auto addFile = [](DuplicateDetector& dd, const fs::path& p) {
+        file::FileInfo info;
+        std::error_code ec;
+        ASSERT_TRUE(file::fileInfo(p, info, ec));
+        dd.addFile(p, {.id = {info.device, info.inode}});
+    };
+
+    // Links to the same data only are not duplicates
+    DuplicateDetector dd;
+    addFile(dd, original);
+    addFile(dd, link);
+    dd.detect({}, [](Stage stage, const Node*, size_t) {
+        EXPECT_EQ(stage, Stage::Prepare);
+    });
+    EXPECT_EQ(dd.numGroups(), 0U);
+
+    std::map<Stage, size_t> calls;
+    addFile(dd, copy);
+    dd.detect({}, [&calls](Stage stage, const Node*, size_t) {
+        ++calls[stage];
+    });
+    EXPECT_EQ(calls[Stage::Head], 2U);
+    EXPECT_EQ(calls[Stage::Compare], 2U);
+
+    std::map<fs::path, bool> links;
+    dd.enumGroups([&links](const DupGroup& group) {
+        for (const auto& e : group.entires)
+        {
+            links[e.file] = e.link;
+        }
+        return true;
+    });
+
+    EXPECT_EQ(links,
+              (std::map<fs::path, bool> {{original, true},
+                                         {link, true},
+                                         {copy, false}}));
+}
+
+TEST(DuplicateDetectorTest, SmallGroupsAreComparedInLockStep)
+{
+    file::TempDir data("dups");
+    std::string content(1024 * 1024, 'x');
+    for (size_t i = 0; i < content.size(); ++i)
+    {
+        content[i] = static_cast<char>('a' + (i * 7 + i / 1000) % 26);
+    }
+
+    // The difference is out of the ranges inspected by the partial rounds and in
+    // one of the later blocks of the comparison, which grow up to the buffer size
+    std::string other = content;
+    other[300'000] = '#';
+
+    const FileDataMap files {{data.path() / "a", content},
+                             {data.path() / "b", content},
+                             {data.path() / "c", other}};
+    createFiles(files);
+
+    for (const auto& opts : {Options {.hashWorkers = 1},
+                             Options {.hashWorkers = 2, .readBufferBytes = 16 * 1024}})
+    {
+        DuplicateDetector dd;
+        addFiles(files, dd);
+
+        std::map<Stage, size_t> calls;
+        auto progress = [&calls](Stage stage, const Node*, size_t) {
+            ++calls[stage];
+        };
+        dd.detect(opts, progress);
+
+        EXPECT_EQ(calls[Stage::Sample], 3U);
+        EXPECT_EQ(calls[Stage::Compare], 3U);
+        EXPECT_EQ(calls[Stage::Calculate], 0U);
+        EXPECT_EQ(calls[Stage::Confirm], 0U);
+
+        // Digests of the equal files are calculated during the comparison
+        std::vector<DupEntry> entries;
+        dd.enumGroups([&entries](const DupGroup& grp) {
+            entries = grp.entires;
+            return true;
+        });
+
+        ASSERT_EQ(entries.size(), 2U);
+        EXPECT_EQ(dd.numGroups(), 1U);
+        for (const auto& e : entries)
+        {
+            EXPECT_NE(e.file, data.path() / "c");
+            EXPECT_EQ(crypto::toHex(e.sha256), crypto::sha256(content));
+        }
+    }
+}
+
+TEST(DuplicateDetectorTest, ResumesFromEveryCheckpoint)
+{
+    file::TempDir data("dups");
+    auto files = getTestFiles(data.path());
+
+    // Larger files go through all the rounds, some of them are compared
+    const std::string content(20'000, 'x');
+    std::string other = content;
+    other[10'000] = 'y';
+
+    files.emplace(data.path() / "big/a", content);
+    files.emplace(data.path() / "big/b", content);
+    files.emplace(data.path() / "big/c", other);
+    files.emplace(data.path() / "big/d", other);
+    files.emplace(data.path() / "pair/a", std::string(30'000, 'p'));
+    files.emplace(data.path() / "pair/b", std::string(30'000, 'p'));
+    createFiles(files);
+
+    // Every digest triggers a checkpoint
+    std::vector<DetectionState> states;
+    const Options opts {
+        .compareMaxFiles = 2,
+        .checkpoint =
+            [&states](const DetectionState& state) {
+                states.push_back(state);
+            },
+        .checkpointInterval = std::chrono::seconds(0),
+    };
+
+    DuplicateDetector dd;
+    addFiles(files, dd);
+    dd.detect(opts, defaultProgressCallback);
+    const auto expected = collectGroups(dd);
+    ASSERT_EQ(expected.size(), 6U);
+
+    std::set<Stage> stages;
+    for (const auto& state : states)
+    {
+        stages.insert(state.stage);
+    }
+    EXPECT_EQ(stages.size(), 6U);
+    EXPECT_FALSE(states.back().digests.empty());
+    EXPECT_FALSE(states.back().compared.empty());
+
+    for (const auto& state : states)
+    {
+        DuplicateDetector resumed;
+        addFiles(files, resumed);
+
+        std::map<Stage, size_t> calls;
+        resumed.detect({.compareMaxFiles = 2, .resume = &state},
+                       [&calls](Stage stage, const Node*, size_t) {
+                           ++calls[stage];
+                       });
+
+        EXPECT_EQ(collectGroups(resumed), expected) << stage2str(state.stage);
+
+        // Only the sizes are queried again after the last round, no file is read
+        if (&state == &states.back())
+        {
+            calls.erase(Stage::Prepare);
+            EXPECT_TRUE(calls.empty());
+        }
+    }
+}
+
+TEST(DuplicateDetectorTest, GroupsAreStreamedAsTheirBucketsAreFinished)
+{
+    file::TempDir data("dups");
+    auto files = getTestFiles(data.path());
+
+    // Enough buckets for a few batches
+    for (size_t i = 1; i <= 1500; ++i)
+    {
+        const std::string content(i, static_cast<char>('a' + i % 26));
+        files.emplace(data.path() / std::format("pairs/{}-a", i), content);
+        files.emplace(data.path() / std::format("pairs/{}-b", i), content);
+    }
+    createFiles(files);
+
+    DuplicateDetector regular;
+    addFiles(files, regular);
+    regular.detect({}, defaultProgressCallback);
+    auto expected = collectGroups(regular);
+    std::ranges::sort(expected);
+    ASSERT_EQ(expected.size(), 1503U);
+
+    // The first group arrives while the other buckets are not read yet
+    size_t progressCalls = 0;
+    size_t callsBeforeFirst = 0;
+    size_t checkpoints = 0;
+    GroupList streamed;
+
+    const Options opts {
+        .checkpoint =
+            [&checkpoints](const DetectionState&) {
+                ++checkpoints;
+            },
+        .onGroup =
+            [&](const DupGroup& grp) {
+                if (streamed.empty())
+                {
+                    callsBeforeFirst = progressCalls;
+                }
+
+                auto& group = streamed.emplace_back();
+                for (const auto& e : grp.entires)
+                {
+                    group.push_back(e.file);
+                }
+                std::ranges::sort(group);
+                EXPECT_EQ(grp.groupId, streamed.size());
+                return true;
+            },
+    };
+
+    DuplicateDetector dd;
+    addFiles(files, dd);
+    dd.detect(opts, [&progressCalls](Stage stage, const Node*, size_t) {
+        progressCalls += stage != Stage::Prepare ? 1 : 0;
+    });
+
+    std::ranges::sort(streamed);
+    EXPECT_EQ(streamed, expected);
+    EXPECT_LT(callsBeforeFirst, progressCalls / 2);
+    EXPECT_EQ(checkpoints, 0U);
+
+    // The detector keeps the streamed groups
+    auto kept = collectGroups(dd);
+    std::ranges::sort(kept);
+    EXPECT_EQ(kept, expected);
+
+    // The detection stops with the stream
+    DuplicateDetector stopped;
+    addFiles(files, stopped);
+    size_t received = 0;
+    stopped.detect({.onGroup =
+                        [&received](const DupGroup&) {
+                            return ++received < 3;
+                        }},
+                   defaultProgressCallback);
+    EXPECT_EQ(received, 3U);
+    EXPECT_EQ(stopped.numGroups(), 3U);
+}
+
+TEST(DuplicateDetectorTest, StatsOfEveryStage)
+{
+    file::TempDir data("dups");
+    const std::string content(20'000, 'x');
+
+    auto modified = [&content](size_t pos) {
+        std::string s = content;
+        s[pos] = 'y';
+        return s;
+    };
+
+    const FileDataMap files {{data.path() / "a", content},
+                             {data.path() / "b", content},
+                             {data.path() / "head", modified(10)},
+                             {data.path() / "middle", modified(10'000)},
+                             {data.path() / "tail", modified(content.size() - 1)}};
+    createFiles(files);
+
+    DuplicateDetector dd;
+    addFiles(files, dd);
+    dd.detect({.compareMaxFiles = 0}, defaultProgressCallback);
+
+    const auto& stats = dd.stats();
+    EXPECT_EQ(stats[Stage::Prepare].files, 5U);
+    EXPECT_EQ(stats[Stage::Prepare].bytes, 0U);
+
+    // Each round reads its ranges of the survivors of the previous one
+    const std::map<Stage, std::pair<size_t, uint64_t>> expected {
+        {Stage::Head, {5, 5 * 4096}},
+        {Stage::Tail, {4, 4 * 4096}},
+        {Stage::Sample, {3, 3 * (content.size() - 2 * 4096)}},
+        {Stage::Compare, {0, 0}},
+        {Stage::Calculate, {2, 2 * content.size()}},
+        {Stage::Confirm, {2, 2 * content.size()}},
+    };
+
+    for (const auto& [stage, filesAndBytes] : expected)
+    {
+        const auto& [numFiles, bytes] = filesAndBytes;
+        const auto& st = stats[stage];
+
+        EXPECT_EQ(st.files, numFiles) << stage2str(stage);
+        EXPECT_EQ(st.bytes, bytes) << stage2str(stage);
+        EXPECT_EQ(st.opens, numFiles) << stage2str(stage);
+        EXPECT_GE(st.reads, numFiles) << stage2str(stage);
+        EXPECT_EQ(st.cacheHits, 0U) << stage2str(stage);
+    }
+
+    EXPECT_GT(stats[Stage::Head].wall.count(), 0);
+    EXPECT_EQ(stats.groupSizes, (std::map<size_t, size_t> {{2, 1}}));
+
+    // A new detection starts over
+    DuplicateDetector empty;
+    empty.detect({}, defaultProgressCallback);
+    EXPECT_EQ(empty.stats().groupSizes.size(), 0U);
+    EXPECT_EQ(empty.stats()[Stage::Prepare].files, 0U);
+}
+
+TEST(DuplicateDetectorTest, StatsCountCacheHitsAndComparedFiles)
+{
+    file::TempDir data("dups");
+    file::TempDir cacheDir("dups-cache");
+    const std::string content(20'000, 'x');
+
+    const FileDataMap files {{data.path() / "a", content},
+                             {data.path() / "b", content},
+                             {data.path() / "c", content}};
+    createFiles(files);
+
+    auto detect = [&files, &cacheDir]() {
+        HashCache cache(cacheDir.path(), Options {}.treeHashMinBytes);
+        DuplicateDetector dd;
+        addFiles(files, dd);
+        dd.detect({.hashCache = &cache}, defaultProgressCallback);
+
+        return dd.stats();
+    };
+
+    // The blocks of 4 KB, 8 KB and the remaining ones of every file are compared
+    auto stats = detect();
+    EXPECT_EQ(stats[Stage::Compare].files, 3U);
+    EXPECT_EQ(stats[Stage::Compare].opens, 3U);
+    EXPECT_EQ(stats[Stage::Compare].reads, 9U);
+    EXPECT_EQ(stats[Stage::Compare].bytes, 3 * content.size());
+    EXPECT_EQ(stats[Stage::Prepare].cacheHits, 0U);
+    EXPECT_EQ(stats.groupSizes, (std::map<size_t, size_t> {{3, 1}}));
+
+    // The digests are known, nothing is read
+    stats = detect();
+    EXPECT_EQ(stats[Stage::Prepare].cacheHits, 3U);
+    EXPECT_EQ(stats[Stage::Compare].files, 0U);
+
+    for (const auto& st : stats.stages)
+    {
+        EXPECT_EQ(st.bytes, 0U);
+    }
+}
+
 TEST(DuplicateDetectorTest, MetricsThresholds)
 {
     constexpr size_t numFiles = 50'000;
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <duplicates/GroupStream.h>
+
+#include <thread>
+#include <vector>
+
+namespace tools::dups {
+
+TEST(GroupStreamTest, GroupsArriveInTheOrderOfPushes)
+{
+    GroupStream stream(2);
+    std::thread producer([&stream] {
+        for (size_t i = 1; i <= 100; ++i)
+        {
+            EXPECT_TRUE(stream.push({.groupId = i}));
+        }
+        stream.close();
+    });
+
+    std::vector<size_t> ids;
+    while (auto group = stream.pop())
+    {
+        ids.push_back(group->groupId);
+    }
+    producer.join();
+
+    ASSERT_EQ(ids.size(), 100U);
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        EXPECT_EQ(ids[i], i + 1);
+    }
+}
+
+TEST(GroupStreamTest, ClosedStreamIsDrainedFirst)
+{
+    GroupStream stream(0);
+    EXPECT_TRUE(stream.push({.groupId = 1}));
+    stream.close();
+
+    EXPECT_TRUE(stream.closed());
+    EXPECT_FALSE(stream.push({.groupId = 2}));
+
+    const auto group = stream.pop();
+    ASSERT_TRUE(group);
+    EXPECT_EQ(group->groupId, 1U);
+    EXPECT_FALSE(stream.pop());
+}
+
+TEST(GroupStreamTest, ClosingWakesUpBlockedProducer)
+{
+    GroupStream stream(1);
+    EXPECT_TRUE(stream.push({.groupId = 1}));
+
+    // The stream is full, the push waits until the consumer gives up
+    bool pushed = true;
+    std::thread producer([&stream, &pushed] {
+        pushed = stream.push({.groupId = 2});
+    });
+
+    stream.close();
+    producer.join();
+    EXPECT_FALSE(pushed);
+}
+
+} // namespace tools::dups
@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+
+#include <duplicates/HashCache.h>
+#include <core/utils/Crypto.h>
+#include <core/utils/File.h>
+
+#include <string>
+#include <string_view>
+
+using namespace core;
+
+namespace tools::dups {
+namespace {
+
+file::FileInfo makeInfo(uint64_t inode, uint64_t size = 100, int64_t mtime = 1)
+{
+    return {.device = 1, .inode = inode, .size = size, .links = 1, .mtime = mtime};
+}
+
+crypto::Digest digestOf(std::string_view data)
+{
+    crypto::Sha256Hasher hasher;
+    crypto::Digest digest {};
+
+    hasher.update(data);
+    hasher.final(digest);
+
+    return digest;
+}
+
+} // namespace
+
+TEST(HashCacheTest, StoredDigestsSurviveReopening)
+{
+    file::TempDir dir("hash-cache");
+    const auto sha = digestOf("content");
+
+    {
+        HashCache cache(dir.path(), 0);
+        EXPECT_EQ(cache.size(), 0U);
+
+        crypto::Digest digest {};
+        EXPECT_FALSE(cache.lookup(makeInfo(10), digest));
+
+        cache.store(makeInfo(10), sha);
+        ASSERT_TRUE(cache.lookup(makeInfo(10), digest));
+        EXPECT_EQ(digest, sha);
+    }
+
+    HashCache cache(dir.path(), 0);
+    crypto::Digest digest {};
+    ASSERT_TRUE(cache.lookup(makeInfo(10), digest));
+    EXPECT_EQ(digest, sha);
+}
+
+TEST(HashCacheTest, ChangedFilesAreNotFound)
+{
+    file::TempDir dir("hash-cache");
+    HashCache cache(dir.path(), 0);
+    cache.store(makeInfo(10, 100, 5), digestOf("content"));
+
+    crypto::Digest digest {};
+    EXPECT_FALSE(cache.lookup(makeInfo(10, 101, 5), digest));
+    EXPECT_FALSE(cache.lookup(makeInfo(10, 100, 6), digest));
+    EXPECT_FALSE(cache.lookup(makeInfo(11, 100, 5), digest));
+    EXPECT_TRUE(cache.lookup(makeInfo(10, 100, 5), digest));
+}
+
+TEST(HashCacheTest, CompactionMergesLogIntoTable)
+{
+    file::TempDir dir("hash-cache");
+    constexpr uint64_t numFiles = 100;
+
+    auto shaOf = [](uint64_t inode, int64_t mtime) {
+        return digestOf(std::to_string(inode) + "/" + std::to_string(mtime));
+    };
+
+    {
+        HashCache cache(dir.path(), 0);
+        for (uint64_t i = numFiles; i > 0; --i)
+        {
+            cache.store(makeInfo(i), shaOf(i, 1));
+        }
+        cache.compact();
+
+        EXPECT_EQ(cache.size(), numFiles);
+        EXPECT_EQ(fs::file_size(cache.tablePath()), 24 + numFiles * 64);
+        EXPECT_EQ(fs::file_size(cache.logPath()), 24U);
+
+        // Newer entries replace the ones in the table
+        for (uint64_t i = 1; i <= numFiles; i += 2)
+        {
+            cache.store(makeInfo(i, 100, 2), shaOf(i, 2));
+        }
+        cache.store(makeInfo(numFiles + 1), shaOf(numFiles + 1, 1));
+        cache.compact();
+
+        EXPECT_EQ(cache.size(), numFiles + 1);
+    }
+
+    HashCache cache(dir.path(), 0);
+    crypto::Digest digest {};
+
+    for (uint64_t i = 1; i <= numFiles + 1; ++i)
+    {
+        const int64_t mtime = (i % 2 == 1 && i <= numFiles) ? 2 : 1;
+        ASSERT_TRUE(cache.lookup(makeInfo(i, 100, mtime), digest)) << i;
+        EXPECT_EQ(digest, shaOf(i, mtime));
+    }
+}
+
+TEST(HashCacheTest, DamagedFilesAreIgnored)
+{
+    file::TempDir dir("hash-cache");
+    const auto sha = digestOf("content");
+
+    {
+        HashCache cache(dir.path(), 0);
+        cache.store(makeInfo(1), sha);
+        cache.store(makeInfo(2), sha);
+    }
+
+    // Interrupted write of the last record
+    const auto logPath = dir.path() / "digests.log";
+    fs::resize_file(logPath, fs::file_size(logPath) - 10);
+    file::write(dir.path() / "digests.tbl", "garbage");
+
+    {
+        HashCache cache(dir.path(), 0);
+        crypto::Digest digest {};
+        EXPECT_TRUE(cache.lookup(makeInfo(1), digest));
+        EXPECT_FALSE(cache.lookup(makeInfo(2), digest));
+
+        cache.store(makeInfo(3), sha);
+    }
+
+    HashCache cache(dir.path(), 0);
+    crypto::Digest digest {};
+    EXPECT_TRUE(cache.lookup(makeInfo(1), digest));
+    EXPECT_TRUE(cache.lookup(makeInfo(3), digest));
+}
+
+TEST(HashCacheTest, DigestsOfAnotherTreeThresholdAreIgnored)
+{
+    file::TempDir dir("hash-cache");
+    const auto sha = digestOf("content");
+
+    {
+        HashCache cache(dir.path(), 1000);
+        cache.store(makeInfo(1), sha);
+        cache.compact();
+        cache.store(makeInfo(2), sha);
+    }
+
+    // Neither the table nor the log is taken, the file of 100 bytes might have been
+    // digested as a tree
+    {
+        HashCache cache(dir.path(), 100);
+        EXPECT_EQ(cache.treeMinBytes(), 100U);
+        EXPECT_EQ(cache.size(), 0U);
+
+        crypto::Digest digest {};
+        EXPECT_FALSE(cache.lookup(makeInfo(1), digest));
+        EXPECT_FALSE(cache.lookup(makeInfo(2), digest));
+
+        cache.store(makeInfo(3), sha);
+    }
+
+    HashCache cache(dir.path(), 100);
+    crypto::Digest digest {};
+    EXPECT_TRUE(cache.lookup(makeInfo(3), digest));
+}
+
+} // namespace tools::dups
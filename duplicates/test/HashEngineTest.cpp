@@ -0,0 +1,260 @@
+#include <gtest/gtest.h>
+
+#include <duplicates/HashEngine.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace tools::dups {
+
+TEST(HashEngineTest, ZeroWorkersSelectsHardwareThreads)
+{
+    const HashEngine engine(0);
+    EXPECT_GE(engine.workers(), 1U);
+    EXPECT_EQ(HashEngine(3).workers(), 3U);
+}
+
+TEST(HashEngineTest, EveryJobRunsOnceAndCompletesOnCallingThread)
+{
+    constexpr size_t numJobs = 1000;
+
+    for (const size_t workers : {1U, 2U, 8U})
+    {
+        const HashEngine engine(workers);
+        std::vector<std::atomic_int> runs(numJobs);
+        std::vector<int> done(numJobs, 0);
+        const auto caller = std::this_thread::get_id();
+
+        engine.run(
+            numJobs,
+            [&runs](size_t i) {
+                runs[i].fetch_add(1);
+            },
+            [&done, caller](size_t i) {
+                EXPECT_EQ(std::this_thread::get_id(), caller);
+                ++done[i];
+            });
+
+        for (size_t i = 0; i < numJobs; ++i)
+        {
+            EXPECT_EQ(runs[i].load(), 1);
+            EXPECT_EQ(done[i], 1);
+        }
+    }
+}
+
+TEST(HashEngineTest, NoJobs)
+{
+    const HashEngine engine(4);
+    size_t calls = 0;
+
+    engine.run(
+        0,
+        [&calls](size_t) {
+            ++calls;
+        },
+        [&calls](size_t) {
+            ++calls;
+        });
+
+    EXPECT_EQ(calls, 0U);
+}
+
+TEST(HashEngineTest, OnlyIdleWorkersAreLent)
+{
+    const HashEngine engine(4);
+
+    {
+        const auto lease = engine.borrowIdle(10);
+        EXPECT_EQ(lease.count(), 4U);
+        EXPECT_EQ(engine.borrowIdle(10).count(), 0U);
+    }
+
+    // The worker of the single job is busy, the others are idle
+    std::vector<size_t> lent;
+    engine.run(
+        1,
+        [&engine, &lent](size_t) {
+            const auto lease = engine.borrowIdle(2);
+            lent.push_back(lease.count());
+            lent.push_back(engine.borrowIdle(10).count());
+        },
+        [](size_t) {});
+
+    EXPECT_EQ(lent, (std::vector<size_t> {2, 1}));
+    EXPECT_EQ(engine.borrowIdle(10).count(), 4U);
+}
+
+TEST(HashEngineTest, QueueLimitsAreRespected)
+{
+    constexpr size_t numJobs = 600;
+    const HashEngine engine(8);
+
+    // Queue 0 runs one job at a time, queue 1 two and queue 2 is not limited
+    JobQueues queues {.limits = {1, 2, 0}};
+    for (size_t i = 0; i < numJobs; ++i)
+    {
+        queues.queueOf.push_back(static_cast<uint32_t>(i % 3));
+    }
+
+    std::vector<std::atomic_size_t> running(3);
+    std::vector<std::atomic_size_t> peak(3);
+    std::vector<std::atomic_int> runs(numJobs);
+    std::vector<size_t> started;
+    std::mutex mutex;
+
+    engine.run(
+        numJobs,
+        queues,
+        [&](size_t i) {
+            const auto q = queues.queueOf[i];
+            const auto now = running[q].fetch_add(1) + 1;
+
+            for (auto prev = peak[q].load(); prev < now;)
+            {
+                peak[q].compare_exchange_weak(prev, now);
+            }
+
+            if (q == 0)
+            {
+                const std::lock_guard lock(mutex);
+                started.push_back(i);
+            }
+
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            runs[i].fetch_add(1);
+            running[q].fetch_sub(1);
+        },
+        [](size_t) {});
+
+    for (size_t i = 0; i < numJobs; ++i)
+    {
+        EXPECT_EQ(runs[i].load(), 1);
+    }
+
+    EXPECT_EQ(peak[0].load(), 1U);
+    EXPECT_LE(peak[1].load(), 2U);
+    EXPECT_LE(peak[2].load(), 8U);
+
+    // Jobs of a queue start in order
+    EXPECT_TRUE(std::ranges::is_sorted(started));
+    EXPECT_EQ(started.size(), numJobs / 3);
+}
+
+TEST(HashEngineTest, QueueOrderIsRespected)
+{
+    // Two queues, the keys reverse the order of the jobs of the first one
+    const JobQueues queues {
+        .queueOf = {0, 1, 0, 1, 0},
+        .limits = {1, 1},
+        .order = {30, 0, 20, 1, 10},
+    };
+
+    for (const size_t workers : {1U, 4U})
+    {
+        const HashEngine engine(workers);
+        std::vector<size_t> started;
+        std::mutex mutex;
+
+        engine.run(
+            queues.queueOf.size(),
+            queues,
+            [&queues, &started, &mutex](size_t i) {
+                if (queues.queueOf[i] == 0)
+                {
+                    const std::lock_guard lock(mutex);
+                    started.push_back(i);
+                }
+            },
+            [](size_t) {});
+
+        EXPECT_EQ(started, (std::vector<size_t> {4, 2, 0}));
+    }
+}
+
+TEST(HashEngineTest, WorkerExceptionIsRethrown)
+{
+    const HashEngine engine(4);
+
+    EXPECT_THROW(engine.run(
+                     100,
+                     [](size_t i) {
+                         if (i == 42)
+                         {
+                             throw std::runtime_error("failure");
+                         }
+                     },
+                     [](size_t) {}),
+                 std::runtime_error);
+}
+
+TEST(HashEngineTest, CompletionExceptionStopsWorkers)
+{
+    const HashEngine engine(4);
+    std::atomic_size_t runs {0};
+
+    EXPECT_THROW(engine.run(
+                     10'000,
+                     [&runs](size_t) {
+                         runs.fetch_add(1);
+                     },
+                     [](size_t) {
+                         throw std::logic_error("stop");
+                     }),
+                 std::logic_error);
+
+    EXPECT_LE(runs.load(), 10'000U);
+}
+
+TEST(HashEngineTest, RunsShareTheWorkers)
+{
+    constexpr size_t numWorkers = 4;
+    const HashEngine engine(numWorkers);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+
+    for (int round = 0; round < 3; ++round)
+    {
+        engine.run(
+            1000,
+            [&](size_t) {
+                const std::lock_guard lock(mutex);
+                threads.insert(std::this_thread::get_id());
+            },
+            [](size_t) {});
+    }
+
+    EXPECT_LE(threads.size(), numWorkers);
+    EXPECT_FALSE(threads.contains(std::this_thread::get_id()));
+}
+
+TEST(HashEngineTest, FailedRunKeepsTheWorkers)
+{
+    const HashEngine engine(4);
+
+    EXPECT_THROW(engine.run(
+                     100,
+                     [](size_t) {
+                         throw std::runtime_error("failure");
+                     },
+                     [](size_t) {}),
+                 std::runtime_error);
+
+    std::atomic_size_t runs {0};
+    engine.run(
+        100,
+        [&runs](size_t) {
+            runs.fetch_add(1);
+        },
+        [](size_t) {});
+
+    EXPECT_EQ(runs.load(), 100U);
+}
+
+} // namespace tools::dups
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include <duplicates/Manifest.h>
+#include <duplicates/DuplicateDetector.h>
+#include <core/utils/File.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace core;
+
+namespace tools::dups {
+namespace {
+
+using Paths = std::vector<fs::path>;
+
+void createFiles(const std::map<fs::path, std::string>& files, DuplicateDetector& dd)
+{
+    for (const auto& [path, content] : files)
+    {
+        fs::create_directories(path.parent_path());
+        file::write(path, content);
+        dd.addFile(path, {.size = content.size()});
+    }
+}
+
+std::vector<Paths> collectGroups(const DuplicateDetector& dd)
+{
+    std::vector<Paths> groups;
+
+    for (const auto& group : dd.groups())
+    {
+        auto& files = groups.emplace_back();
+        for (const auto& e : group.entries)
+        {
+            files.push_back(e.file());
+        }
+        std::ranges::sort(files);
+    }
+
+    std::ranges::sort(groups);
+    return groups;
+}
+
+} // namespace
+
+TEST(ManifestTest, FilesOfAnotherHostAreDetectedWithoutReadingThem)
+{
+    file::TempDir remote("manifest-remote");
+    file::TempDir local("manifest-local");
+    const auto& rdir = remote.path();
+    const auto& ldir = local.path();
+    const std::string large(20'000, 'x');
+    std::string modified = large;
+    modified[10'000] = 'y';
+
+    // `d1` and `d2` are copies on the other host only
+    DuplicateDetector other;
+    createFiles({{rdir / "a", large},
+                 {rdir / "sub/b", "small"},
+                 {rdir / "d1", "remote"},
+                 {rdir / "d2", "remote"}},
+                other);
+
+    const Manifest manifest(ldir / "remote.dupm");
+    manifest.save(other, {});
+
+    // Nothing of the other host is read
+    for (const auto& entry : fs::directory_iterator(rdir))
+    {
+        fs::remove_all(entry);
+    }
+
+    DuplicateDetector dd;
+    createFiles({{ldir / "photos/a-copy", large},
+                 {ldir / "photos/b-copy", "small"},
+                 {ldir / "photos/almost-a", modified}},
+                dd);
+    EXPECT_EQ(manifest.load(dd, {}), 4U);
+    EXPECT_EQ(dd.numFiles(), 7U);
+
+    dd.detect({}, defaultProgressCallback);
+
+    // The files of the other host are under the manifest
+    auto remotePath = [&manifest](const fs::path& path) {
+        return manifest.path() / path.relative_path();
+    };
+
+    const std::vector<Paths> expected {
+        {ldir / "photos/a-copy", remotePath(rdir / "a")},
+        {ldir / "photos/b-copy", remotePath(rdir / "sub/b")},
+    };
+    EXPECT_EQ(collectGroups(dd), expected);
+
+    for (const auto& group : dd.groups())
+    {
+        EXPECT_EQ(group.entries[0].sha256(), group.entries[1].sha256());
+
+        // Only the local files can be acted upon
+        for (const auto& e : group.entries)
+        {
+            const auto& root = manifest.path().native();
+            EXPECT_EQ(e.remote(), e.file().native().starts_with(root));
+        }
+    }
+}
+
+TEST(ManifestTest, UnreadableFilesAreLeftOut)
+{
+    file::TempDir dir("manifest");
+    DuplicateDetector dd;
+    createFiles({{dir.path() / "data/a", "content"}}, dd);
+    dd.addFile(dir.path() / "data/missing", {.size = 7});
+
+    const Manifest manifest(dir.path() / "data.dupm");
+    manifest.save(dd, {});
+
+    DuplicateDetector loaded;
+    EXPECT_EQ(manifest.load(loaded, {}), 1U);
+
+    std::vector<fs::path> files;
+    loaded.enumFiles([&files](const fs::path& path) {
+        files.push_back(path);
+    });
+    EXPECT_EQ(files,
+              Paths {manifest.path() / (dir.path() / "data/a").relative_path()});
+}
+
+TEST(ManifestTest, DamagedOrIncompatibleManifestIsRejected)
+{
+    file::TempDir dir("manifest");
+    DuplicateDetector dd;
+    createFiles({{dir.path() / "a", "first"}, {dir.path() / "b", "second"}}, dd);
+
+    const Manifest manifest(dir.path() / "files.dupm");
+    manifest.save(dd, {});
+
+    // The large files of the other host are digested as trees from another size
+    DuplicateDetector loaded;
+    EXPECT_THROW(manifest.load(loaded, {.treeHashMinBytes = 0}), std::runtime_error);
+
+    const auto size = fs::file_size(manifest.path());
+    fs::resize_file(manifest.path(), size - 1);
+    EXPECT_THROW(manifest.load(loaded, {}), std::runtime_error);
+    EXPECT_EQ(loaded.numFiles(), 0U);
+
+    std::ofstream(manifest.path(), std::ios::binary) << "something else";
+    EXPECT_THROW(manifest.load(loaded, {}), std::runtime_error);
+
+    EXPECT_THROW(Manifest(dir.path() / "missing.dupm").load(loaded, {}),
+                 std::system_error);
+}
+
+} // namespace tools::dups
@@ -5,6 +5,7 @@
 #include <core/utils/File.h>
 
 #include <filesystem>
+#include <string>
 #include <vector>
 
 namespace tools::dups {
@@ -13,7 +14,6 @@ namespace {
 class NodeTest : public testing::Test
 {
 protected:
-    // Paths must outlive nodes because Node stores raw pointers to them
     fs::path rootName {"root"};
     fs::path dir1Name {"dir1"};
     fs::path dir2Name {"dir2"};
@@ -26,7 +26,8 @@ protected:
 
 TEST_F(NodeTest, RootNodeHasNoParentAndDepthZero)
 {
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     EXPECT_EQ(root.name(), rootName);
     EXPECT_EQ(root.parent(), nullptr);
     EXPECT_EQ(root.depth(), 0);
@@ -35,7 +36,8 @@ TEST_F(NodeTest, RootNodeHasNoParentAndDepthZero)
 
 TEST_F(NodeTest, RootNodeIsInitiallyALeaf)
 {
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     EXPECT_TRUE(root.leaf());
     EXPECT_EQ(root.nodesCount(), 1);
     EXPECT_EQ(root.leafsCount(), 1);
@@ -43,13 +45,15 @@ TEST_F(NodeTest, RootNodeIsInitiallyALeaf)
 
 TEST_F(NodeTest, RootNodeFullPathIsEmpty)
 {
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     EXPECT_TRUE(root.fullPath().empty());
 }
 
 TEST_F(NodeTest, ChildInheritsCorrectDepthAndParent)
 {
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     Node* child = root.addChild(dir1Name);
     ASSERT_NE(child, nullptr);
     EXPECT_EQ(child->parent(), &root);
@@ -63,7 +67,8 @@ TEST_F(NodeTest, ChildInheritsCorrectDepthAndParent)
 
 TEST_F(NodeTest, AddingChildMakesParentNonLeaf)
 {
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     EXPECT_TRUE(root.leaf());
     root.addChild(dir1Name);
     EXPECT_FALSE(root.leaf());
@@ -71,7 +76,8 @@ TEST_F(NodeTest, AddingChildMakesParentNonLeaf)
 
 TEST_F(NodeTest, AddChildIsIdempotent)
 {
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     Node* first = root.addChild(dir1Name);
     Node* second = root.addChild(dir1Name);
     EXPECT_EQ(first, second);
@@ -80,7 +86,8 @@ TEST_F(NodeTest, AddChildIsIdempotent)
 
 TEST_F(NodeTest, HasChildReturnsTrueAfterAdd)
 {
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     EXPECT_FALSE(root.hasChild(dir1Name));
     root.addChild(dir1Name);
     EXPECT_TRUE(root.hasChild(dir1Name));
@@ -89,7 +96,8 @@ TEST_F(NodeTest, HasChildReturnsTrueAfterAdd)
 
 TEST_F(NodeTest, NodesCountIncludesSelf)
 {
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     EXPECT_EQ(root.nodesCount(), 1);
 
     root.addChild(dir1Name);
@@ -101,7 +109,8 @@ TEST_F(NodeTest, NodesCountIncludesSelf)
 
 TEST_F(NodeTest, LeafsCountForTree)
 {
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     EXPECT_EQ(root.leafsCount(), 1);
 
     Node* dir1 = root.addChild(dir1Name);
@@ -117,7 +126,8 @@ TEST_F(NodeTest, LeafsCountForTree)
 
 TEST_F(NodeTest, FullPathReflectsHierarchy)
 {
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     Node* dir1 = root.addChild(dir1Name);
     Node* file1 = dir1->addChild(file1Name);
 
@@ -127,7 +137,8 @@ TEST_F(NodeTest, FullPathReflectsHierarchy)
 
 TEST_F(NodeTest, FullPathOverloadMatchesReturn)
 {
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     Node* dir1 = root.addChild(dir1Name);
     Node* file1 = dir1->addChild(file1Name);
 
@@ -138,7 +149,8 @@ TEST_F(NodeTest, FullPathOverloadMatchesReturn)
 
 TEST_F(NodeTest, EnumLeafsConstVisitsOnlyLeaves)
 {
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     Node* dir1 = root.addChild(dir1Name);
     dir1->addChild(file1Name);
     dir1->addChild(file2Name);
@@ -159,7 +171,8 @@ TEST_F(NodeTest, EnumLeafsConstVisitsOnlyLeaves)
 
 TEST_F(NodeTest, EnumLeafsMutableVisitsOnlyLeaves)
 {
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     Node* dir1 = root.addChild(dir1Name);
     dir1->addChild(file1Name);
     dir1->addChild(file2Name);
@@ -174,7 +187,8 @@ TEST_F(NodeTest, EnumLeafsMutableVisitsOnlyLeaves)
 
 TEST_F(NodeTest, EnumNodes)
 {
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     Node* dir1 = root.addChild(dir1Name);
     dir1->addChild(file1Name);
 
@@ -191,7 +205,8 @@ TEST_F(NodeTest, EnumNodesNonLeafsVisitedBeforeLeafs)
     // Tree: root -> dir1 (non-leaf) -> {file1, file2}
     //             -> file3 (leaf)
     // Expected enumNodes order: dir1, file1, file2, file3
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     Node* dir1 = root.addChild(dir1Name);
     dir1->addChild(file1Name);
     dir1->addChild(file2Name);
@@ -207,6 +222,28 @@ TEST_F(NodeTest, EnumNodesNonLeafsVisitedBeforeLeafs)
     EXPECT_TRUE(isLeafOrder.back());    // file3 visited last (leaf at root level)
 }
 
+TEST_F(NodeTest, EnumChildrenVisitsOnlyDirectChildren)
+{
+    NodeTree tree(rootName);
+    Node& root = tree.root();
+    Node* dir1 = root.addChild(dir1Name);
+    dir1->addChild(file1Name);
+    root.addChild(file2Name);
+
+    std::vector<fs::path> names;
+    root.enumChildren([&names](const Node* n) {
+        names.push_back(n->name());
+    });
+
+    EXPECT_EQ(names, (std::vector<fs::path> {dir1Name, file2Name}));
+
+    names.clear();
+    dir1->enumChildren([&names](const Node* n) {
+        names.push_back(n->name());
+    });
+    EXPECT_EQ(names, std::vector<fs::path> {file1Name});
+}
+
 TEST_F(NodeTest, UpdatePopulatesSizeFromDisk)
 {
     core::file::TempDir tmp("node-update");
@@ -221,15 +258,78 @@ TEST_F(NodeTest, UpdatePopulatesSizeFromDisk)
     fs::path aName {"a.txt"};
     fs::path bName {"b.txt"};
 
-    Node root(&rootName);
+    NodeTree tree(rootName);
+    Node& root = tree.root();
     Node* dir = root.addChild(tmpName);
     dir->addChild(aName);
     dir->addChild(bName);
 
+    // A file which can't be queried keeps its size
+    dir->addChild(fs::path {"missing.txt"})->setSize(4);
+
     root.update();
 
-    EXPECT_EQ(dir->size(), 11U);   // 5 + 6
-    EXPECT_EQ(root.size(), 11U);   // propagated up
+    EXPECT_EQ(dir->size(), 15U);   // 5 + 6 + 4
+    EXPECT_EQ(root.size(), 15U);   // propagated up
+}
+
+TEST_F(NodeTest, SetSizeAdjustsAncestors)
+{
+    NodeTree tree(rootName);
+    Node& root = tree.root();
+    Node* dir1 = root.addChild(dir1Name);
+    Node* file1 = dir1->addChild(file1Name);
+    Node* file2 = dir1->addChild(file2Name);
+    Node* file3 = root.addChild(file3Name);
+
+    file1->setSize(10);
+    file2->setSize(20);
+    file3->setSize(5);
+    EXPECT_EQ(dir1->size(), 30U);
+    EXPECT_EQ(root.size(), 35U);
+
+    file2->setSize(1);
+    EXPECT_EQ(file2->size(), 1U);
+    EXPECT_EQ(dir1->size(), 11U);
+    EXPECT_EQ(root.size(), 16U);
+}
+
+TEST_F(NodeTest, SameNameUnderDifferentParents)
+{
+    NodeTree tree(rootName);
+    Node& root = tree.root();
+    Node* dir1 = root.addChild(dir1Name);
+    Node* dir2 = root.addChild(dir2Name);
+
+    Node* file1 = dir1->addChild(file1Name);
+    Node* other = dir2->addChild(file1Name);
+
+    EXPECT_NE(file1, other);
+    EXPECT_EQ(file1->name(), other->name());
+    EXPECT_EQ(file1->fullPath(), dir1Name / file1Name);
+    EXPECT_EQ(other->fullPath(), dir2Name / file1Name);
+    EXPECT_FALSE(root.hasChild(file1Name));
+    EXPECT_EQ(tree.size(), 5U);
+}
+
+TEST_F(NodeTest, NodesStayValidWhileTreeGrows)
+{
+    constexpr size_t numDirs = 1000;
+
+    NodeTree tree(rootName);
+    Node& root = tree.root();
+    Node* dir1 = root.addChild(dir1Name);
+
+    for (size_t i = 0; i < numDirs; ++i)
+    {
+        root.addChild("dir" + std::to_string(i))->addChild(file1Name);
+    }
+
+    EXPECT_EQ(dir1->parent(), &root);
+    EXPECT_EQ(dir1->fullPath(), dir1Name);
+    EXPECT_EQ(root.addChild(dir1Name), dir1);
+    EXPECT_EQ(root.leafsCount(), numDirs);
+    EXPECT_EQ(tree.size(), 1 + 2 * numDirs);
 }
 
 } // namespace tools::dups
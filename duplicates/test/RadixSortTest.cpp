@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <duplicates/RadixSort.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace tools::dups {
+
+TEST(RadixSortTest, SortsLikeStableSort)
+{
+    std::mt19937_64 rng(42);
+    std::vector<std::pair<uint64_t, size_t>> buffer;
+
+    // Small keys share most of the bytes, large ones none of them
+    for (const uint64_t maxKey : {uint64_t {0}, uint64_t {7}, uint64_t {70'000},
+                                  std::numeric_limits<uint64_t>::max()})
+    {
+        std::uniform_int_distribution<uint64_t> dist(0, maxKey);
+        std::vector<std::pair<uint64_t, size_t>> items;
+
+        for (size_t i = 0; i < 5000; ++i)
+        {
+            items.emplace_back(dist(rng), i);
+        }
+
+        auto expected = items;
+        std::ranges::stable_sort(expected, {}, &std::pair<uint64_t, size_t>::first);
+
+        radixSort(items, buffer, [](const auto& item) {
+            return item.first;
+        });
+        EXPECT_EQ(items, expected) << maxKey;
+    }
+}
+
+TEST(RadixSortTest, ComplementedKeysSortDescending)
+{
+    std::vector<uint64_t> items {3, 1000, 0, 1000, 70'000, 3};
+    std::vector<uint64_t> buffer;
+
+    radixSort(items, buffer, [](uint64_t item) {
+        return ~item;
+    });
+    EXPECT_EQ(items, (std::vector<uint64_t> {70'000, 1000, 1000, 3, 3, 0}));
+
+    std::vector<uint64_t> empty;
+    radixSort(empty, buffer, [](uint64_t item) {
+        return item;
+    });
+    EXPECT_TRUE(empty.empty());
+}
+
+} // namespace tools::dups
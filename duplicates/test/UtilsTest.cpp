@@ -18,7 +18,7 @@ struct TreeFixture
     fs::path file2 {"file2.txt"};
     fs::path file3 {"file3.txt"};
 
-    Node tree {&root};
+    NodeTree tree {root};
 };
 
 } // namespace
@@ -27,29 +27,29 @@ TEST(UtilsTest, OutputTreeEmptyRootProducesNoOutput)
 {
     TreeFixture f;
     std::ostringstream os;
-    util::outputTree(&f.tree, os);
+    util::outputTree(&f.tree.root(), os);
     EXPECT_TRUE(os.str().empty());
 }
 
 TEST(UtilsTest, OutputTreeSingleLeafChild)
 {
     TreeFixture f;
-    f.tree.addChild(f.file1);
+    f.tree.root().addChild(f.file1);
 
     std::ostringstream os;
-    util::outputTree(&f.tree, os);
+    util::outputTree(&f.tree.root(), os);
     EXPECT_EQ(os.str(), "file1.txt\n");
 }
 
 TEST(UtilsTest, OutputTreeDirectoryWithFiles)
 {
     TreeFixture f;
-    Node* dir1 = f.tree.addChild(f.dir1);
+    Node* dir1 = f.tree.root().addChild(f.dir1);
     dir1->addChild(f.file1);
     dir1->addChild(f.file2);
 
     std::ostringstream os;
-    util::outputTree(&f.tree, os);
+    util::outputTree(&f.tree.root(), os);
     const std::string out = os.str();
 
     // dir1 is depth 1 — no trailing slash even though it has children
@@ -62,12 +62,12 @@ TEST(UtilsTest, OutputTreeDirectoryWithFiles)
 TEST(UtilsTest, OutputTreeNestedDirectoriesGetSlash)
 {
     TreeFixture f;
-    Node* dir1 = f.tree.addChild(f.dir1);
+    Node* dir1 = f.tree.root().addChild(f.dir1);
     Node* dir2 = dir1->addChild(f.dir2);
     dir2->addChild(f.file1);
 
     std::ostringstream os;
-    util::outputTree(&f.tree, os);
+    util::outputTree(&f.tree.root(), os);
 
     // dir1 depth 1 — no slash; dir2 depth 2, non-leaf — gets slash
     const std::string expected =